@@ -152,7 +152,7 @@ int main()
 
     VkPipelineLayout pipeline_layout = VK_NULL_HANDLE;
 
-    VkPipeline pipeline = create_graphics_pipeline(device, VK_NULL_HANDLE, &desc_cache, &pipe_cache, "compiledshaders/tri.vert.spv",
+    VkPipeline pipeline = create_graphics_pipeline(device, VK_NULL_HANDLE, &desc_cache, &pipe_cache, NULL, "compiledshaders/tri.vert.spv",
                                                    "compiledshaders/tri.frag.spv", &cfg, &pipeline_layout);
 
     Buffer vertex_buffer;
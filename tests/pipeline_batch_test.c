@@ -0,0 +1,152 @@
+// pipeline_batch_compile on a real device, lavapipe is enough:
+//
+//   VK_ICD_FILENAMES=/usr/share/vulkan/icd.d/lvp_icd.x86_64.json make check
+//
+// Compiles a batch of the compiledshaders/tri pipelines across several
+// workers, each with its own pipeline cache merged back at the end. The
+// batch repeats every pipeline state a few times, so the shared object
+// cache must hand out exactly one pipeline per state.
+
+#include "tools/headless.h"
+#include "vk_pipeline_batch.h"
+
+#define VARIANT_COUNT 8u
+#define COPY_COUNT 8u
+#define DESC_COUNT (VARIANT_COUNT * COPY_COUNT)
+#define WORKER_COUNT 4u
+
+static uint32_t failures;
+
+#define CHECK(cond)                                                                                                    \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if(!(cond))                                                                                                    \
+        {                                                                                                              \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);                                           \
+            failures++;                                                                                                \
+        }                                                                                                              \
+    } while(0)
+
+static size_t cache_data_size(VkDevice device, VkPipelineCache cache)
+{
+    size_t size = 0;
+    vkGetPipelineCacheData(device, cache, &size, NULL);
+    return size;
+}
+
+int main(void)
+{
+    Headless vk;
+    if(!headless_init(&vk, NULL, 0, NULL))
+        return 1;
+
+    VkPipelineCacheCreateInfo cache_info = {.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO};
+    VkPipelineCache           cache;
+    VK_CHECK(vkCreatePipelineCache(vk.device, &cache_info, NULL, &cache));
+    size_t seed_size = cache_data_size(vk.device, cache);
+
+    DescriptorLayoutCache desc_cache;
+    PipelineLayoutCache   pipe_cache;
+    PipelineObjectCache   obj_cache;
+    descriptor_layout_cache_init(&desc_cache);
+    pipeline_layout_cache_init(&pipe_cache);
+    pipeline_object_cache_init(&obj_cache, NULL);
+
+    static const VkCullModeFlags cull_modes[4] = {
+        VK_CULL_MODE_NONE,
+        VK_CULL_MODE_BACK_BIT,
+        VK_CULL_MODE_FRONT_BIT,
+        VK_CULL_MODE_FRONT_AND_BACK,
+    };
+    static const VkFormat color_format = VK_FORMAT_B8G8R8A8_UNORM;
+
+    // desc i has state variant i % VARIANT_COUNT, so copies are spread over the workers
+    GraphicsPipelineConfig configs[DESC_COUNT];
+    PipelineBatchDesc      descs[DESC_COUNT];
+    for(uint32_t i = 0; i < DESC_COUNT; i++)
+    {
+        uint32_t variant = i % VARIANT_COUNT;
+
+        configs[i]                        = graphics_pipeline_config_default();
+        configs[i].cull_mode              = cull_modes[variant % 4];
+        configs[i].front_face             = variant < 4 ? VK_FRONT_FACE_CLOCKWISE : VK_FRONT_FACE_COUNTER_CLOCKWISE;
+        configs[i].color_attachment_count = 1;
+        configs[i].color_formats          = &color_format;
+
+        descs[i] = (PipelineBatchDesc){
+            .kind      = PIPELINE_OBJECT_GRAPHICS,
+            .vert_path = "compiledshaders/tri.vert.spv",
+            .frag_path = "compiledshaders/tri.frag.spv",
+            .config    = &configs[i],
+        };
+    }
+
+    PipelineBatchResult results[DESC_COUNT];
+    PipelineBatchStats  stats;
+    uint32_t created = pipeline_batch_compile(vk.device, cache, NULL, &desc_cache, &pipe_cache, &obj_cache, descs, DESC_COUNT,
+                                              WORKER_COUNT, results, &stats);
+
+    CHECK(created == DESC_COUNT);
+    CHECK(stats.failed == 0);
+    CHECK(stats.worker_count == WORKER_COUNT);
+
+    uint64_t compile_sum = 0, compile_max = 0;
+    for(uint32_t i = 0; i < DESC_COUNT; i++)
+    {
+        CHECK(results[i].pipeline != VK_NULL_HANDLE);
+        CHECK(results[i].layout != VK_NULL_HANDLE);
+        CHECK(results[i].worker < stats.worker_count);
+        CHECK(results[i].compile_ns > 0);
+
+        compile_sum += results[i].compile_ns;
+        compile_max = MAX(compile_max, results[i].compile_ns);
+
+        // same state, same pipeline and layout; the layout is shared by all of them
+        uint32_t first = i % VARIANT_COUNT;
+        CHECK(results[i].pipeline == results[first].pipeline);
+        CHECK(results[i].layout == results[0].layout);
+
+        for(uint32_t v = 0; v < first; v++)
+            CHECK(results[i].pipeline != results[v].pipeline);
+    }
+
+    // the batch stats are the per-pipeline timings summed up
+    CHECK(stats.compile_ns == compile_sum);
+    CHECK(stats.max_compile_ns == compile_max);
+    CHECK(stats.max_compile_ns <= stats.compile_ns);
+    CHECK(stats.merge_ns <= stats.wall_ns);
+
+    PipelineObjectCacheStats obj_stats;
+    pipeline_object_cache_get_stats(&obj_cache, &obj_stats);
+    // workers racing on one state may both build it, the loser's pipeline is dropped
+    CHECK(obj_stats.hits + obj_stats.misses == DESC_COUNT);
+    CHECK(obj_stats.misses >= VARIANT_COUNT);
+    CHECK(arrlen(obj_cache.entries) == VARIANT_COUNT);
+    uint64_t first_misses = obj_stats.misses;
+
+    // the worker caches were merged back, so the compiled pipelines are in the cache now
+    CHECK(cache_data_size(vk.device, cache) > seed_size);
+
+    // a second batch is served entirely from the object cache
+    PipelineBatchResult again[DESC_COUNT];
+    pipeline_batch_compile(vk.device, cache, NULL, &desc_cache, &pipe_cache, &obj_cache, descs, DESC_COUNT, WORKER_COUNT, again, NULL);
+    for(uint32_t i = 0; i < DESC_COUNT; i++)
+        CHECK(again[i].pipeline == results[i].pipeline);
+
+    pipeline_object_cache_get_stats(&obj_cache, &obj_stats);
+    CHECK(obj_stats.misses == first_misses);
+
+    pipeline_object_cache_destroy(vk.device, &obj_cache);
+    pipeline_layout_cache_destroy(vk.device, &pipe_cache);
+    descriptor_layout_cache_destroy(vk.device, &desc_cache);
+    vkDestroyPipelineCache(vk.device, cache, NULL);
+    headless_destroy(&vk);
+
+    if(failures)
+    {
+        printf("pipeline_batch_test: %u checks failed\n", failures);
+        return 1;
+    }
+    printf("pipeline_batch_test: ok\n");
+    return 0;
+}
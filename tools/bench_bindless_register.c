@@ -0,0 +1,130 @@
+// Bindless texture registration per second, descriptor pool backend
+// against the descriptor buffer backend.
+//
+//   make bench   (or tools/bench_bindless_register on its own)
+//
+// bindless_init picks the backend from the device, so each backend gets its
+// own headless device: one without VK_EXT_descriptor_buffer and one with it.
+// Both need VK_KHR_maintenance5 for the buffer usage flags of
+// res_create_buffer. A round registers the same view in every texture slot;
+// the slot counter is then rewound, there is no unregistration to time.
+
+#include "headless.h"
+#include "vk_descriptor_bindless.h"
+
+#define BENCH_MIN_NS (200ull * 1000ull * 1000ull)  // per backend
+
+typedef struct SampledImage
+{
+    VkImage       image;
+    VmaAllocation allocation;
+    VkImageView   view;
+} SampledImage;
+
+static void sampled_image_create(ResourceAllocator* ra, VkDevice device, SampledImage* out)
+{
+    VkImageCreateInfo image_info = {
+        .sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .imageType     = VK_IMAGE_TYPE_2D,
+        .format        = VK_FORMAT_R8G8B8A8_UNORM,
+        .extent        = {4, 4, 1},
+        .mipLevels     = 1,
+        .arrayLayers   = 1,
+        .samples       = VK_SAMPLE_COUNT_1_BIT,
+        .tiling        = VK_IMAGE_TILING_OPTIMAL,
+        .usage         = VK_IMAGE_USAGE_SAMPLED_BIT,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+    };
+    VmaAllocationCreateInfo alloc_info = {.usage = VMA_MEMORY_USAGE_AUTO};
+    VK_CHECK(vmaCreateImage(ra->allocator, &image_info, &alloc_info, &out->image, &out->allocation, NULL));
+
+    VkImageViewCreateInfo view_info = {
+        .sType            = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .image            = out->image,
+        .viewType         = VK_IMAGE_VIEW_TYPE_2D,
+        .format           = image_info.format,
+        .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1},
+    };
+    VK_CHECK(vkCreateImageView(device, &view_info, NULL, &out->view));
+}
+
+static void sampled_image_destroy(ResourceAllocator* ra, VkDevice device, SampledImage* img)
+{
+    vkDestroyImageView(device, img->view, NULL);
+    vmaDestroyImage(ra->allocator, img->image, img->allocation);
+}
+
+static void run_backend(bool descriptor_buffer)
+{
+    VkPhysicalDeviceDescriptorBufferFeaturesEXT buffer_features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_FEATURES_EXT,
+    };
+    VkPhysicalDeviceMaintenance5FeaturesKHR maintenance5_features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MAINTENANCE_5_FEATURES_KHR,
+        .pNext = descriptor_buffer ? &buffer_features : NULL,
+    };
+    const char* extensions[] = {VK_KHR_MAINTENANCE_5_EXTENSION_NAME, VK_EXT_DESCRIPTOR_BUFFER_EXTENSION_NAME};
+
+    const char* name = descriptor_buffer ? "descriptor buffer" : "descriptor pool";
+
+    Headless vk;
+    if(!headless_init(&vk, extensions, descriptor_buffer ? 2 : 1, &maintenance5_features))
+        return;
+
+    if(!headless_has_extension(&vk, VK_KHR_MAINTENANCE_5_EXTENSION_NAME)
+       || (descriptor_buffer && !headless_has_extension(&vk, VK_EXT_DESCRIPTOR_BUFFER_EXTENSION_NAME)))
+    {
+        printf("%18s: not supported, skipped\n", name);
+        headless_destroy(&vk);
+        return;
+    }
+
+    ResourceAllocator      ra;
+    VmaAllocatorCreateInfo vma_info = {
+        .physicalDevice = vk.physical,
+        .device         = vk.device,
+        .instance       = vk.instance,
+    };
+    res_init(vk.instance, vk.device, vk.physical, &ra, vma_info);
+
+    SampledImage image;
+    sampled_image_create(&ra, vk.device, &image);
+
+    BindlessDescriptorSystem sys;
+    bindless_init(&sys, vk.device, vk.physical, &ra, false);  // headless_init turns robustBufferAccess off
+
+    bool ok = sys.use_descriptor_buffer == descriptor_buffer;
+    if(!ok)
+        printf("%18s: bindless_init picked the other backend, skipped\n", name);
+
+    uint64_t registered = 0;
+    uint64_t elapsed    = 0;
+    while(ok && elapsed < BENCH_MIN_NS)
+    {
+        sys.next_texture_idx = 0;
+
+        uint64_t start = time_now_ns();
+        for(uint32_t i = 0; i < BINDLESS_MAX_TEXTURES; i++)
+            bindless_register_texture(&sys, image.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_FORMAT_R8G8B8A8_UNORM);
+        elapsed += time_now_ns() - start;
+
+        registered += BINDLESS_MAX_TEXTURES;
+    }
+
+    if(ok)
+        printf("%18s: %14.0f registrations/s %10.1f ns each\n", name, (double)registered * 1e9 / (double)elapsed,
+               (double)elapsed / (double)registered);
+
+    bindless_destroy(&sys);
+    sampled_image_destroy(&ra, vk.device, &image);
+    res_deinit(&ra);
+    headless_destroy(&vk);
+}
+
+int main(void)
+{
+    // each run creates and loads its own device, volk then points at that one
+    run_backend(false);
+    run_backend(true);
+    return 0;
+}
@@ -0,0 +1,220 @@
+// Layout caches under contention: descriptor set layouts through
+// get_or_create_set_layout and pipeline layouts through
+// pipeline_layout_cache_get, shared by up to one thread per core.
+//
+//   make bench   (or tools/bench_cache_threads on its own)
+//
+// The miss phase releases every thread at once on the same empty caches,
+// all walking the keys in the same order so they race to insert each one.
+// Every thread must get back the same handle for a key and each cache must
+// end up with one entry per key, otherwise the run fails. The hit phase
+// then measures lookups per second at 1, 2, 4... threads.
+
+#include "headless.h"
+#include "vk_pipeline_layout.h"
+
+#define KEY_COUNT 4096u
+#define MAX_THREADS 32u
+#define BENCH_MIN_NS (200ull * 1000ull * 1000ull)  // per measurement
+#define BENCH_BATCH 256u
+
+typedef struct LayoutDesc
+{
+    VkDescriptorSetLayoutBinding bindings[4];
+    uint32_t                     binding_count;
+    VkPushConstantRange          push;
+} LayoutDesc;
+
+typedef struct Shared
+{
+    VkDevice              device;
+    DescriptorLayoutCache desc_cache;
+    PipelineLayoutCache   pipe_cache;
+    const LayoutDesc*     descs;
+    uint32_t              go;  // threads spin until it is set
+} Shared;
+
+typedef struct Worker
+{
+    Shared*  shared;
+    uint32_t index;
+    Thread   thread;
+
+    // miss phase, per key
+    VkDescriptorSetLayout* set_layouts;
+    VkPipelineLayout*      pipe_layouts;
+
+    // hit phase
+    uint64_t lookups;
+    uint64_t elapsed_ns;
+} Worker;
+
+// distinct for every i below KEY_COUNT
+static void make_layout(uint32_t i, LayoutDesc* out)
+{
+    out->binding_count = 1 + i % 4;
+    for(uint32_t b = 0; b < out->binding_count; b++)
+    {
+        out->bindings[b] = (VkDescriptorSetLayoutBinding){
+            .binding         = b,
+            .descriptorType  = (b & 1) ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+            .descriptorCount = 1,
+            .stageFlags      = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+        };
+    }
+    out->bindings[out->binding_count - 1].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    out->bindings[out->binding_count - 1].descriptorCount = 1 + i / 4;
+
+    out->push = (VkPushConstantRange){
+        .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+        .size       = 16 + 16 * (i % 4),
+    };
+}
+
+static VkPipelineLayout lookup(Shared* s, uint32_t key, VkDescriptorSetLayout* out_set)
+{
+    const LayoutDesc* d = &s->descs[key];
+
+    VkDescriptorSetLayout set = get_or_create_set_layout(s->device, &s->desc_cache, d->bindings, d->binding_count);
+    if(out_set)
+        *out_set = set;
+    return pipeline_layout_cache_get(s->device, &s->pipe_cache, &set, 1, &d->push, 1);
+}
+
+static void wait_for_go(Shared* s)
+{
+    while(!ATOMIC_LOAD_ACQUIRE(&s->go))
+        ;
+}
+
+static void* miss_worker(void* arg)
+{
+    Worker* w = arg;
+    wait_for_go(w->shared);
+
+    for(uint32_t k = 0; k < KEY_COUNT; k++)
+        w->pipe_layouts[k] = lookup(w->shared, k, &w->set_layouts[k]);
+    return NULL;
+}
+
+static void* hit_worker(void* arg)
+{
+    Worker*  w     = arg;
+    uint32_t state = 0x9e3779b9u * (w->index + 1);
+    wait_for_go(w->shared);
+
+    uint64_t start = time_now_ns();
+    while(w->elapsed_ns < BENCH_MIN_NS)
+    {
+        for(uint32_t i = 0; i < BENCH_BATCH; i++)
+        {
+            // xorshift32
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            if(lookup(w->shared, state % KEY_COUNT, NULL) == VK_NULL_HANDLE)
+                abort();
+        }
+        w->lookups += BENCH_BATCH;
+        w->elapsed_ns = time_now_ns() - start;
+    }
+    return NULL;
+}
+
+static void run_workers(Shared* s, Worker* workers, uint32_t count, ThreadFn fn)
+{
+    ATOMIC_STORE_RELEASE(&s->go, 0u);
+    for(uint32_t i = 0; i < count; i++)
+    {
+        workers[i].shared = s;
+        workers[i].index  = i;
+        if(!thread_create(&workers[i].thread, fn, &workers[i]))
+        {
+            log_error("bench_cache_threads: thread_create failed");
+            abort();
+        }
+    }
+
+    ATOMIC_STORE_RELEASE(&s->go, 1u);
+    for(uint32_t i = 0; i < count; i++)
+        thread_join(&workers[i].thread);
+}
+
+int main(void)
+{
+    Headless vk;
+    if(!headless_init(&vk, NULL, 0, NULL))
+        return 1;
+
+    uint32_t threads = CLAMP(thread_cpu_count(), 2u, MAX_THREADS);
+
+    LayoutDesc* descs = malloc(KEY_COUNT * sizeof(LayoutDesc));
+    for(uint32_t k = 0; k < KEY_COUNT; k++)
+        make_layout(k, &descs[k]);
+
+    Shared shared = {.device = vk.device, .descs = descs};
+    descriptor_layout_cache_init(&shared.desc_cache);
+    pipeline_layout_cache_init(&shared.pipe_cache);
+
+    Worker workers[MAX_THREADS] = {0};
+    for(uint32_t i = 0; i < threads; i++)
+    {
+        workers[i].set_layouts  = malloc(KEY_COUNT * sizeof(VkDescriptorSetLayout));
+        workers[i].pipe_layouts = malloc(KEY_COUNT * sizeof(VkPipelineLayout));
+    }
+
+    // miss phase: every key is inserted by all threads at once
+    uint64_t start = time_now_ns();
+    run_workers(&shared, workers, threads, miss_worker);
+    uint64_t miss_ns = time_now_ns() - start;
+
+    uint32_t mismatches = 0;
+    for(uint32_t k = 0; k < KEY_COUNT; k++)
+    {
+        for(uint32_t i = 1; i < threads; i++)
+        {
+            if(workers[i].set_layouts[k] != workers[0].set_layouts[k] || workers[i].pipe_layouts[k] != workers[0].pipe_layouts[k])
+                mismatches++;
+        }
+    }
+
+    uint32_t set_entries  = (uint32_t)arrlen(shared.desc_cache.entries);
+    uint32_t pipe_entries = (uint32_t)arrlen(shared.pipe_cache.entries);
+
+    printf("%u threads inserting %u keys: %.1f ms, %u set layouts, %u pipeline layouts, %u mismatched handles\n", threads,
+           KEY_COUNT, (double)miss_ns / 1e6, set_entries, pipe_entries, mismatches);
+
+    bool ok = mismatches == 0 && set_entries == KEY_COUNT && pipe_entries == KEY_COUNT;
+    if(!ok)
+        printf("FAILED: concurrent inserts of one key returned more than one handle\n");
+
+    // hit phase
+    printf("%8s %18s %18s\n", "threads", "lookups/s", "per thread");
+    for(uint32_t count = 1; ok && count <= threads; count *= 2)
+    {
+        for(uint32_t i = 0; i < count; i++)
+        {
+            workers[i].lookups    = 0;
+            workers[i].elapsed_ns = 0;
+        }
+        run_workers(&shared, workers, count, hit_worker);
+
+        double rate = 0.0;
+        for(uint32_t i = 0; i < count; i++)
+            rate += (double)workers[i].lookups * 1e9 / (double)workers[i].elapsed_ns;
+
+        printf("%8u %18.0f %18.0f\n", count, rate, rate / count);
+    }
+
+    for(uint32_t i = 0; i < threads; i++)
+    {
+        free(workers[i].set_layouts);
+        free(workers[i].pipe_layouts);
+    }
+    pipeline_layout_cache_destroy(vk.device, &shared.pipe_cache);
+    descriptor_layout_cache_destroy(vk.device, &shared.desc_cache);
+    free(descs);
+
+    headless_destroy(&vk);
+    return ok ? 0 : 1;
+}
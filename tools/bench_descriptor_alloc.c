@@ -0,0 +1,152 @@
+// Descriptor set allocation per set against batched, through the
+// allocator manager.
+//
+//   make bench   (or tools/bench_descriptor_alloc on its own)
+//
+// Every frame allocates the same mix of sets over a few layouts, then the
+// manager is reset. The sets are allocated one descriptor_manager_allocate
+// call at a time, with one descriptor_manager_allocate_n call per layout,
+// or with a single descriptor_manager_allocate_many call for all of them.
+// The first frame of each run grows the pools and is not timed.
+
+#include "headless.h"
+#include "vk_descriptor.h"
+
+#define LAYOUT_COUNT 4u
+#define SETS_PER_LAYOUT 1024u
+#define SETS_PER_FRAME (LAYOUT_COUNT * SETS_PER_LAYOUT)
+#define BENCH_MIN_NS (200ull * 1000ull * 1000ull)  // per measurement
+
+typedef enum AllocMode
+{
+    ALLOC_PER_SET,
+    ALLOC_PER_LAYOUT,
+    ALLOC_ALL,
+    ALLOC_MODE_COUNT,
+} AllocMode;
+
+static const char* mode_names[ALLOC_MODE_COUNT] = {
+    "allocate (per set)",
+    "allocate_n (per layout)",
+    "allocate_many (per frame)",
+};
+
+typedef struct Frame
+{
+    VkDescriptorSetLayoutCreateInfo layouts[LAYOUT_COUNT];
+    VkDescriptorSetLayoutCreateInfo infos[SETS_PER_FRAME];  // interleaved, like draws of mixed materials
+    VkDescriptorSet                 sets[SETS_PER_FRAME];
+} Frame;
+
+static const VkDescriptorSetLayoutBinding camera_bindings[] = {
+    {0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, NULL},
+};
+static const VkDescriptorSetLayoutBinding material_bindings[] = {
+    {0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, NULL},
+    {1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4, VK_SHADER_STAGE_FRAGMENT_BIT, NULL},
+};
+static const VkDescriptorSetLayoutBinding object_bindings[] = {
+    {0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, NULL},
+    {1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, NULL},
+};
+static const VkDescriptorSetLayoutBinding compute_bindings[] = {
+    {0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT, NULL},
+    {1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, NULL},
+    {2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, NULL},
+};
+
+static void frame_init(Frame* f)
+{
+    const VkDescriptorSetLayoutBinding* bindings[LAYOUT_COUNT] = {camera_bindings, material_bindings, object_bindings,
+                                                                  compute_bindings};
+    const uint32_t counts[LAYOUT_COUNT] = {1, 2, 2, 3};
+
+    for(uint32_t l = 0; l < LAYOUT_COUNT; l++)
+    {
+        f->layouts[l] = (VkDescriptorSetLayoutCreateInfo){
+            .sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+            .bindingCount = counts[l],
+            .pBindings    = bindings[l],
+        };
+    }
+
+    for(uint32_t i = 0; i < SETS_PER_FRAME; i++)
+        f->infos[i] = f->layouts[i % LAYOUT_COUNT];
+}
+
+static void allocate_frame(DescriptorAllocatorManager* m, DescriptorLayoutCache* cache, Frame* f, AllocMode mode)
+{
+    switch(mode)
+    {
+        case ALLOC_PER_SET:
+            for(uint32_t i = 0; i < SETS_PER_FRAME; i++)
+                VK_CHECK(descriptor_manager_allocate(m, cache, &f->infos[i], &f->sets[i]));
+            break;
+        case ALLOC_PER_LAYOUT:
+            for(uint32_t l = 0; l < LAYOUT_COUNT; l++)
+                VK_CHECK(descriptor_manager_allocate_n(m, cache, &f->layouts[l], SETS_PER_LAYOUT, &f->sets[l * SETS_PER_LAYOUT]));
+            break;
+        case ALLOC_ALL:
+            VK_CHECK(descriptor_manager_allocate_many(m, cache, f->infos, SETS_PER_FRAME, f->sets));
+            break;
+        default:
+            break;
+    }
+}
+
+int main(void)
+{
+    Headless vk;
+    if(!headless_init(&vk, NULL, 0, NULL))
+        return 1;
+
+    Frame* frame = malloc(sizeof(Frame));
+    frame_init(frame);
+
+    DescriptorLayoutCache cache;
+    descriptor_layout_cache_init(&cache);
+
+    printf("%u sets per frame over %u layouts\n", SETS_PER_FRAME, LAYOUT_COUNT);
+    printf("%26s %14s %12s %8s\n", "", "sets/s", "us/frame", "pools");
+
+    double per_set_rate = 0.0;
+    for(uint32_t mode = 0; mode < ALLOC_MODE_COUNT; mode++)
+    {
+        DescriptorAllocatorManager m;
+        descriptor_allocator_manager_init(&m, vk.device);
+
+        // warm up: pools grow to the frame's size
+        allocate_frame(&m, &cache, frame, mode);
+        descriptor_allocator_manager_reset(&m);
+
+        uint64_t frames  = 0;
+        uint64_t elapsed = 0;
+        while(elapsed < BENCH_MIN_NS)
+        {
+            uint64_t start = time_now_ns();
+            allocate_frame(&m, &cache, frame, mode);
+            elapsed += time_now_ns() - start;
+
+            descriptor_allocator_manager_reset(&m);
+            frames++;
+        }
+
+        DescriptorAllocatorStats stats;
+        descriptor_allocator_manager_get_stats(&m, &stats);
+
+        double rate = (double)(frames * SETS_PER_FRAME) * 1e9 / (double)elapsed;
+        if(mode == ALLOC_PER_SET)
+            per_set_rate = rate;
+
+        printf("%26s %14.0f %12.1f %8llu  %.2fx\n", mode_names[mode], rate, (double)elapsed / (double)frames / 1e3,
+               (unsigned long long)stats.pools_created, rate / per_set_rate);
+
+        descriptor_allocator_manager_destroy(&m);
+    }
+
+    descriptor_layout_cache_destroy(vk.device, &cache);
+    free(frame);
+
+    headless_destroy(&vk);
+    return 0;
+}
@@ -0,0 +1,174 @@
+// Descriptor set layout lookups per second, hashed cache against the old
+// linear scan, at 100 to 100k cached layouts.
+//
+//   make bench   (or tools/bench_layout_cache on its own)
+//
+// The linear baseline is the lookup the cache used to do: build a fixed
+// size key, hash it, then memcmp every entry until one matches. Both sides
+// look up the same keys in the same order, and every lookup is a hit.
+
+#include "headless.h"
+#include "vk_descriptor.h"
+
+#define LINEAR_MAX_BINDINGS 16
+#define BENCH_MIN_NS (200ull * 1000ull * 1000ull)  // per measurement
+#define BENCH_BATCH 256u
+
+// the layout cache key before it was hashed and interned
+typedef struct LinearKey
+{
+    uint32_t                     binding_count;
+    VkDescriptorSetLayoutBinding bindings[LINEAR_MAX_BINDINGS];
+    uint32_t                     hash;
+} LinearKey;
+
+typedef struct LinearEntry
+{
+    LinearKey             key;
+    VkDescriptorSetLayout layout;
+} LinearEntry;
+
+typedef struct LayoutDesc
+{
+    VkDescriptorSetLayoutBinding bindings[8];
+    uint32_t                     binding_count;
+} LayoutDesc;
+
+static const VkDescriptorType bench_types[] = {
+    VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+    VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+    VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+    VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+};
+
+// distinct for every i: the binding count is i % 8, the last array size i / 8
+static void make_layout(uint32_t i, LayoutDesc* out)
+{
+    out->binding_count = 1 + i % 8;
+    for(uint32_t b = 0; b < out->binding_count; b++)
+    {
+        out->bindings[b] = (VkDescriptorSetLayoutBinding){
+            .binding         = b,
+            .descriptorType  = bench_types[(i + b) % 4],
+            .descriptorCount = 1,
+            .stageFlags      = (b & 1) ? VK_SHADER_STAGE_FRAGMENT_BIT : VK_SHADER_STAGE_VERTEX_BIT,
+        };
+    }
+    out->bindings[out->binding_count - 1].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    out->bindings[out->binding_count - 1].descriptorCount = 1 + i / 8;
+}
+
+static VkDescriptorSetLayout linear_find(const LinearEntry* entries, const LayoutDesc* desc)
+{
+    LinearKey key = {0};
+    key.binding_count = desc->binding_count;
+    memcpy(key.bindings, desc->bindings, desc->binding_count * sizeof(VkDescriptorSetLayoutBinding));
+    key.hash = hash32_bytes(key.bindings, key.binding_count * sizeof(VkDescriptorSetLayoutBinding)) ^ key.binding_count;
+
+    for(int i = 0; i < arrlen(entries); i++)
+    {
+        const LinearEntry* e = &entries[i];
+        if(e->key.hash == key.hash && e->key.binding_count == key.binding_count
+           && memcmp(e->key.bindings, key.bindings, key.binding_count * sizeof(VkDescriptorSetLayoutBinding)) == 0)
+            return e->layout;
+    }
+    return VK_NULL_HANDLE;
+}
+
+static uint32_t next_index(uint32_t* state, uint32_t count)
+{
+    // xorshift32, the same sequence for both lookups
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x % count;
+}
+
+static double run_linear(const LinearEntry* entries, const LayoutDesc* descs, uint32_t count)
+{
+    uint32_t state   = 0x9e3779b9u;
+    uint64_t lookups = 0;
+    uint64_t start   = time_now_ns();
+    uint64_t elapsed = 0;
+
+    while(elapsed < BENCH_MIN_NS)
+    {
+        for(uint32_t i = 0; i < BENCH_BATCH; i++)
+        {
+            if(linear_find(entries, &descs[next_index(&state, count)]) == VK_NULL_HANDLE)
+                abort();
+        }
+        lookups += BENCH_BATCH;
+        elapsed = time_now_ns() - start;
+    }
+    return (double)lookups * 1e9 / (double)elapsed;
+}
+
+static double run_hashed(VkDevice device, DescriptorLayoutCache* cache, const LayoutDesc* descs, uint32_t count)
+{
+    uint32_t state   = 0x9e3779b9u;
+    uint64_t lookups = 0;
+    uint64_t start   = time_now_ns();
+    uint64_t elapsed = 0;
+
+    while(elapsed < BENCH_MIN_NS)
+    {
+        for(uint32_t i = 0; i < BENCH_BATCH; i++)
+        {
+            const LayoutDesc* d = &descs[next_index(&state, count)];
+            if(get_or_create_set_layout(device, cache, d->bindings, d->binding_count) == VK_NULL_HANDLE)
+                abort();
+        }
+        lookups += BENCH_BATCH;
+        elapsed = time_now_ns() - start;
+    }
+    return (double)lookups * 1e9 / (double)elapsed;
+}
+
+int main(void)
+{
+    Headless vk;
+    if(!headless_init(&vk, NULL, 0, NULL))
+        return 1;
+
+    static const uint32_t sizes[] = {100, 1000, 10000, 100000};
+
+    printf("%10s %18s %18s %9s\n", "layouts", "linear lookups/s", "hashed lookups/s", "speedup");
+
+    for(uint32_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        uint32_t    count = sizes[s];
+        LayoutDesc* descs = malloc(count * sizeof(LayoutDesc));
+
+        DescriptorLayoutCache cache;
+        descriptor_layout_cache_init(&cache);
+
+        LinearEntry* linear = NULL;
+        for(uint32_t i = 0; i < count; i++)
+        {
+            make_layout(i, &descs[i]);
+
+            LinearEntry e = {
+                .layout = get_or_create_set_layout(vk.device, &cache, descs[i].bindings, descs[i].binding_count),
+            };
+            e.key.binding_count = descs[i].binding_count;
+            memcpy(e.key.bindings, descs[i].bindings, descs[i].binding_count * sizeof(VkDescriptorSetLayoutBinding));
+            e.key.hash = hash32_bytes(e.key.bindings, e.key.binding_count * sizeof(VkDescriptorSetLayoutBinding)) ^ e.key.binding_count;
+            arrpush(linear, e);
+        }
+
+        double linear_rate = run_linear(linear, descs, count);
+        double hashed_rate = run_hashed(vk.device, &cache, descs, count);
+
+        printf("%10u %18.0f %18.0f %8.1fx\n", count, linear_rate, hashed_rate, hashed_rate / linear_rate);
+
+        arrfree(linear);
+        descriptor_layout_cache_destroy(vk.device, &cache);
+        free(descs);
+    }
+
+    headless_destroy(&vk);
+    return 0;
+}
@@ -0,0 +1,199 @@
+// Pipeline layout lookups while pipelines are being created, hashed
+// pipeline_layout_cache_get against the old linear scan.
+//
+//   make bench   (or tools/bench_pipeline_layout on its own, from the repo root)
+//
+// The cache holds one layout per ordered choice of four out of eight set
+// layouts, the way material permutations fill it. Between the creation of
+// each of a few thousand tri.vert/tri.frag pipelines, the layouts of a
+// handful of materials are looked up, both through the cache and through
+// the old lookup: copy the key, XOR the hashes, memcmp every entry.
+
+#include "headless.h"
+#include "vk_pipelines.h"
+
+#define SET_LAYOUT_COUNT 8u
+#define SETS_PER_KEY 4u
+#define KEY_COUNT 1680u  // 8 * 7 * 6 * 5 ordered choices
+#define PIPELINE_COUNT 2048u
+#define LOOKUPS_PER_PIPELINE 8u
+
+typedef struct LayoutKey
+{
+    VkDescriptorSetLayout sets[SETS_PER_KEY];
+    VkPushConstantRange   push;
+} LayoutKey;
+
+// the pipeline layout cache entry before it was hashed and indexed
+typedef struct LinearEntry
+{
+    VkDescriptorSetLayout set_layouts[8];
+    uint32_t              set_layout_count;
+    VkPushConstantRange   push_constants[4];
+    uint32_t              push_constant_count;
+    Hash64                hash;
+    VkPipelineLayout      layout;
+} LinearEntry;
+
+static Hash64 linear_hash(const LinearEntry* k)
+{
+    Hash64 h = 0;
+    h ^= hash64_bytes(k->set_layouts, k->set_layout_count * sizeof(VkDescriptorSetLayout));
+    h ^= hash64_bytes(k->push_constants, k->push_constant_count * sizeof(VkPushConstantRange));
+    h ^= k->set_layout_count;
+    h ^= k->push_constant_count << 16;
+    return h;
+}
+
+static void linear_key(const LayoutKey* key, LinearEntry* out)
+{
+    memset(out, 0, sizeof(*out));
+    out->set_layout_count = SETS_PER_KEY;
+    memcpy(out->set_layouts, key->sets, sizeof(key->sets));
+    out->push_constant_count = 1;
+    out->push_constants[0]   = key->push;
+    out->hash                = linear_hash(out);
+}
+
+static VkPipelineLayout linear_find(const LinearEntry* entries, const LayoutKey* key)
+{
+    LinearEntry k;
+    linear_key(key, &k);
+
+    for(int i = 0; i < arrlen(entries); i++)
+    {
+        const LinearEntry* e = &entries[i];
+        if(e->hash == k.hash && e->set_layout_count == k.set_layout_count && e->push_constant_count == k.push_constant_count
+           && memcmp(e->set_layouts, k.set_layouts, k.set_layout_count * sizeof(VkDescriptorSetLayout)) == 0
+           && memcmp(e->push_constants, k.push_constants, k.push_constant_count * sizeof(VkPushConstantRange)) == 0)
+            return e->layout;
+    }
+    return VK_NULL_HANDLE;
+}
+
+// every ordered choice of SETS_PER_KEY distinct set layouts
+static uint32_t make_keys(const VkDescriptorSetLayout* sets, LayoutKey* out)
+{
+    uint32_t count = 0;
+    for(uint32_t a = 0; a < SET_LAYOUT_COUNT; a++)
+        for(uint32_t b = 0; b < SET_LAYOUT_COUNT; b++)
+            for(uint32_t c = 0; c < SET_LAYOUT_COUNT; c++)
+                for(uint32_t d = 0; d < SET_LAYOUT_COUNT; d++)
+                {
+                    if(a == b || a == c || a == d || b == c || b == d || c == d)
+                        continue;
+
+                    out[count] = (LayoutKey){
+                        .sets = {sets[a], sets[b], sets[c], sets[d]},
+                        .push = {VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, 64},
+                    };
+                    count++;
+                }
+    return count;
+}
+
+int main(void)
+{
+    Headless vk;
+    if(!headless_init(&vk, NULL, 0, NULL))
+        return 1;
+
+    void*  vert;
+    void*  frag;
+    size_t vert_size, frag_size;
+    if(!read_shader_file("compiledshaders/tri.vert.spv", &vert, &vert_size)
+       || !read_shader_file("compiledshaders/tri.frag.spv", &frag, &frag_size))
+    {
+        log_error("bench_pipeline_layout: run from the repo root after cs.sh");
+        headless_destroy(&vk);
+        return 1;
+    }
+
+    DescriptorLayoutCache desc_cache;
+    PipelineLayoutCache   pipe_cache;
+    descriptor_layout_cache_init(&desc_cache);
+    pipeline_layout_cache_init(&pipe_cache);
+
+    VkDescriptorSetLayout sets[SET_LAYOUT_COUNT];
+    for(uint32_t i = 0; i < SET_LAYOUT_COUNT; i++)
+    {
+        VkDescriptorSetLayoutBinding binding = {0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1 + i, VK_SHADER_STAGE_FRAGMENT_BIT, NULL};
+        sets[i] = get_or_create_set_layout(vk.device, &desc_cache, &binding, 1);
+    }
+
+    LayoutKey* keys      = malloc(KEY_COUNT * sizeof(LayoutKey));
+    uint32_t   key_count = make_keys(sets, keys);
+    assert(key_count == KEY_COUNT);
+
+    // both caches start full, only hits are timed
+    LinearEntry* linear = NULL;
+    for(uint32_t k = 0; k < key_count; k++)
+    {
+        LinearEntry e;
+        linear_key(&keys[k], &e);
+        e.layout = pipeline_layout_cache_get(vk.device, &pipe_cache, keys[k].sets, SETS_PER_KEY, &keys[k].push, 1);
+        arrpush(linear, e);
+    }
+
+    static const VkFormat color_format = VK_FORMAT_B8G8R8A8_UNORM;
+
+    uint64_t create_ns = 0, hashed_ns = 0, linear_ns = 0;
+    uint32_t next = 0, created = 0;
+
+    for(uint32_t p = 0; p < PIPELINE_COUNT; p++)
+    {
+        uint64_t start = time_now_ns();
+        for(uint32_t l = 0; l < LOOKUPS_PER_PIPELINE; l++)
+        {
+            const LayoutKey* key = &keys[(next + l * 617u) % key_count];
+            if(pipeline_layout_cache_get(vk.device, &pipe_cache, key->sets, SETS_PER_KEY, &key->push, 1) == VK_NULL_HANDLE)
+                abort();
+        }
+        uint64_t mid = time_now_ns();
+        for(uint32_t l = 0; l < LOOKUPS_PER_PIPELINE; l++)
+        {
+            if(linear_find(linear, &keys[(next + l * 617u) % key_count]) == VK_NULL_HANDLE)
+                abort();
+        }
+        uint64_t end = time_now_ns();
+
+        hashed_ns += mid - start;
+        linear_ns += end - mid;
+        next = (next + 1) % key_count;
+
+        // without an object cache every call builds a new pipeline
+        GraphicsPipelineConfig cfg = graphics_pipeline_config_default();
+        cfg.cull_mode              = (VkCullModeFlags)(p % 4);
+        cfg.color_attachment_count = 1;
+        cfg.color_formats          = &color_format;
+
+        start = time_now_ns();
+        VkPipeline pipeline = create_graphics_pipeline_from_spirv(vk.device, VK_NULL_HANDLE, &desc_cache, &pipe_cache, NULL,
+                                                                  vert, vert_size, frag, frag_size, &cfg, NULL);
+        create_ns += time_now_ns() - start;
+
+        if(pipeline != VK_NULL_HANDLE)
+        {
+            vkDestroyPipeline(vk.device, pipeline, NULL);
+            created++;
+        }
+    }
+
+    uint64_t lookups = (uint64_t)PIPELINE_COUNT * LOOKUPS_PER_PIPELINE;
+
+    printf("%u pipelines created in %.1f ms, %u cached layouts, %llu lookups\n", created, (double)create_ns / 1e6,
+           key_count, (unsigned long long)lookups);
+    printf("%8s %12s %18s\n", "", "ns/lookup", "share of creation");
+    printf("%8s %12.1f %17.2f%%\n", "linear", (double)linear_ns / (double)lookups, 100.0 * (double)linear_ns / (double)create_ns);
+    printf("%8s %12.1f %17.2f%%\n", "hashed", (double)hashed_ns / (double)lookups, 100.0 * (double)hashed_ns / (double)create_ns);
+
+    arrfree(linear);
+    free(keys);
+    free(vert);
+    free(frag);
+    pipeline_layout_cache_destroy(vk.device, &pipe_cache);
+    descriptor_layout_cache_destroy(vk.device, &desc_cache);
+
+    headless_destroy(&vk);
+    return 0;
+}
@@ -0,0 +1,129 @@
+// Graphics pipeline library fast-link against full compiles.
+//
+//   make bench   (or tools/bench_pipeline_library on its own, from the repo root)
+//
+// Builds every permutation of cull mode, front face, topology and color
+// format over tri.vert/tri.frag three times: as monolithic pipelines, then
+// fast-linked while the library parts are still being compiled, then
+// fast-linked again from cached parts only. The background optimized
+// relink is off so it doesn't compete for the CPU. Skipped on devices
+// without VK_EXT_graphics_pipeline_library.
+
+#include "headless.h"
+#include "vk_pipeline_library.h"
+
+#define PERMUTATION_COUNT (4u * 2u * 3u * 2u)
+
+static const VkPrimitiveTopology topologies[3] = {
+    VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+    VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP,
+    VK_PRIMITIVE_TOPOLOGY_LINE_LIST,
+};
+static const VkFormat color_formats[2] = {VK_FORMAT_B8G8R8A8_UNORM, VK_FORMAT_R16G16B16A16_SFLOAT};
+
+static GraphicsPipelineConfig permutation(uint32_t i, PipelineLibraryCache* libraries)
+{
+    GraphicsPipelineConfig cfg = graphics_pipeline_config_default();
+    cfg.cull_mode              = (VkCullModeFlags)(i % 4);
+    cfg.front_face             = (i / 4) % 2 ? VK_FRONT_FACE_COUNTER_CLOCKWISE : VK_FRONT_FACE_CLOCKWISE;
+    cfg.topology               = topologies[(i / 8) % 3];
+    cfg.color_attachment_count = 1;
+    cfg.color_formats          = &color_formats[(i / 24) % 2];
+    cfg.libraries              = libraries;
+    return cfg;
+}
+
+typedef struct Shaders
+{
+    void*  vert;
+    void*  frag;
+    size_t vert_size;
+    size_t frag_size;
+} Shaders;
+
+// average ns per pipeline; pipelines go to out, the caller destroys them
+static double build_all(VkDevice               device,
+                        DescriptorLayoutCache* desc_cache,
+                        PipelineLayoutCache*   pipe_cache,
+                        const Shaders*         s,
+                        PipelineLibraryCache*  libraries,
+                        VkPipeline*            out)
+{
+    uint64_t start = time_now_ns();
+    for(uint32_t i = 0; i < PERMUTATION_COUNT; i++)
+    {
+        GraphicsPipelineConfig cfg = permutation(i, libraries);
+        out[i] = create_graphics_pipeline_from_spirv(device, VK_NULL_HANDLE, desc_cache, pipe_cache, NULL, s->vert,
+                                                     s->vert_size, s->frag, s->frag_size, &cfg, NULL);
+        if(out[i] == VK_NULL_HANDLE)
+            abort();
+    }
+    return (double)(time_now_ns() - start) / PERMUTATION_COUNT;
+}
+
+int main(void)
+{
+    VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT gpl_features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT,
+    };
+    const char* extensions[] = {VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME, VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME};
+
+    Headless vk;
+    if(!headless_init(&vk, extensions, 2, &gpl_features))
+        return 1;
+
+    if(!headless_has_extension(&vk, VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME)
+       || !headless_has_extension(&vk, VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME) || !pipeline_library_supported(vk.physical))
+    {
+        printf("bench_pipeline_library: graphics pipeline libraries not supported, skipped\n");
+        headless_destroy(&vk);
+        return 0;
+    }
+
+    Shaders s;
+    if(!read_shader_file("compiledshaders/tri.vert.spv", &s.vert, &s.vert_size)
+       || !read_shader_file("compiledshaders/tri.frag.spv", &s.frag, &s.frag_size))
+    {
+        log_error("bench_pipeline_library: run from the repo root after cs.sh");
+        headless_destroy(&vk);
+        return 1;
+    }
+
+    DescriptorLayoutCache desc_cache;
+    PipelineLayoutCache   pipe_cache;
+    PipelineLibraryCache  libraries;
+    descriptor_layout_cache_init(&desc_cache);
+    pipeline_layout_cache_init(&pipe_cache);
+    pipeline_library_cache_init(&libraries, vk.device, VK_NULL_HANDLE, false);
+
+    // fast-linked pipelines stay alive until the library cache is gone, see vk_pipeline_library.h
+    VkPipeline full[PERMUTATION_COUNT], cold[PERMUTATION_COUNT], warm[PERMUTATION_COUNT];
+
+    double full_ns = build_all(vk.device, &desc_cache, &pipe_cache, &s, NULL, full);
+    double cold_ns = build_all(vk.device, &desc_cache, &pipe_cache, &s, &libraries, cold);
+    double warm_ns = build_all(vk.device, &desc_cache, &pipe_cache, &s, &libraries, warm);
+
+    PipelineLibraryStats stats;
+    pipeline_library_get_stats(&libraries, &stats);
+
+    printf("%u permutations, %llu library parts compiled\n", PERMUTATION_COUNT, (unsigned long long)stats.part_misses);
+    printf("%24s %12s %9s\n", "", "us/pipeline", "speedup");
+    printf("%24s %12.1f %8.1fx\n", "full compile", full_ns / 1e3, 1.0);
+    printf("%24s %12.1f %8.1fx\n", "link, compiling parts", cold_ns / 1e3, full_ns / cold_ns);
+    printf("%24s %12.1f %8.1fx\n", "link, cached parts", warm_ns / 1e3, full_ns / warm_ns);
+
+    pipeline_library_cache_destroy(&libraries);
+    for(uint32_t i = 0; i < PERMUTATION_COUNT; i++)
+    {
+        vkDestroyPipeline(vk.device, full[i], NULL);
+        vkDestroyPipeline(vk.device, cold[i], NULL);
+        vkDestroyPipeline(vk.device, warm[i], NULL);
+    }
+    pipeline_layout_cache_destroy(vk.device, &pipe_cache);
+    descriptor_layout_cache_destroy(vk.device, &desc_cache);
+    free(s.vert);
+    free(s.frag);
+
+    headless_destroy(&vk);
+    return 0;
+}
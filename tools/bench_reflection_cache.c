@@ -0,0 +1,121 @@
+// Startup layout construction with a cold and a warm reflection cache.
+//
+//   make bench   (or tools/bench_reflection_cache [stage.spv...] from the repo root)
+//
+// A startup opens the cache file, builds the pipeline layout of the given
+// stages (one pipeline, tri.vert/tri.frag by default) through
+// shader_reflect_build_pipeline_layout, saves the cache and closes it.
+// Cold startups begin without the file, so every stage goes through
+// SPIRV-Reflect; warm startups find the file the previous one saved.
+// Descriptor and pipeline layout caches start empty each time, as they
+// would in a new process.
+
+#include "headless.h"
+#include "vk_pipelines.h"
+#include "vk_reflection_cache.h"
+
+#define STARTUP_RUNS 50u
+#define MAX_STAGES 8u
+#define CACHE_PATH "bench_reflection.cache"
+
+typedef struct Stages
+{
+    void*    code[MAX_STAGES];
+    size_t   size[MAX_STAGES];
+    uint32_t count;
+} Stages;
+
+typedef struct StartupResult
+{
+    uint64_t ns;
+    uint64_t reflect_ns;
+    uint64_t hits;
+    uint64_t misses;
+} StartupResult;
+
+static void startup(VkDevice device, const Stages* stages, StartupResult* out)
+{
+    uint64_t start = time_now_ns();
+
+    ReflectionCache reflections;
+    reflection_cache_open(&reflections, CACHE_PATH);
+
+    DescriptorLayoutCache desc_cache;
+    PipelineLayoutCache   pipe_cache;
+    descriptor_layout_cache_init(&desc_cache);
+    pipeline_layout_cache_init(&pipe_cache);
+
+    VkPipelineLayout layout = shader_reflect_build_pipeline_layout(device, &desc_cache, &pipe_cache, &reflections,
+                                                                   (const void* const*)stages->code, stages->size, stages->count);
+    if(layout == VK_NULL_HANDLE)
+        abort();
+
+    reflection_cache_save(&reflections, CACHE_PATH);
+
+    ReflectionCacheStats stats;
+    reflection_cache_get_stats(&reflections, &stats);
+    reflection_cache_close(&reflections);
+
+    out->ns += time_now_ns() - start;
+    out->reflect_ns += stats.reflect_ns;
+    out->hits += stats.hits;
+    out->misses += stats.misses;
+
+    pipeline_layout_cache_destroy(device, &pipe_cache);
+    descriptor_layout_cache_destroy(device, &desc_cache);
+}
+
+static void print_result(const char* name, const StartupResult* r)
+{
+    printf("%6s %12.1f %16.1f %8llu %8llu\n", name, (double)r->ns / STARTUP_RUNS / 1e3, (double)r->reflect_ns / STARTUP_RUNS / 1e3,
+           (unsigned long long)r->hits, (unsigned long long)r->misses);
+}
+
+int main(int argc, char** argv)
+{
+    static const char* default_stages[] = {"compiledshaders/tri.vert.spv", "compiledshaders/tri.frag.spv"};
+
+    const char* const* paths = argc > 1 ? (const char* const*)argv + 1 : default_stages;
+    uint32_t           count = argc > 1 ? (uint32_t)(argc - 1) : 2;
+    if(count > MAX_STAGES)
+    {
+        fprintf(stderr, "usage: %s [stage.spv...], at most %u stages of one pipeline\n", argv[0], MAX_STAGES);
+        return 1;
+    }
+
+    Stages stages = {.count = count};
+    for(uint32_t i = 0; i < count; i++)
+    {
+        if(!read_shader_file(paths[i], &stages.code[i], &stages.size[i]))
+        {
+            log_error("bench_reflection_cache: cannot read %s", paths[i]);
+            return 1;
+        }
+    }
+
+    Headless vk;
+    if(!headless_init(&vk, NULL, 0, NULL))
+        return 1;
+
+    StartupResult cold = {0}, warm = {0};
+    for(uint32_t i = 0; i < STARTUP_RUNS; i++)
+    {
+        remove(CACHE_PATH);
+        startup(vk.device, &stages, &cold);
+    }
+    for(uint32_t i = 0; i < STARTUP_RUNS; i++)
+        startup(vk.device, &stages, &warm);
+    remove(CACHE_PATH);
+
+    printf("%u stages, %u startups each\n", count, STARTUP_RUNS);
+    printf("%6s %12s %16s %8s %8s\n", "", "us/startup", "us in reflect", "hits", "misses");
+    print_result("cold", &cold);
+    print_result("warm", &warm);
+    printf("warm startups are %.1fx faster\n", (double)cold.ns / (double)warm.ns);
+
+    for(uint32_t i = 0; i < count; i++)
+        free(stages.code[i]);
+
+    headless_destroy(&vk);
+    return 0;
+}
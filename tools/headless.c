@@ -0,0 +1,170 @@
+#include "headless.h"
+#include "vk_startup.h"
+
+static bool has_device_extension(const VkExtensionProperties* props, uint32_t count, const char* name)
+{
+    for(uint32_t i = 0; i < count; i++)
+    {
+        if(strcmp(props[i].extensionName, name) == 0)
+            return true;
+    }
+    return false;
+}
+
+// first device with a queue family that does both graphics and compute
+static bool pick_device(Headless* h)
+{
+    uint32_t count = 0;
+    vkEnumeratePhysicalDevices(h->instance, &count, NULL);
+    if(count == 0)
+        return false;
+
+    VkPhysicalDevice* devices = malloc(count * sizeof(VkPhysicalDevice));
+    vkEnumeratePhysicalDevices(h->instance, &count, devices);
+
+    const VkQueueFlags wanted = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT;
+
+    bool found = false;
+    for(uint32_t i = 0; i < count && !found; i++)
+    {
+        uint32_t family_count = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(devices[i], &family_count, NULL);
+
+        VkQueueFamilyProperties* families = malloc(family_count * sizeof(VkQueueFamilyProperties));
+        vkGetPhysicalDeviceQueueFamilyProperties(devices[i], &family_count, families);
+
+        for(uint32_t f = 0; f < family_count && !found; f++)
+        {
+            if((families[f].queueFlags & wanted) == wanted)
+            {
+                h->physical     = devices[i];
+                h->queue_family = f;
+                found           = true;
+            }
+        }
+
+        free(families);
+    }
+
+    free(devices);
+    return found;
+}
+
+bool headless_init(Headless* h, const char* const* extensions, uint32_t extension_count, void* features)
+{
+    memset(h, 0, sizeof(*h));
+    assert(extension_count <= HEADLESS_MAX_EXTENSIONS);
+
+    if(volkInitialize() != VK_SUCCESS)
+    {
+        log_error("headless: no Vulkan loader");
+        return false;
+    }
+
+    VkApplicationInfo app = {
+        .sType            = VK_STRUCTURE_TYPE_APPLICATION_INFO,
+        .pApplicationName = "vkutil headless",
+        .pEngineName      = "vkutil",
+        .apiVersion       = VK_API_VERSION_1_3,
+    };
+
+    VkInstanceCreateInfo instance_info = {
+        .sType            = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
+        .pApplicationInfo = &app,
+    };
+
+    if(vkCreateInstance(&instance_info, NULL, &h->instance) != VK_SUCCESS)
+    {
+        log_error("headless: vkCreateInstance failed");
+        return false;
+    }
+
+    volkLoadInstanceOnly(h->instance);
+
+    if(!pick_device(h))
+    {
+        log_error("headless: no device with a graphics and compute queue");
+        headless_destroy(h);
+        return false;
+    }
+
+    uint32_t ext_count = 0;
+    vkEnumerateDeviceExtensionProperties(h->physical, NULL, &ext_count, NULL);
+    VkExtensionProperties* ext_props = malloc(MAX(ext_count, 1u) * sizeof(VkExtensionProperties));
+    vkEnumerateDeviceExtensionProperties(h->physical, NULL, &ext_count, ext_props);
+
+    for(uint32_t i = 0; i < extension_count; i++)
+    {
+        if(has_device_extension(ext_props, ext_count, extensions[i]))
+            h->extensions[h->extension_count++] = extensions[i];
+        else
+            log_info("headless: %s not supported, skipped", extensions[i]);
+    }
+    free(ext_props);
+
+    // everything the device supports, the caller's extension features included
+    VkFeatureChain chain;
+    query_device_features(h->physical, &chain);
+    chain.v13.pNext = features;
+    vkGetPhysicalDeviceFeatures2(h->physical, &chain.core);
+
+    // bounds checks only slow the measurements down
+    chain.core.features.robustBufferAccess = VK_FALSE;
+
+    float priority = 1.0f;
+
+    VkDeviceQueueCreateInfo queue_info = {
+        .sType            = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+        .queueFamilyIndex = h->queue_family,
+        .queueCount       = 1,
+        .pQueuePriorities = &priority,
+    };
+
+    VkDeviceCreateInfo device_info = {
+        .sType                   = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+        .pNext                   = &chain.core,
+        .queueCreateInfoCount    = 1,
+        .pQueueCreateInfos       = &queue_info,
+        .enabledExtensionCount   = h->extension_count,
+        .ppEnabledExtensionNames = h->extensions,
+    };
+
+    if(vkCreateDevice(h->physical, &device_info, NULL, &h->device) != VK_SUCCESS)
+    {
+        log_error("headless: vkCreateDevice failed");
+        headless_destroy(h);
+        return false;
+    }
+
+    volkLoadDevice(h->device);
+    vkGetDeviceQueue(h->device, h->queue_family, 0, &h->queue);
+
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(h->physical, &props);
+    log_info("headless: running on %s", props.deviceName);
+
+    return true;
+}
+
+void headless_destroy(Headless* h)
+{
+    if(h->device != VK_NULL_HANDLE)
+    {
+        vkDeviceWaitIdle(h->device);
+        vkDestroyDevice(h->device, NULL);
+    }
+    if(h->instance != VK_NULL_HANDLE)
+        vkDestroyInstance(h->instance, NULL);
+
+    memset(h, 0, sizeof(*h));
+}
+
+bool headless_has_extension(const Headless* h, const char* name)
+{
+    for(uint32_t i = 0; i < h->extension_count; i++)
+    {
+        if(strcmp(h->extensions[i], name) == 0)
+            return true;
+    }
+    return false;
+}
@@ -0,0 +1,43 @@
+#ifndef HEADLESS_H_
+#define HEADLESS_H_
+
+#include "vk_defaults.h"
+
+/* ------------------ Headless device for tools and tests ------------------ */
+//
+// A Vulkan 1.3 instance and device without a window or surface, for the
+// benchmarks under tools/ and the tests under tests/. Runs on any driver,
+// lavapipe included (VK_ICD_FILENAMES=.../lvp_icd.x86_64.json):
+//
+//   Headless vk;
+//   if(!headless_init(&vk, NULL, 0, NULL))
+//       return 1;
+//   ...vk.device...
+//   headless_destroy(&vk);
+//
+// Every supported core 1.0 to 1.3 feature in VkFeatureChain is enabled,
+// except robustBufferAccess. Each of extensions is enabled only when the
+// device has it, check with headless_has_extension. Their feature structs
+// go in features (a pNext chain, may be NULL); they are queried first, so
+// only supported features end up enabled.
+
+#define HEADLESS_MAX_EXTENSIONS 16
+
+typedef struct Headless
+{
+    VkInstance       instance;
+    VkPhysicalDevice physical;
+    VkDevice         device;
+    uint32_t         queue_family;  // graphics and compute
+    VkQueue          queue;
+
+    const char* extensions[HEADLESS_MAX_EXTENSIONS];  // the requested ones that were enabled
+    uint32_t    extension_count;
+} Headless;
+
+bool headless_init(Headless* h, const char* const* extensions, uint32_t extension_count, void* features);
+void headless_destroy(Headless* h);
+
+bool headless_has_extension(const Headless* h, const char* name);
+
+#endif // HEADLESS_H_
@@ -0,0 +1,173 @@
+// Packs SPIR-V files into a shader archive, see vk_shader_archive.h.
+//
+//   shader_pack out.vksa compiledshaders/*.spv
+//
+// Shaders are stored under their file name. The tool is standalone, and
+// xxHash is compiled inline so it needs nothing else from the library.
+
+#define XXH_INLINE_ALL
+#include "vk_shader_archive.h"
+
+#define SPIRV_MAGIC 0x07230203u
+
+typedef struct PackInput
+{
+    const char*        path;
+    const char*        name;
+    uint8_t*           code;
+    size_t             size;
+    ShaderArchiveEntry entry;
+} PackInput;
+
+static const char* base_name(const char* path)
+{
+    const char* slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+static uint8_t* read_file(const char* path, size_t* out_size)
+{
+    FILE* f = fopen(path, "rb");
+    if(!f)
+        return NULL;
+
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    rewind(f);
+
+    uint8_t* data = len > 0 ? malloc((size_t)len) : NULL;
+    if(data && fread(data, 1, (size_t)len, f) != (size_t)len)
+    {
+        free(data);
+        data = NULL;
+    }
+
+    fclose(f);
+    *out_size = data ? (size_t)len : 0;
+    return data;
+}
+
+static int compare_inputs(const void* a, const void* b)
+{
+    const PackInput* x = a;
+    const PackInput* y = b;
+
+    if(x->entry.name_hash != y->entry.name_hash)
+        return x->entry.name_hash < y->entry.name_hash ? -1 : 1;
+    return strcmp(x->name, y->name);
+}
+
+static uint64_t align_up(uint64_t v)
+{
+    return (v + SHADER_ARCHIVE_ALIGN - 1) & ~(uint64_t)(SHADER_ARCHIVE_ALIGN - 1);
+}
+
+int main(int argc, char** argv)
+{
+    if(argc < 3)
+    {
+        fprintf(stderr, "usage: %s out.vksa shader.spv...\n", argv[0]);
+        return 1;
+    }
+
+    uint32_t   count  = (uint32_t)(argc - 2);
+    PackInput* inputs = calloc(count, sizeof(PackInput));
+    int        rc     = 1;
+
+    for(uint32_t i = 0; i < count; i++)
+    {
+        PackInput* in = &inputs[i];
+        in->path      = argv[i + 2];
+        in->name      = base_name(in->path);
+        in->code      = read_file(in->path, &in->size);
+
+        if(!in->code)
+        {
+            fprintf(stderr, "shader_pack: cannot read '%s'\n", in->path);
+            goto done;
+        }
+        if(in->size % 4 != 0 || *(const uint32_t*)in->code != SPIRV_MAGIC)
+        {
+            fprintf(stderr, "shader_pack: '%s' is not SPIR-V\n", in->path);
+            goto done;
+        }
+
+        in->entry.name_hash   = XXH64(in->name, strlen(in->name), 0);
+        in->entry.code_hash   = XXH64(in->code, in->size, 0);
+        in->entry.size        = (uint32_t)in->size;
+        in->entry.name_length = (uint32_t)strlen(in->name);
+    }
+
+    qsort(inputs, count, sizeof(PackInput), compare_inputs);
+
+    // header | entries | names | blobs
+    uint64_t offset = sizeof(ShaderArchiveHeader) + (uint64_t)count * sizeof(ShaderArchiveEntry);
+    for(uint32_t i = 0; i < count; i++)
+    {
+        if(i > 0 && strcmp(inputs[i - 1].name, inputs[i].name) == 0)
+        {
+            fprintf(stderr, "shader_pack: '%s' and '%s' share a name\n", inputs[i - 1].path, inputs[i].path);
+            goto done;
+        }
+
+        inputs[i].entry.name_offset = (uint32_t)offset;
+        offset += inputs[i].entry.name_length + 1;
+    }
+    for(uint32_t i = 0; i < count; i++)
+    {
+        offset                 = align_up(offset);
+        inputs[i].entry.offset = (uint32_t)offset;
+        offset += inputs[i].size;
+    }
+
+    if(offset > UINT32_MAX)
+    {
+        fprintf(stderr, "shader_pack: archive exceeds 4 GiB\n");
+        goto done;
+    }
+
+    FILE* out = fopen(argv[1], "wb");
+    if(!out)
+    {
+        fprintf(stderr, "shader_pack: cannot write '%s'\n", argv[1]);
+        goto done;
+    }
+
+    ShaderArchiveHeader header = {
+        .magic       = SHADER_ARCHIVE_MAGIC,
+        .version     = SHADER_ARCHIVE_VERSION,
+        .entry_count = count,
+        .file_size   = offset,
+    };
+    fwrite(&header, sizeof(header), 1, out);
+
+    for(uint32_t i = 0; i < count; i++)
+        fwrite(&inputs[i].entry, sizeof(ShaderArchiveEntry), 1, out);
+    for(uint32_t i = 0; i < count; i++)
+        fwrite(inputs[i].name, inputs[i].entry.name_length + 1, 1, out);
+
+    static const uint8_t zeros[SHADER_ARCHIVE_ALIGN] = {0};
+    for(uint32_t i = 0; i < count; i++)
+    {
+        long pad = (long)inputs[i].entry.offset - ftell(out);
+        fwrite(zeros, 1, (size_t)pad, out);
+        fwrite(inputs[i].code, 1, inputs[i].size, out);
+    }
+
+    bool written = !ferror(out);
+    if(fclose(out) != 0 || !written)
+    {
+        fprintf(stderr, "shader_pack: failed writing '%s'\n", argv[1]);
+        remove(argv[1]);
+        goto done;
+    }
+
+    rc = 0;
+    printf("shader_pack: %u shaders, %llu bytes -> %s\n", count, (unsigned long long)offset, argv[1]);
+
+done:
+    for(uint32_t i = 0; i < count; i++)
+        free(inputs[i].code);
+    free(inputs);
+    return rc;
+}
@@ -0,0 +1,106 @@
+#include "vk_compute.h"
+
+// must match the push constant block of shaders/dispatch_args.comp
+typedef struct DispatchArgsPush
+{
+    VkDeviceAddress counts;
+    VkDeviceAddress args;
+    uint32_t        entry_count;
+    uint32_t        group_size;
+    uint32_t        max_group_count;
+    uint32_t        pad;
+} DispatchArgsPush;
+
+static uint32_t group_count(uint32_t items, uint32_t local_size)
+{
+    // no overflow near UINT32_MAX items, unlike (items + local_size - 1) / local_size
+    return items / local_size + (items % local_size != 0);
+}
+
+VkDispatchIndirectCommand compute_group_count(const uint32_t local_size[3], uint32_t x, uint32_t y, uint32_t z)
+{
+    return (VkDispatchIndirectCommand){
+        .x = group_count(x, MAX(local_size[0], 1u)),
+        .y = group_count(y, MAX(local_size[1], 1u)),
+        .z = group_count(z, MAX(local_size[2], 1u)),
+    };
+}
+
+void cmd_dispatch_threads(VkCommandBuffer cmd, const ComputePipeline* p, uint32_t x, uint32_t y, uint32_t z)
+{
+    VkDispatchIndirectCommand groups = compute_group_count(p->local_size, x, y, z);
+    if(groups.x == 0 || groups.y == 0 || groups.z == 0)
+        return;
+
+    vkCmdDispatch(cmd, groups.x, groups.y, groups.z);
+}
+
+bool dispatch_args_generator_init(DispatchArgsGenerator* gen,
+                                  VkDevice               device,
+                                  VkPhysicalDevice       phys,
+                                  VkPipelineCache        cache,
+                                  DescriptorLayoutCache* desc_cache,
+                                  PipelineLayoutCache*   pipe_cache,
+                                  PipelineObjectCache*   obj_cache,
+                                  const char*            spv_path)
+{
+    memset(gen, 0, sizeof(*gen));
+
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(phys, &props);
+    gen->max_group_count = props.limits.maxComputeWorkGroupCount[0];
+
+    ComputePipelineDesc desc = {.comp_path = spv_path};
+    create_compute_pipelines(device, cache, desc_cache, pipe_cache, obj_cache, &desc, 1, &gen->pipeline);
+    gen->owns_pipeline = obj_cache == NULL;
+
+    return gen->pipeline.pipeline != VK_NULL_HANDLE;
+}
+
+void dispatch_args_generator_destroy(VkDevice device, DispatchArgsGenerator* gen)
+{
+    // the layout belongs to the pipeline layout cache
+    if(gen->owns_pipeline && gen->pipeline.pipeline != VK_NULL_HANDLE)
+        vkDestroyPipeline(device, gen->pipeline.pipeline, NULL);
+
+    memset(gen, 0, sizeof(*gen));
+}
+
+void cmd_generate_dispatch_args(VkCommandBuffer              cmd,
+                                const DispatchArgsGenerator* gen,
+                                VkDeviceAddress              counts_address,
+                                VkDeviceAddress              args_address,
+                                uint32_t                     entry_count,
+                                uint32_t                     group_size)
+{
+    if(entry_count == 0)
+        return;
+
+    DispatchArgsPush push = {
+        .counts          = counts_address,
+        .args            = args_address,
+        .entry_count     = entry_count,
+        .group_size      = MAX(group_size, 1u),
+        .max_group_count = gen->max_group_count,
+    };
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, gen->pipeline.pipeline);
+    vkCmdPushConstants(cmd, gen->pipeline.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
+    cmd_dispatch_threads(cmd, &gen->pipeline, entry_count, 1, 1);
+
+    VkMemoryBarrier2 barrier = {
+        .sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+        .srcStageMask  = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+        .srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+        .dstStageMask  = VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+        .dstAccessMask = VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT,
+    };
+
+    VkDependencyInfo dep = {
+        .sType              = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+        .memoryBarrierCount = 1,
+        .pMemoryBarriers    = &barrier,
+    };
+
+    vkCmdPipelineBarrier2(cmd, &dep);
+}
@@ -0,0 +1,72 @@
+#ifndef VK_COMPUTE_H_
+#define VK_COMPUTE_H_
+
+#include "vk_defaults.h"
+#include "vk_pipelines.h"
+
+/* ------------------ Compute dispatch ------------------ */
+//
+// Dispatches sized in work items instead of workgroups. The group count
+// comes from the workgroup size reflected into ComputePipeline, so a
+// shader can change its local_size without touching the callers:
+//
+//   ComputePipeline cull;
+//   create_compute_pipelines(device, cache, &desc_cache, &pipe_cache, &obj_cache, &desc, 1, &cull);
+//   ...recording...
+//   vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, cull.pipeline);
+//   cmd_dispatch_threads(cmd, &cull, object_count, 1, 1);
+//
+// When the item count is only known on the GPU, e.g. written by a culling
+// pass, DispatchArgsGenerator turns counts into VkDispatchIndirectCommand
+// with shaders/dispatch_args.comp, without a round trip to the host:
+//
+//   dispatch_args_generator_init(&gen, device, phys, cache, &desc_cache, &pipe_cache, &obj_cache,
+//                                "compiledshaders/dispatch_args.comp.spv");
+//   cmd_generate_dispatch_args(cmd, &gen, counts.address, args.address, 1, shade.local_size[0]);
+//   vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, shade.pipeline);
+//   vkCmdDispatchIndirect(cmd, args.buffer, 0);
+//
+// Counts and arguments are passed by buffer device address (Buffer.address),
+// so the buffers need VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT and the
+// argument buffer VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT as well.
+
+typedef struct DispatchArgsGenerator
+{
+    ComputePipeline pipeline;
+    uint32_t        max_group_count;  // maxComputeWorkGroupCount[0], generated x is clamped to it
+    bool            owns_pipeline;    // no object cache was given
+} DispatchArgsGenerator;
+
+// workgroups covering x * y * z items with local_size, rounded up per dimension
+VkDispatchIndirectCommand compute_group_count(const uint32_t local_size[3], uint32_t x, uint32_t y, uint32_t z);
+
+// vkCmdDispatch for x * y * z items of the bound pipeline p; nothing is recorded for 0 items
+void cmd_dispatch_threads(VkCommandBuffer cmd, const ComputePipeline* p, uint32_t x, uint32_t y, uint32_t z);
+
+// spv_path is the compiled shaders/dispatch_args.comp
+bool dispatch_args_generator_init(DispatchArgsGenerator* gen,
+                                  VkDevice               device,
+                                  VkPhysicalDevice       phys,
+                                  VkPipelineCache        cache,
+                                  DescriptorLayoutCache* desc_cache,
+                                  PipelineLayoutCache*   pipe_cache,
+                                  PipelineObjectCache*   obj_cache,
+                                  const char*            spv_path);
+
+void dispatch_args_generator_destroy(VkDevice device, DispatchArgsGenerator* gen);
+
+// For each of entry_count uint32 counts at counts_address writes a
+// VkDispatchIndirectCommand covering that many items at args_address.
+// group_size is the workgroup width of the consuming pipeline, usually
+// its local_size[0]. Binds the generator's pipeline, so rebind afterwards,
+// and ends with a barrier that makes the arguments visible to indirect
+// dispatches and draws. Writes to the counts must already be visible to
+// compute shaders.
+void cmd_generate_dispatch_args(VkCommandBuffer              cmd,
+                                const DispatchArgsGenerator* gen,
+                                VkDeviceAddress              counts_address,
+                                VkDeviceAddress              args_address,
+                                uint32_t                     entry_count,
+                                uint32_t                     group_size);
+
+#endif // VK_COMPUTE_H_
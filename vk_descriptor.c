@@ -1,83 +1,462 @@
-
 #include "vk_descriptor.h"
 
-static VkDescriptorPool create_pool(VkDevice device, float scale)
+// smoothing for the learned sets-per-frame rate and the slack kept on top of it
+#define SETS_PER_FRAME_ALPHA 0.25f
+#define SETS_PER_FRAME_HEADROOM 1.25f
+
+// per-set descriptor budget for allocators that were never told their layout
+static const VkDescriptorPoolSize generic_set_sizes[] = {
+    {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2},
+    {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2},
+    {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2},
+    {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1},
+    {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1},
+};
+#define GENERIC_SETS_PER_UNIT 4  // generic_set_sizes describe this many sets
+
+// in 64 bit and saturated so a large inline uniform block times a large
+// maxSets cannot wrap to a tiny pool
+uint32_t descriptor_pool_scaled_count(uint32_t per_set, uint32_t max_sets, uint32_t sets_per_unit)
 {
-    VkDescriptorPoolSize sizes[] = {
-        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, (uint32_t)(64 * scale)},
-        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, (uint32_t)(64 * scale)},
-        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, (uint32_t)(64 * scale)},
-        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, (uint32_t)(32 * scale)},
-        {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, (uint32_t)(32 * scale)},
+    uint64_t count = (uint64_t)per_set * max_sets / sets_per_unit;
+    return (uint32_t)MIN(count, (uint64_t)UINT32_MAX);
+}
+
+static DescriptorPoolChunk create_pool(const DescriptorAllocator* alloc, uint32_t max_sets)
+{
+    VkDescriptorPoolSize sizes[DESCRIPTOR_POOL_MAX_TYPES];
+    uint32_t             size_count = 0;
+    uint64_t             total      = 0;
+
+    if(alloc->set_size_count > 0)
+    {
+        for(uint32_t i = 0; i < alloc->set_size_count; i++)
+        {
+            sizes[size_count].type            = alloc->set_sizes[i].type;
+            sizes[size_count].descriptorCount = descriptor_pool_scaled_count(alloc->set_sizes[i].descriptorCount, max_sets, 1);
+            total += sizes[size_count++].descriptorCount;
+        }
+    }
+    else
+    {
+        for(uint32_t i = 0; i < sizeof generic_set_sizes / sizeof generic_set_sizes[0]; i++)
+        {
+            sizes[size_count].type            = generic_set_sizes[i].type;
+            sizes[size_count].descriptorCount = MAX(1u, descriptor_pool_scaled_count(generic_set_sizes[i].descriptorCount, max_sets, GENERIC_SETS_PER_UNIT));
+            total += sizes[size_count++].descriptorCount;
+        }
+    }
+
+    // inline uniform block pool sizes are bytes, the binding budget is separate
+    VkDescriptorPoolInlineUniformBlockCreateInfo inline_info = {
+        .sType                         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_INLINE_UNIFORM_BLOCK_CREATE_INFO,
+        .maxInlineUniformBlockBindings = descriptor_pool_scaled_count(alloc->inline_block_bindings, max_sets, 1),
     };
 
     VkDescriptorPoolCreateInfo info = {
         .sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-        .flags         = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
-        .maxSets       = (uint32_t)(128 * scale),
-        .poolSizeCount = (uint32_t)(sizeof sizes / sizeof sizes[0]),
+        .pNext         = alloc->inline_block_bindings > 0 ? &inline_info : NULL,
+        .flags         = 0,  // sets are only released by resetting the pool
+        .maxSets       = max_sets,
+        .poolSizeCount = size_count,
         .pPoolSizes    = sizes,
     };
 
-    VkDescriptorPool pool;
-    VK_CHECK(vkCreateDescriptorPool(device, &info, NULL, &pool));
-    return pool;
+    DescriptorPoolChunk chunk = {.max_sets = max_sets, .descriptor_count = (uint32_t)MIN(total, (uint64_t)UINT32_MAX)};
+    VK_CHECK(vkCreateDescriptorPool(alloc->device, &info, NULL, &chunk.pool));
+    return chunk;
 }
+
+static void release_pool(DescriptorAllocator* alloc, const DescriptorPoolChunk* chunk)
+{
+    vkDestroyDescriptorPool(alloc->device, chunk->pool, NULL);
+
+    alloc->stats.pools_released++;
+    alloc->stats.bytes_held -= (uint64_t)chunk->descriptor_count * DESCRIPTOR_POOL_BYTES_PER_DESCRIPTOR;
+}
+
+DescriptorAllocatorConfig descriptor_allocator_config_default(void)
+{
+    return (DescriptorAllocatorConfig){
+        .initial_sets               = 128,
+        .min_sets_per_pool          = 16,
+        .max_sets_per_pool          = 4096,
+        .growth_factor              = 2.0f,
+        .idle_frames_before_release = 8,
+    };
+}
+
 //  base allocator (per layout bucket)
 void descriptor_allocator_init(DescriptorAllocator* alloc, VkDevice device)
 {
-    alloc->device = device;
-    alloc->pools  = NULL;
+    DescriptorAllocatorConfig config = descriptor_allocator_config_default();
+    descriptor_allocator_init_with_config(alloc, device, &config);
 }
 
-static VkDescriptorPool current_pool(DescriptorAllocator* a)
+void descriptor_allocator_init_with_config(DescriptorAllocator* alloc, VkDevice device, const DescriptorAllocatorConfig* config)
 {
-    if(arrlen(a->pools) == 0)
+    memset(alloc, 0, sizeof(*alloc));
+
+    alloc->device    = device;
+    alloc->config    = *config;
+    alloc->next_sets = MAX(1u, config->initial_sets);
+}
+
+void descriptor_allocator_set_binding_mix(DescriptorAllocator* alloc, const VkDescriptorSetLayoutBinding* bindings, uint32_t binding_count)
+{
+    alloc->set_size_count        = 0;
+    alloc->inline_block_bindings = 0;
+
+    for(uint32_t i = 0; i < binding_count; i++)
     {
-        DescriptorPoolChunk chunk = {create_pool(a->device, 1.0f), 1.0f};
-        arrpush(a->pools, chunk);
+        if(bindings[i].descriptorCount == 0)
+            continue;
+
+        if(bindings[i].descriptorType == VK_DESCRIPTOR_TYPE_INLINE_UNIFORM_BLOCK)
+            alloc->inline_block_bindings++;
+
+        uint32_t t = 0;
+        while(t < alloc->set_size_count && alloc->set_sizes[t].type != bindings[i].descriptorType)
+            t++;
+
+        if(t == alloc->set_size_count)
+        {
+            assert(t < DESCRIPTOR_POOL_MAX_TYPES);
+            alloc->set_sizes[t] = (VkDescriptorPoolSize){bindings[i].descriptorType, 0};
+            alloc->set_size_count++;
+        }
+
+        alloc->set_sizes[t].descriptorCount += bindings[i].descriptorCount;
     }
+}
+
+// creates a pool of at least min_sets and makes it the current ready pool
+static DescriptorPoolChunk* push_new_pool(DescriptorAllocator* a, uint32_t min_sets)
+{
+    DescriptorPoolChunk chunk = create_pool(a, MAX(a->next_sets, min_sets));
+    arrpush(a->ready, chunk);
 
-    return a->pools[arrlen(a->pools) - 1].pool;
+    a->stats.pools_created++;
+    a->stats.bytes_held += (uint64_t)chunk.descriptor_count * DESCRIPTOR_POOL_BYTES_PER_DESCRIPTOR;
+
+    uint32_t grown = (uint32_t)((float)a->next_sets * a->config.growth_factor);
+    a->next_sets   = CLAMP(grown, a->next_sets, MAX(a->config.max_sets_per_pool, 1u));
+
+    return &a->ready[arrlen(a->ready) - 1];
 }
 
-VkResult descriptor_allocator_allocate(DescriptorAllocator* alloc, VkDescriptorSetLayout layout, VkDescriptorSet* out)
+// grabs the next ready pool, creating one (capped growth) when none is left
+static DescriptorPoolChunk* acquire_pool(DescriptorAllocator* a)
+{
+    if(arrlen(a->ready) > 0)
+        return &a->ready[arrlen(a->ready) - 1];
+
+    return push_new_pool(a, 0);
+}
+
+// park the exhausted current pool until the next reset
+static void retire_current_pool(DescriptorAllocator* a)
+{
+    arrpush(a->full, a->ready[arrlen(a->ready) - 1]);
+    arrsetlen(a->ready, arrlen(a->ready) - 1);
+}
+
+static bool pool_exhausted(VkResult r)
 {
+    return r == VK_ERROR_OUT_OF_POOL_MEMORY || r == VK_ERROR_FRAGMENTED_POOL;
+}
+
+VkResult descriptor_allocator_allocate_many(DescriptorAllocator* alloc, const VkDescriptorSetLayout* layouts, uint32_t count, VkDescriptorSet* out)
+{
+    if(count == 0)
+        return VK_SUCCESS;
+
+    DescriptorPoolChunk* chunk = acquire_pool(alloc);
+
     VkDescriptorSetAllocateInfo info = {.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-                                        .descriptorPool     = current_pool(alloc),
-                                        .descriptorSetCount = 1,
-                                        .pSetLayouts        = &layout};
+                                        .descriptorPool     = chunk->pool,
+                                        .descriptorSetCount = count,
+                                        .pSetLayouts        = layouts};
 
     VkResult r = vkAllocateDescriptorSets(alloc->device, &info, out);
-    if(r == VK_SUCCESS)
-        return VK_SUCCESS;
 
-    if(r == VK_ERROR_OUT_OF_POOL_MEMORY || r == VK_ERROR_FRAGMENTED_POOL)
+    if(pool_exhausted(r))
     {
-        float new_scale = alloc->pools[arrlen(alloc->pools) - 1].scale * 2.0f;
+        // retry on the next ready pool (or a fresh one)
+        retire_current_pool(alloc);
 
-        DescriptorPoolChunk chunk = {create_pool(alloc->device, new_scale), new_scale};
-        arrpush(alloc->pools, chunk);
+        chunk               = acquire_pool(alloc);
+        info.descriptorPool = chunk->pool;
+        r                   = vkAllocateDescriptorSets(alloc->device, &info, out);
+    }
+
+    if(pool_exhausted(r))
+    {
+        // the batch does not fit what we had lying around, give it a pool of its own size
+        retire_current_pool(alloc);
 
-        info.descriptorPool = chunk.pool;
-        return vkAllocateDescriptorSets(alloc->device, &info, out);
+        chunk               = push_new_pool(alloc, count);
+        info.descriptorPool = chunk->pool;
+        r                   = vkAllocateDescriptorSets(alloc->device, &info, out);
+    }
+
+    if(r == VK_SUCCESS)
+    {
+        chunk->used = true;
+        alloc->sets_this_frame += count;
     }
 
     return r;
 }
 
+VkResult descriptor_allocator_allocate(DescriptorAllocator* alloc, VkDescriptorSetLayout layout, VkDescriptorSet* out)
+{
+    return descriptor_allocator_allocate_many(alloc, &layout, 1, out);
+}
+
+// size the next pool for one frame's worth of sets, smoothed over resets
+static void learn_sets_per_frame(DescriptorAllocator* alloc)
+{
+    float observed = (float)alloc->sets_this_frame;
+    alloc->sets_this_frame = 0;
+
+    if(alloc->sets_per_frame == 0.0f)
+        alloc->sets_per_frame = observed;
+    else
+        alloc->sets_per_frame += (observed - alloc->sets_per_frame) * SETS_PER_FRAME_ALPHA;
+
+    if(alloc->sets_per_frame == 0.0f)
+        return;
+
+    uint32_t learned = round_up((uint32_t)(alloc->sets_per_frame * SETS_PER_FRAME_HEADROOM) + 1, 16);
+    alloc->next_sets = CLAMP(learned, MAX(alloc->config.min_sets_per_pool, 1u), MAX(alloc->config.max_sets_per_pool, 1u));
+}
+
 void descriptor_allocator_reset(DescriptorAllocator* alloc)
 {
-    for(int i = 0; i < arrlen(alloc->pools); i++)
-        vkResetDescriptorPool(alloc->device, alloc->pools[i].pool, 0);
+    learn_sets_per_frame(alloc);
+
+    for(int i = 0; i < arrlen(alloc->full); i++)
+        arrpush(alloc->ready, alloc->full[i]);
+    arrsetlen(alloc->full, 0);
+
+    uint32_t release_after = alloc->config.idle_frames_before_release;
+    int      kept          = 0;
+
+    for(int i = 0; i < arrlen(alloc->ready); i++)
+    {
+        DescriptorPoolChunk chunk = alloc->ready[i];
+
+        chunk.idle_frames = chunk.used ? 0 : chunk.idle_frames + 1;
+        chunk.used        = false;
+
+        if(release_after != 0 && chunk.idle_frames >= release_after)
+        {
+            release_pool(alloc, &chunk);
+            continue;
+        }
+
+        vkResetDescriptorPool(alloc->device, chunk.pool, 0);
+        alloc->ready[kept++] = chunk;
+    }
+
+    arrsetlen(alloc->ready, kept);
 }
 
 void descriptor_allocator_destroy(DescriptorAllocator* alloc)
 {
-    for(int i = 0; i < arrlen(alloc->pools); i++)
-        vkDestroyDescriptorPool(alloc->device, alloc->pools[i].pool, NULL);
+    for(int i = 0; i < arrlen(alloc->ready); i++)
+        release_pool(alloc, &alloc->ready[i]);
+    for(int i = 0; i < arrlen(alloc->full); i++)
+        release_pool(alloc, &alloc->full[i]);
+
+    arrfree(alloc->ready);
+    arrfree(alloc->full);
+}
+
+void descriptor_allocator_get_stats(const DescriptorAllocator* alloc, DescriptorAllocatorStats* out)
+{
+    *out             = alloc->stats;
+    out->ready_pools = (uint32_t)arrlen(alloc->ready);
+    out->full_pools  = (uint32_t)arrlen(alloc->full);
+}
+
+
+// key arena
+
+static void* key_arena_alloc(DescriptorKeyArena* arena, size_t size)
+{
+    size = (size + 7) & ~(size_t)7;
+
+    if(!arena->blocks || arena->used + size > arena->capacity)
+    {
+        size_t capacity = size > DESCRIPTOR_KEY_ARENA_BLOCK_SIZE ? size : DESCRIPTOR_KEY_ARENA_BLOCK_SIZE;
+        arrpush(arena->blocks, malloc(capacity));
+        arena->used     = 0;
+        arena->capacity = capacity;
+    }
+
+    void* p = arena->blocks[arrlen(arena->blocks) - 1] + arena->used;
+    arena->used += size;
+    return p;
+}
+
+// keeps the newest block for reuse
+static void key_arena_reset(DescriptorKeyArena* arena)
+{
+    int n = arrlen(arena->blocks);
+    if(n == 0)
+        return;
+
+    for(int i = 0; i < n - 1; i++)
+        free(arena->blocks[i]);
+
+    arena->blocks[0] = arena->blocks[n - 1];
+    arrsetlen(arena->blocks, 1);
+    arena->used = 0;
+}
+
+static void key_arena_destroy(DescriptorKeyArena* arena)
+{
+    for(int i = 0; i < arrlen(arena->blocks); i++)
+        free(arena->blocks[i]);
+
+    arrfree(arena->blocks);
+    arena->used     = 0;
+    arena->capacity = 0;
+}
+
+
+// layout keys
+
+// lookup keys are built on the stack unless the layout is unusually large
+#define LAYOUT_KEY_STACK_BINDINGS 32
+#define LAYOUT_KEY_STACK_SAMPLERS 64
+
+typedef struct LayoutKeyScratch
+{
+    DescriptorLayoutKey        key;
+    DescriptorLayoutBindingKey bindings[LAYOUT_KEY_STACK_BINDINGS];
+    VkSampler                  samplers[LAYOUT_KEY_STACK_SAMPLERS];
+} LayoutKeyScratch;
+
+static bool has_immutable_samplers(const VkDescriptorSetLayoutBinding* b)
+{
+    return b->pImmutableSamplers
+           && (b->descriptorType == VK_DESCRIPTOR_TYPE_SAMPLER || b->descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+}
+
+static const VkDescriptorSetLayoutBindingFlagsCreateInfo* find_binding_flags(const VkDescriptorSetLayoutCreateInfo* info)
+{
+    // other extension structs are not part of the key
+    for(const VkBaseInStructure* next = info->pNext; next; next = next->pNext)
+    {
+        if(next->sType == VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO)
+            return (const VkDescriptorSetLayoutBindingFlagsCreateInfo*)next;
+    }
+    return NULL;
+}
+
+static const VkDescriptorSetLayoutBinding* find_source_binding(const VkDescriptorSetLayoutCreateInfo* info, uint32_t binding)
+{
+    for(uint32_t i = 0; i < info->bindingCount; i++)
+    {
+        if(info->pBindings[i].binding == binding)
+            return &info->pBindings[i];
+    }
+    return NULL;
+}
+
+static Hash64 hash_layout_key(const DescriptorLayoutKey* k)
+{
+    Hash64 h = XXH64(&k->flags, sizeof(k->flags), k->binding_count);
+    h        = XXH64(k->bindings, k->binding_count * sizeof(DescriptorLayoutBindingKey), h);
+    return XXH64(k->samplers, k->sampler_count * sizeof(VkSampler), h);
+}
+
+// fills scratch with the canonical key for info, free_layout_key releases any heap spill
+static const DescriptorLayoutKey* make_layout_key(const VkDescriptorSetLayoutCreateInfo* info, LayoutKeyScratch* scratch)
+{
+    const VkDescriptorSetLayoutBindingFlagsCreateInfo* flags_info = find_binding_flags(info);
+
+    uint32_t sampler_count = 0;
+    for(uint32_t i = 0; i < info->bindingCount; i++)
+    {
+        if(has_immutable_samplers(&info->pBindings[i]))
+            sampler_count += info->pBindings[i].descriptorCount;
+    }
+
+    DescriptorLayoutBindingKey* bindings = info->bindingCount <= LAYOUT_KEY_STACK_BINDINGS ?
+                                               scratch->bindings :
+                                               malloc(info->bindingCount * sizeof(DescriptorLayoutBindingKey));
+    VkSampler* samplers = sampler_count <= LAYOUT_KEY_STACK_SAMPLERS ? scratch->samplers : malloc(sampler_count * sizeof(VkSampler));
+
+    // insertion sort by binding number, binding lists are short
+    for(uint32_t i = 0; i < info->bindingCount; i++)
+    {
+        const VkDescriptorSetLayoutBinding* src = &info->pBindings[i];
+
+        DescriptorLayoutBindingKey b = {
+            .binding            = src->binding,
+            .type               = src->descriptorType,
+            .count              = src->descriptorCount,
+            .stages             = src->stageFlags,
+            .flags              = flags_info && i < flags_info->bindingCount ? flags_info->pBindingFlags[i] : 0,
+            .immutable_samplers = has_immutable_samplers(src) ? src->descriptorCount : 0,
+        };
+
+        uint32_t j = i;
+        while(j > 0 && bindings[j - 1].binding > b.binding)
+        {
+            bindings[j] = bindings[j - 1];
+            j--;
+        }
+        bindings[j] = b;
+    }
+
+    // sampler identities follow the sorted binding order
+    uint32_t s = 0;
+    for(uint32_t i = 0; i < info->bindingCount; i++)
+    {
+        if(!bindings[i].immutable_samplers)
+            continue;
+
+        const VkDescriptorSetLayoutBinding* src = find_source_binding(info, bindings[i].binding);
+        memcpy(&samplers[s], src->pImmutableSamplers, bindings[i].immutable_samplers * sizeof(VkSampler));
+        s += bindings[i].immutable_samplers;
+    }
+
+    scratch->key = (DescriptorLayoutKey){
+        .flags         = info->flags,
+        .binding_count = info->bindingCount,
+        .sampler_count = sampler_count,
+        .bindings      = bindings,
+        .samplers      = samplers,
+    };
+    scratch->key.hash = hash_layout_key(&scratch->key);
+
+    return &scratch->key;
+}
+
+static void free_layout_key(LayoutKeyScratch* scratch)
+{
+    if(scratch->key.bindings != scratch->bindings)
+        free((void*)scratch->key.bindings);
+    if(scratch->key.samplers != scratch->samplers)
+        free((void*)scratch->key.samplers);
+}
+
+static bool layout_key_equal(const DescriptorLayoutKey* a, const DescriptorLayoutKey* b)
+{
+    return a->hash == b->hash && a->flags == b->flags && a->binding_count == b->binding_count
+           && a->sampler_count == b->sampler_count
+           && memcmp(a->bindings, b->bindings, a->binding_count * sizeof(DescriptorLayoutBindingKey)) == 0
+           && memcmp(a->samplers, b->samplers, a->sampler_count * sizeof(VkSampler)) == 0;
+}
 
-    arrfree(alloc->pools);
+static bool layout_entry_matches(const void* value, const void* key)
+{
+    return layout_key_equal(&((const DescriptorLayoutEntry*)value)->key, key);
 }
 
 
@@ -87,47 +466,80 @@ void descriptor_allocator_destroy(DescriptorAllocator* alloc)
 
 void descriptor_layout_cache_init(DescriptorLayoutCache* cache)
 {
-    cache->entries = NULL;
+    memset(cache, 0, sizeof(*cache));
+    hash_index_init(&cache->index, 0);
+    mutex_init(&cache->lock);
 }
 
-static uint32_t hash_layout_key(const DescriptorLayoutKey* k)
+// copies key into the arena, caller holds the cache lock
+static DescriptorLayoutEntry* intern_layout_entry(DescriptorLayoutCache* cache, const DescriptorLayoutKey* key)
 {
-    return hash32_bytes(k->bindings, k->binding_count * sizeof(VkDescriptorSetLayoutBinding)) ^ k->binding_count;
+    DescriptorLayoutEntry*      entry    = key_arena_alloc(&cache->arena, sizeof(DescriptorLayoutEntry));
+    DescriptorLayoutBindingKey* bindings = key_arena_alloc(&cache->arena, key->binding_count * sizeof(DescriptorLayoutBindingKey));
+    VkSampler*                  samplers = key_arena_alloc(&cache->arena, key->sampler_count * sizeof(VkSampler));
+
+    memcpy(bindings, key->bindings, key->binding_count * sizeof(DescriptorLayoutBindingKey));
+    memcpy(samplers, key->samplers, key->sampler_count * sizeof(VkSampler));
+
+    entry->key          = *key;
+    entry->key.bindings = bindings;
+    entry->key.samplers = samplers;
+    entry->layout       = VK_NULL_HANDLE;
+    return entry;
 }
 
-VkDescriptorSetLayout descriptor_layout_cache_get(VkDevice device, DescriptorLayoutCache* cache, const VkDescriptorSetLayoutCreateInfo* info)
+static const DescriptorLayoutEntry* layout_cache_get_with_key(VkDevice                               device,
+                                                              DescriptorLayoutCache*                 cache,
+                                                              const VkDescriptorSetLayoutCreateInfo* info,
+                                                              const DescriptorLayoutKey*             key)
 {
-    DescriptorLayoutKey key = {0};
-    key.binding_count       = info->bindingCount;
-    memcpy(key.bindings, info->pBindings, info->bindingCount * sizeof(VkDescriptorSetLayoutBinding));
-    key.hash = hash_layout_key(&key);
+    DescriptorLayoutEntry* hit = hash_index_find(&cache->index, key->hash, layout_entry_matches, key);
+    if(hit)
+        return hit;
 
-    for(int i = 0; i < arrlen(cache->entries); i++)
+    mutex_lock(&cache->lock);
+
+    // another thread may have created it while we waited
+    DescriptorLayoutEntry* entry = hash_index_find(&cache->index, key->hash, layout_entry_matches, key);
+    if(!entry)
     {
-        DescriptorLayoutEntry* e = &cache->entries[i];
+        entry = intern_layout_entry(cache, key);
+        VK_CHECK(vkCreateDescriptorSetLayout(device, info, NULL, &entry->layout));
 
-        if(e->key.hash == key.hash && e->key.binding_count == key.binding_count
-           && memcmp(e->key.bindings, key.bindings, key.binding_count * sizeof(VkDescriptorSetLayoutBinding)) == 0)
-        {
-            return e->layout;
-        }
+        arrpush(cache->entries, entry);
+        hash_index_insert(&cache->index, key->hash, entry);
     }
 
-    VkDescriptorSetLayout layout;
-    VK_CHECK(vkCreateDescriptorSetLayout(device, info, NULL, &layout));
+    mutex_unlock(&cache->lock);
 
-    DescriptorLayoutEntry entry = {key, layout};
-    arrpush(cache->entries, entry);
+    return entry;
+}
+
+const DescriptorLayoutEntry* descriptor_layout_cache_get_entry(VkDevice device, DescriptorLayoutCache* cache, const VkDescriptorSetLayoutCreateInfo* info)
+{
+    LayoutKeyScratch scratch;
+    const DescriptorLayoutKey* key = make_layout_key(info, &scratch);
 
-    return layout;
+    const DescriptorLayoutEntry* entry = layout_cache_get_with_key(device, cache, info, key);
+
+    free_layout_key(&scratch);
+    return entry;
+}
+
+VkDescriptorSetLayout descriptor_layout_cache_get(VkDevice device, DescriptorLayoutCache* cache, const VkDescriptorSetLayoutCreateInfo* info)
+{
+    return descriptor_layout_cache_get_entry(device, cache, info)->layout;
 }
 
 void descriptor_layout_cache_destroy(VkDevice device, DescriptorLayoutCache* cache)
 {
     for(int i = 0; i < arrlen(cache->entries); i++)
-        vkDestroyDescriptorSetLayout(device, cache->entries[i].layout, NULL);
+        vkDestroyDescriptorSetLayout(device, cache->entries[i]->layout, NULL);
 
     arrfree(cache->entries);
+    hash_index_destroy(&cache->index);
+    key_arena_destroy(&cache->arena);
+    mutex_destroy(&cache->lock);
 }
 
 VkDescriptorSetLayout get_or_create_set_layout(VkDevice                            device,
@@ -148,35 +560,104 @@ VkDescriptorSetLayout get_or_create_set_layout(VkDevice
 // manager
 void descriptor_allocator_manager_init(DescriptorAllocatorManager* m, VkDevice device)
 {
-    m->device  = device;
-    m->buckets = NULL;
+    DescriptorAllocatorConfig config = descriptor_allocator_config_default();
+    descriptor_allocator_manager_init_with_config(m, device, &config);
+}
+
+void descriptor_allocator_manager_init_with_config(DescriptorAllocatorManager* m, VkDevice device, const DescriptorAllocatorConfig* config)
+{
+    memset(m, 0, sizeof(*m));
+    m->device = device;
+    m->config = *config;
+    hash_index_init(&m->index, 0);
+    hash_index_init(&m->written_index, 0);
 }
 
 void descriptor_allocator_manager_destroy(DescriptorAllocatorManager* m)
 {
     for(int i = 0; i < arrlen(m->buckets); i++)
-        descriptor_allocator_destroy(&m->buckets[i].alloc);
+    {
+        descriptor_allocator_destroy(&m->buckets[i]->alloc);
+        free(m->buckets[i]);
+    }
 
     arrfree(m->buckets);
+    hash_index_destroy(&m->index);
+    hash_index_destroy(&m->written_index);
+    key_arena_destroy(&m->written_arena);
+}
+
+static void clear_written_sets(DescriptorAllocatorManager* m)
+{
+    if(m->written_index.count == 0)
+        return;
+
+    hash_index_destroy(&m->written_index);
+    hash_index_init(&m->written_index, 0);
+    key_arena_reset(&m->written_arena);
 }
 
-static DescriptorAllocator* get_bucket_for_key(DescriptorAllocatorManager* m, const DescriptorLayoutKey* key)
+void descriptor_allocator_manager_reset(DescriptorAllocatorManager* m)
 {
+    // the sets go back to their pools, so nothing written this frame may be handed out again
+    clear_written_sets(m);
+
     for(int i = 0; i < arrlen(m->buckets); i++)
-    {
-        DescriptorAllocatorBucket* b = &m->buckets[i];
+        descriptor_allocator_reset(&m->buckets[i]->alloc);
+}
+
+void descriptor_allocator_manager_set_reuse(DescriptorAllocatorManager* m, bool enable)
+{
+    m->reuse_written_sets = enable;
+    if(!enable)
+        clear_written_sets(m);
+}
+
+void descriptor_allocator_manager_get_stats(const DescriptorAllocatorManager* m, DescriptorAllocatorStats* out)
+{
+    memset(out, 0, sizeof(*out));
 
-        if(b->key.hash == key->hash && b->key.binding_count == key->binding_count
-           && memcmp(b->key.bindings, key->bindings, key->binding_count * sizeof(VkDescriptorSetLayoutBinding)) == 0)
-            return &b->alloc;
+    for(int i = 0; i < arrlen(m->buckets); i++)
+    {
+        DescriptorAllocatorStats s;
+        descriptor_allocator_get_stats(&m->buckets[i]->alloc, &s);
+
+        out->ready_pools += s.ready_pools;
+        out->full_pools += s.full_pools;
+        out->bytes_held += s.bytes_held;
+        out->pools_created += s.pools_created;
+        out->pools_released += s.pools_released;
     }
 
-    DescriptorAllocatorBucket bucket = {0};
-    bucket.key                       = *key;
-    descriptor_allocator_init(&bucket.alloc, m->device);
+    out->set_reuse_hits   = m->reuse_hits;
+    out->set_reuse_misses = m->reuse_misses;
+}
+
+static bool bucket_matches(const void* value, const void* key)
+{
+    return ((const DescriptorAllocatorBucket*)value)->key == key;
+}
+
+// entry comes from the layout cache, so its key is interned and compared by address
+static DescriptorAllocator* get_bucket_for_entry(DescriptorAllocatorManager*            m,
+                                                 const DescriptorLayoutEntry*           entry,
+                                                 const VkDescriptorSetLayoutCreateInfo* info)
+{
+    const DescriptorLayoutKey* key = &entry->key;
+
+    DescriptorAllocatorBucket* hit = hash_index_find(&m->index, key->hash, bucket_matches, key);
+    if(hit)
+        return &hit->alloc;
+
+    DescriptorAllocatorBucket* bucket = calloc(1, sizeof(DescriptorAllocatorBucket));
+    bucket->key                       = key;
+    descriptor_allocator_init_with_config(&bucket->alloc, m->device, &m->config);
+    descriptor_allocator_set_binding_mix(&bucket->alloc, info->pBindings, info->bindingCount);
 
     arrpush(m->buckets, bucket);
-    return &m->buckets[arrlen(m->buckets) - 1].alloc;
+    hash_index_insert(&m->index, key->hash, bucket);
+
+    return &bucket->alloc;
 }
 
 VkResult descriptor_manager_allocate(DescriptorAllocatorManager*            m,
@@ -184,16 +665,306 @@ VkResult descriptor_manager_allocate(DescriptorAllocatorManager*            m,
                                      const VkDescriptorSetLayoutCreateInfo* info,
                                      VkDescriptorSet*                       out)
 {
-    DescriptorLayoutKey key = {0};
-    key.binding_count       = info->bindingCount;
-    memcpy(key.bindings, info->pBindings, info->bindingCount * sizeof(VkDescriptorSetLayoutBinding));
-    key.hash = hash_layout_key(&key);
+    return descriptor_manager_allocate_n(m, cache, info, 1, out);
+}
+
+VkResult descriptor_manager_allocate_n(DescriptorAllocatorManager*            m,
+                                       DescriptorLayoutCache*                 cache,
+                                       const VkDescriptorSetLayoutCreateInfo* info,
+                                       uint32_t                               count,
+                                       VkDescriptorSet*                       out)
+{
+    if(count == 0)
+        return VK_SUCCESS;
+
+    const DescriptorLayoutEntry* entry  = descriptor_layout_cache_get_entry(m->device, cache, info);
+    VkDescriptorSetLayout        layout = entry->layout;
+    DescriptorAllocator*         alloc  = get_bucket_for_entry(m, entry, info);
+
+    VkDescriptorSetLayout  stack_layouts[64];
+    VkDescriptorSetLayout* layouts = count <= 64 ? stack_layouts : malloc(count * sizeof(VkDescriptorSetLayout));
+
+    for(uint32_t i = 0; i < count; i++)
+        layouts[i] = layout;
+
+    VkResult r = descriptor_allocator_allocate_many(alloc, layouts, count, out);
+
+    if(layouts != stack_layouts)
+        free(layouts);
+
+    return r;
+}
+
+VkResult descriptor_manager_allocate_many(DescriptorAllocatorManager*            m,
+                                          DescriptorLayoutCache*                 cache,
+                                          const VkDescriptorSetLayoutCreateInfo* infos,
+                                          uint32_t                               count,
+                                          VkDescriptorSet*                       out)
+{
+    if(count == 0)
+        return VK_SUCCESS;
+
+    // resolve every request to its layout and bucket first
+    VkDescriptorSetLayout* layouts = malloc(count * sizeof(VkDescriptorSetLayout));
+    DescriptorAllocator**  allocs  = malloc(count * sizeof(DescriptorAllocator*));
+    VkDescriptorSetLayout* group   = malloc(count * sizeof(VkDescriptorSetLayout));
+    VkDescriptorSet*       sets    = malloc(count * sizeof(VkDescriptorSet));
+    uint32_t*              slots   = malloc(count * sizeof(uint32_t));
+
+    for(uint32_t i = 0; i < count; i++)
+    {
+        const DescriptorLayoutEntry* entry = descriptor_layout_cache_get_entry(m->device, cache, &infos[i]);
+
+        layouts[i] = entry->layout;
+        allocs[i]  = get_bucket_for_entry(m, entry, &infos[i]);
+    }
+
+    // one vkAllocateDescriptorSets per bucket, results scattered back in request order
+    VkResult r = VK_SUCCESS;
+
+    for(uint32_t i = 0; i < count && r == VK_SUCCESS; i++)
+    {
+        DescriptorAllocator* alloc = allocs[i];
+        if(!alloc)
+            continue;
+
+        uint32_t n = 0;
+        for(uint32_t j = i; j < count; j++)
+        {
+            if(allocs[j] != alloc)
+                continue;
+
+            group[n]   = layouts[j];
+            slots[n++] = j;
+            allocs[j]  = NULL;
+        }
+
+        r = descriptor_allocator_allocate_many(alloc, group, n, sets);
+
+        for(uint32_t k = 0; k < n && r == VK_SUCCESS; k++)
+            out[slots[k]] = sets[k];
+    }
+
+    free(layouts);
+    free(allocs);
+    free(group);
+    free(sets);
+    free(slots);
+
+    return r;
+}
+
+
+// written set reuse
+
+// fixed part of one serialized write, followed by its descriptor infos
+typedef struct WrittenSetRecord
+{
+    uint32_t         binding;
+    uint32_t         array_element;
+    uint32_t         count;
+    VkDescriptorType type;
+} WrittenSetRecord;
+
+// bytes one descriptor of w serializes to, 0 when the write can't be content addressed.
+// Only the fields the descriptor type reads are kept, so ignored fields and
+// struct padding can't make identical writes look different.
+static size_t descriptor_content_size(const VkWriteDescriptorSet* w)
+{
+    if(w->pNext)
+        return 0;
 
-    VkDescriptorSetLayout layout = descriptor_layout_cache_get(m->device, cache, info);
+    switch(w->descriptorType)
+    {
+        case VK_DESCRIPTOR_TYPE_SAMPLER:
+            return w->pImageInfo ? sizeof(VkSampler) : 0;
+        case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+            return w->pImageInfo ? sizeof(VkSampler) + sizeof(VkImageView) + sizeof(uint32_t) : 0;
+        case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+        case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+        case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+            return w->pImageInfo ? sizeof(VkImageView) + sizeof(uint32_t) : 0;
+        case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+        case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+        case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+        case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
+            return w->pBufferInfo ? sizeof(VkBuffer) + 2 * sizeof(VkDeviceSize) : 0;
+        case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+        case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+            return w->pTexelBufferView ? sizeof(VkBufferView) : 0;
+        default:
+            return 0;
+    }
+}
 
-    DescriptorAllocator* alloc = get_bucket_for_key(m, &key);
+// bytes needed to serialize writes, 0 when any of them can't be content addressed
+static size_t written_content_size(const VkWriteDescriptorSet* writes, uint32_t write_count)
+{
+    size_t total = 0;
 
-    return descriptor_allocator_allocate(alloc, layout, out);
+    for(uint32_t i = 0; i < write_count; i++)
+    {
+        size_t size = descriptor_content_size(&writes[i]);
+        if(size == 0)
+            return 0;
+
+        total += sizeof(WrittenSetRecord) + writes[i].descriptorCount * size;
+    }
+
+    return total;
+}
+
+static uint8_t* put_bytes(uint8_t* dst, const void* src, size_t size)
+{
+    memcpy(dst, src, size);
+    return dst + size;
+}
+
+static uint8_t* serialize_descriptor(uint8_t* dst, const VkWriteDescriptorSet* w, uint32_t i)
+{
+    switch(w->descriptorType)
+    {
+        case VK_DESCRIPTOR_TYPE_SAMPLER:
+            return put_bytes(dst, &w->pImageInfo[i].sampler, sizeof(VkSampler));
+        case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+            dst = put_bytes(dst, &w->pImageInfo[i].sampler, sizeof(VkSampler));
+            // fallthrough
+        case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+        case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+        case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+        {
+            uint32_t layout = (uint32_t)w->pImageInfo[i].imageLayout;
+            dst             = put_bytes(dst, &w->pImageInfo[i].imageView, sizeof(VkImageView));
+            return put_bytes(dst, &layout, sizeof(layout));
+        }
+        case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+        case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+            return put_bytes(dst, &w->pTexelBufferView[i], sizeof(VkBufferView));
+        default:
+            dst = put_bytes(dst, &w->pBufferInfo[i].buffer, sizeof(VkBuffer));
+            dst = put_bytes(dst, &w->pBufferInfo[i].offset, sizeof(VkDeviceSize));
+            return put_bytes(dst, &w->pBufferInfo[i].range, sizeof(VkDeviceSize));
+    }
+}
+
+static void serialize_writes(const VkWriteDescriptorSet* writes, uint32_t write_count, uint8_t* dst)
+{
+    for(uint32_t i = 0; i < write_count; i++)
+    {
+        WrittenSetRecord record = {
+            .binding       = writes[i].dstBinding,
+            .array_element = writes[i].dstArrayElement,
+            .count         = writes[i].descriptorCount,
+            .type          = writes[i].descriptorType,
+        };
+        dst = put_bytes(dst, &record, sizeof(record));
+
+        for(uint32_t d = 0; d < writes[i].descriptorCount; d++)
+            dst = serialize_descriptor(dst, &writes[i], d);
+    }
+}
+
+typedef struct WrittenSetLookup
+{
+    const DescriptorLayoutKey* layout_key;
+    const uint8_t*             content;
+    uint32_t                   content_size;
+} WrittenSetLookup;
+
+static bool written_set_matches(const void* value, const void* key)
+{
+    const DescriptorWrittenSet* a = value;
+    const WrittenSetLookup*     b = key;
+
+    return a->layout_key == b->layout_key && a->content_size == b->content_size
+           && memcmp(a->content, b->content, b->content_size) == 0;
+}
+
+static VkResult allocate_and_write(DescriptorAllocatorManager*            m,
+                                   const DescriptorLayoutEntry*           entry,
+                                   const VkDescriptorSetLayoutCreateInfo* info,
+                                   const VkWriteDescriptorSet*            writes,
+                                   uint32_t                               write_count,
+                                   VkDescriptorSet*                       out)
+{
+    DescriptorAllocator* alloc = get_bucket_for_entry(m, entry, info);
+
+    VkResult r = descriptor_allocator_allocate(alloc, entry->layout, out);
+    if(r != VK_SUCCESS || write_count == 0)
+        return r;
+
+    VkWriteDescriptorSet  stack_writes[16];
+    VkWriteDescriptorSet* w = write_count <= 16 ? stack_writes : malloc(write_count * sizeof(VkWriteDescriptorSet));
+
+    for(uint32_t i = 0; i < write_count; i++)
+    {
+        w[i]        = writes[i];
+        w[i].dstSet = *out;
+    }
+
+    vkUpdateDescriptorSets(m->device, write_count, w, 0, NULL);
+
+    if(w != stack_writes)
+        free(w);
+
+    return VK_SUCCESS;
+}
+
+VkResult descriptor_manager_get_written_set(DescriptorAllocatorManager*            m,
+                                            DescriptorLayoutCache*                 cache,
+                                            const VkDescriptorSetLayoutCreateInfo* info,
+                                            const VkWriteDescriptorSet*            writes,
+                                            uint32_t                               write_count,
+                                            VkDescriptorSet*                       out)
+{
+    const DescriptorLayoutEntry* entry = descriptor_layout_cache_get_entry(m->device, cache, info);
+
+    size_t content_size = m->reuse_written_sets ? written_content_size(writes, write_count) : 0;
+    if(content_size == 0)
+        return allocate_and_write(m, entry, info, writes, write_count, out);
+
+    uint8_t  stack_content[1024];
+    uint8_t* content = content_size <= sizeof(stack_content) ? stack_content : malloc(content_size);
+    serialize_writes(writes, write_count, content);
+
+    WrittenSetLookup lookup = {
+        .layout_key   = &entry->key,
+        .content      = content,
+        .content_size = (uint32_t)content_size,
+    };
+    Hash64 hash = XXH64(content, content_size, entry->key.hash);
+
+    VkResult              r   = VK_SUCCESS;
+    DescriptorWrittenSet* hit = hash_index_find(&m->written_index, hash, written_set_matches, &lookup);
+
+    if(hit)
+    {
+        *out = hit->set;
+        m->reuse_hits++;
+    }
+    else
+    {
+        m->reuse_misses++;
+
+        r = allocate_and_write(m, entry, info, writes, write_count, out);
+        if(r == VK_SUCCESS)
+        {
+            DescriptorWrittenSet* ws = key_arena_alloc(&m->written_arena, sizeof(DescriptorWrittenSet));
+            uint8_t*              c  = key_arena_alloc(&m->written_arena, content_size);
+            memcpy(c, content, content_size);
+
+            ws->layout_key   = &entry->key;
+            ws->set          = *out;
+            ws->content_size = (uint32_t)content_size;
+            ws->content      = c;
+            hash_index_insert(&m->written_index, hash, ws);
+        }
+    }
+
+    if(content != stack_content)
+        free(content);
+
+    return r;
 }
 
 
@@ -220,5 +991,5 @@ VkResult descriptor_manager_allocate(DescriptorAllocatorManager*            m,
 // descriptor_manager_allocate(&persistent, &layout_cache, &info, &set);
 //
 // per-frame reset
-// descriptor_allocator_reset(&per_frame[current_frame].buckets[i].alloc);
+// descriptor_allocator_manager_reset(&per_frame[current_frame]);
 //
@@ -1,4 +1,6 @@
 #include "vk_defaults.h"
+#include "vk_hashmap.h"
+#include "vk_thread.h"
 
 
 #ifndef VK_DESCRIPTOR_H_
@@ -7,66 +9,200 @@
 typedef struct DescriptorPoolChunk
 {
     VkDescriptorPool pool;
-    float            scale;
+    uint32_t         max_sets;
+    uint32_t         descriptor_count;  // sum over all pool sizes, for stats
+    uint32_t         idle_frames;       // resets survived without serving an allocation
+    bool             used;              // served an allocation since the last reset
 } DescriptorPoolChunk;
 
+typedef struct DescriptorAllocatorConfig
+{
+    uint32_t initial_sets;                // maxSets of the first pool, until a rate has been learned
+    uint32_t min_sets_per_pool;           // floor for sizes learned from the allocation rate
+    uint32_t max_sets_per_pool;           // growth stops here
+    float    growth_factor;               // next pool = previous * factor
+    uint32_t idle_frames_before_release;  // 0 keeps pools until destroy
+} DescriptorAllocatorConfig;
+
+typedef struct DescriptorAllocatorStats
+{
+    uint32_t ready_pools;
+    uint32_t full_pools;
+    uint64_t bytes_held;  // estimate, see DESCRIPTOR_POOL_BYTES_PER_DESCRIPTOR
+    uint64_t pools_created;
+    uint64_t pools_released;
+    uint64_t set_reuse_hits;    // manager only, see descriptor_manager_get_written_set
+    uint64_t set_reuse_misses;
+} DescriptorAllocatorStats;
+
+// rough per-descriptor driver footprint, only feeds DescriptorAllocatorStats
+#define DESCRIPTOR_POOL_BYTES_PER_DESCRIPTOR 32u
+// distinct descriptor types one allocator sizes its pools for
+#define DESCRIPTOR_POOL_MAX_TYPES 16
+
 typedef struct DescriptorAllocator
 {
-    VkDevice             device;
-    DescriptorPoolChunk* pools;
+    VkDevice                  device;
+    DescriptorAllocatorConfig config;
+    DescriptorPoolChunk*      ready;      // stretchy buffer, last one is allocated from
+    DescriptorPoolChunk*      full;       // ran out of space since the last reset
+    uint32_t                  next_sets;  // maxSets of the next pool we create
+    DescriptorAllocatorStats  stats;
+
+    // what a single set consumes per descriptor type, 0 entries falls back to a generic mix
+    VkDescriptorPoolSize set_sizes[DESCRIPTOR_POOL_MAX_TYPES];
+    uint32_t             set_size_count;
+    uint32_t             inline_block_bindings;  // per set, inline uniform block sizes above are bytes
+
+    // allocation rate, learned across resets
+    uint32_t sets_this_frame;
+    float    sets_per_frame;  // smoothed, 0 until the first reset
 } DescriptorAllocator;
 
+// one binding of a canonical layout key; plain 32 bit fields so keys hash and compare as bytes
+typedef struct DescriptorLayoutBindingKey
+{
+    uint32_t                 binding;
+    VkDescriptorType         type;
+    uint32_t                 count;
+    VkShaderStageFlags       stages;
+    VkDescriptorBindingFlags flags;               // from VkDescriptorSetLayoutBindingFlagsCreateInfo
+    uint32_t                 immutable_samplers;  // how many handles this binding takes from the key's sampler list
+} DescriptorLayoutBindingKey;
+
+// canonical form of a VkDescriptorSetLayoutCreateInfo: bindings sorted by
+// binding number, so the same logical layout always yields the same key
 typedef struct DescriptorLayoutKey
 {
-    uint32_t                     binding_count;
-    VkDescriptorSetLayoutBinding bindings[16];
-    uint32_t                     hash;
+    Hash64                            hash;
+    VkDescriptorSetLayoutCreateFlags  flags;
+    uint32_t                          binding_count;
+    uint32_t                          sampler_count;
+    const DescriptorLayoutBindingKey* bindings;
+    const VkSampler*                  samplers;  // immutable samplers in binding order
 } DescriptorLayoutKey;
 
-// cache entry
+// cache entry, key storage is interned in the cache arena
 typedef struct DescriptorLayoutEntry
 {
     DescriptorLayoutKey   key;
     VkDescriptorSetLayout layout;
 } DescriptorLayoutEntry;
 
+// bump allocator for interned keys, nothing moves or is freed until destroy
+typedef struct DescriptorKeyArena
+{
+    uint8_t** blocks;  // stretchy buffer
+    size_t    used;    // bytes taken from the last block
+    size_t    capacity;
+} DescriptorKeyArena;
+
+#define DESCRIPTOR_KEY_ARENA_BLOCK_SIZE (16u * 1024u)
+
+// safe to share between threads: hits are lock-free, misses serialize on lock
 typedef struct DescriptorLayoutCache
 {
-    DescriptorLayoutEntry* entries;
+    DescriptorLayoutEntry** entries;  // stretchy buffer of interned entries
+    HashIndex               index;    // key hash -> entry
+    DescriptorKeyArena      arena;    // entries and their binding/sampler arrays
+    Mutex                   lock;     // guards entries, arena and inserts into index
 } DescriptorLayoutCache;
 
 // manager bucket
+// interned keys are unique per layout cache, so buckets compare them by address
 typedef struct DescriptorAllocatorBucket
 {
-    DescriptorLayoutKey key;
-    DescriptorAllocator alloc;
+    const DescriptorLayoutKey* key;
+    DescriptorAllocator        alloc;
 } DescriptorAllocatorBucket;
 
+// a set written this frame, identified by its layout and the serialized writes
+typedef struct DescriptorWrittenSet
+{
+    const DescriptorLayoutKey* layout_key;  // interned
+    VkDescriptorSet            set;
+    uint32_t                   content_size;
+    const uint8_t*             content;
+} DescriptorWrittenSet;
+
 // master manager
 typedef struct DescriptorAllocatorManager
 {
-    VkDevice                   device;
-    DescriptorAllocatorBucket* buckets;
+    VkDevice                    device;
+    DescriptorAllocatorConfig   config;   // applied to every bucket
+    DescriptorAllocatorBucket** buckets;  // stretchy buffer of stable bucket pointers
+    HashIndex                   index;    // key hash -> bucket
+
+    // content addressed reuse, everything below is dropped on reset with the sets themselves
+    bool               reuse_written_sets;
+    HashIndex          written_index;  // (layout, contents) hash -> DescriptorWrittenSet
+    DescriptorKeyArena written_arena;  // DescriptorWrittenSet and their contents
+    uint64_t           reuse_hits;
+    uint64_t           reuse_misses;
 } DescriptorAllocatorManager;
 
 // allocator API
-void     descriptor_allocator_init(DescriptorAllocator* alloc, VkDevice device);
-void     descriptor_allocator_destroy(DescriptorAllocator* alloc);
+DescriptorAllocatorConfig descriptor_allocator_config_default(void);
+
+// per-set descriptor count scaled to a pool of max_sets, saturating at UINT32_MAX;
+// sets_per_unit is how many sets per_set describes
+uint32_t descriptor_pool_scaled_count(uint32_t per_set, uint32_t max_sets, uint32_t sets_per_unit);
+
+void descriptor_allocator_init(DescriptorAllocator* alloc, VkDevice device);
+void descriptor_allocator_init_with_config(DescriptorAllocator* alloc, VkDevice device, const DescriptorAllocatorConfig* config);
+void descriptor_allocator_destroy(DescriptorAllocator* alloc);
+// size future pools for exactly this binding mix instead of the generic one
+void descriptor_allocator_set_binding_mix(DescriptorAllocator* alloc, const VkDescriptorSetLayoutBinding* bindings, uint32_t binding_count);
+// resets every pool back to ready, releases pools idle for too long
 void     descriptor_allocator_reset(DescriptorAllocator* alloc);
 VkResult descriptor_allocator_allocate(DescriptorAllocator* alloc, VkDescriptorSetLayout layout, VkDescriptorSet* out);
+// one vkAllocateDescriptorSets call for all count sets
+VkResult descriptor_allocator_allocate_many(DescriptorAllocator* alloc, const VkDescriptorSetLayout* layouts, uint32_t count, VkDescriptorSet* out);
+void     descriptor_allocator_get_stats(const DescriptorAllocator* alloc, DescriptorAllocatorStats* out);
 
 // layout cache API
 void descriptor_layout_cache_init(DescriptorLayoutCache* cache);
 void descriptor_layout_cache_destroy(VkDevice device, DescriptorLayoutCache* cache);
 VkDescriptorSetLayout descriptor_layout_cache_get(VkDevice device, DescriptorLayoutCache* cache, const VkDescriptorSetLayoutCreateInfo* info);
+// interned entry for info, created on first use; the pointer stays valid until destroy
+const DescriptorLayoutEntry* descriptor_layout_cache_get_entry(VkDevice device, DescriptorLayoutCache* cache, const VkDescriptorSetLayoutCreateInfo* info);
 
 // manager API
-void     descriptor_allocator_manager_init(DescriptorAllocatorManager* m, VkDevice device);
-void     descriptor_allocator_manager_destroy(DescriptorAllocatorManager* m);
+void descriptor_allocator_manager_init(DescriptorAllocatorManager* m, VkDevice device);
+void descriptor_allocator_manager_init_with_config(DescriptorAllocatorManager* m, VkDevice device, const DescriptorAllocatorConfig* config);
+void descriptor_allocator_manager_destroy(DescriptorAllocatorManager* m);
+void descriptor_allocator_manager_reset(DescriptorAllocatorManager* m);
+// sums the stats of every bucket
+void     descriptor_allocator_manager_get_stats(const DescriptorAllocatorManager* m, DescriptorAllocatorStats* out);
+// off by default; when on, descriptor_manager_get_written_set hands out identical sets from this frame
+void     descriptor_allocator_manager_set_reuse(DescriptorAllocatorManager* m, bool enable);
 VkResult descriptor_manager_allocate(DescriptorAllocatorManager*            m,
                                      DescriptorLayoutCache*                 cache,
                                      const VkDescriptorSetLayoutCreateInfo* info,
                                      VkDescriptorSet*                       out);
+// count sets of one layout, hashed and looked up once
+VkResult descriptor_manager_allocate_n(DescriptorAllocatorManager*            m,
+                                       DescriptorLayoutCache*                 cache,
+                                       const VkDescriptorSetLayoutCreateInfo* info,
+                                       uint32_t                               count,
+                                       VkDescriptorSet*                       out);
+// one set per info; infos are grouped by bucket and each bucket is allocated in a single call
+VkResult descriptor_manager_allocate_many(DescriptorAllocatorManager*            m,
+                                          DescriptorLayoutCache*                 cache,
+                                          const VkDescriptorSetLayoutCreateInfo* infos,
+                                          uint32_t                               count,
+                                          VkDescriptorSet*                       out);
+
+// a set of this layout holding exactly these writes (dstSet is ignored).
+// with reuse enabled a set written earlier this frame with the same contents
+// is returned without allocating or updating. writes that chain pNext
+// (inline uniform blocks, acceleration structures) are never reused
+VkResult descriptor_manager_get_written_set(DescriptorAllocatorManager*            m,
+                                            DescriptorLayoutCache*                 cache,
+                                            const VkDescriptorSetLayoutCreateInfo* info,
+                                            const VkWriteDescriptorSet*            writes,
+                                            uint32_t                               write_count,
+                                            VkDescriptorSet*                       out);
 
 // helpers
 VkDescriptorSetLayout get_or_create_set_layout(VkDevice                            device,
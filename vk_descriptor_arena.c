@@ -0,0 +1,259 @@
+#include "vk_descriptor_arena.h"
+#include "vk_sync.h"
+
+// slack kept on top of the high-water mark when a frame's pool is resized
+#define ARENA_HEADROOM 1.25f
+
+// per-set descriptor budget until descriptor_arena_set_pool_sizes says otherwise
+static const VkDescriptorPoolSize default_set_sizes[] = {
+    {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2},
+    {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1},
+    {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2},
+    {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4},
+    {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 2},
+    {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1},
+    {VK_DESCRIPTOR_TYPE_SAMPLER, 1},
+};
+
+static DescriptorPoolChunk create_arena_pool(const DescriptorArena* arena, uint32_t max_sets)
+{
+    VkDescriptorPoolSize sizes[DESCRIPTOR_POOL_MAX_TYPES];
+    uint64_t             total = 0;
+
+    for(uint32_t i = 0; i < arena->set_size_count; i++)
+    {
+        sizes[i].type            = arena->set_sizes[i].type;
+        sizes[i].descriptorCount = descriptor_pool_scaled_count(arena->set_sizes[i].descriptorCount, max_sets, 1);
+        total += sizes[i].descriptorCount;
+    }
+
+    // no FREE_DESCRIPTOR_SET_BIT: sets only ever go away with the whole pool
+    VkDescriptorPoolCreateInfo info = {
+        .sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .flags         = 0,
+        .maxSets       = max_sets,
+        .poolSizeCount = arena->set_size_count,
+        .pPoolSizes    = sizes,
+    };
+
+    DescriptorPoolChunk chunk = {.max_sets = max_sets, .descriptor_count = (uint32_t)MIN(total, (uint64_t)UINT32_MAX)};
+    VK_CHECK(vkCreateDescriptorPool(arena->device, &info, NULL, &chunk.pool));
+    return chunk;
+}
+
+static DescriptorPoolChunk* push_arena_pool(DescriptorArena* arena, DescriptorArenaFrame* f, uint32_t max_sets)
+{
+    arrpush(f->pools, create_arena_pool(arena, max_sets));
+    f->capacity += max_sets;
+    return &f->pools[arrlen(f->pools) - 1];
+}
+
+static void destroy_frame_pools(DescriptorArena* arena, DescriptorArenaFrame* f)
+{
+    for(int i = 0; i < arrlen(f->pools); i++)
+        vkDestroyDescriptorPool(arena->device, f->pools[i].pool, NULL);
+
+    arrsetlen(f->pools, 0);
+    f->capacity = 0;
+}
+
+static uint32_t high_water_mark(const DescriptorArena* arena)
+{
+    uint32_t peak = 0;
+    for(uint32_t i = 0; i < DESCRIPTOR_ARENA_HISTORY; i++)
+        peak = MAX(peak, arena->history[i]);
+    return peak;
+}
+
+// pool size a fresh frame starts with
+static uint32_t target_sets(const DescriptorArena* arena)
+{
+    uint32_t wanted = (uint32_t)((float)high_water_mark(arena) * ARENA_HEADROOM) + 1;
+    return round_up(MAX(wanted, DESCRIPTOR_ARENA_MIN_SETS), 16);
+}
+
+static bool frame_retired(const DescriptorArena* arena, const DescriptorArenaFrame* f)
+{
+    if(!f->in_flight)
+        return true;
+
+    if(f->fence != VK_NULL_HANDLE)
+        return vk_fence_is_signaled(arena->device, f->fence);
+
+    if(f->timeline != VK_NULL_HANDLE)
+    {
+        uint64_t value = 0;
+        VK_CHECK(vkGetSemaphoreCounterValue(arena->device, f->timeline, &value));
+        return value >= f->timeline_value;
+    }
+
+    return true;
+}
+
+static void wait_frame(const DescriptorArena* arena, const DescriptorArenaFrame* f)
+{
+    if(f->fence != VK_NULL_HANDLE)
+    {
+        vk_wait_fence(arena->device, f->fence, UINT64_MAX);
+    }
+    else if(f->timeline != VK_NULL_HANDLE)
+    {
+        VkSemaphoreWaitInfo info = {
+            .sType          = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+            .semaphoreCount = 1,
+            .pSemaphores    = &f->timeline,
+            .pValues        = &f->timeline_value,
+        };
+        VK_CHECK(vkWaitSemaphores(arena->device, &info, UINT64_MAX));
+    }
+}
+
+// the GPU is done with f: recycle its memory, folding overflow pools back into one
+static void reset_frame(DescriptorArena* arena, DescriptorArenaFrame* f)
+{
+    uint32_t target = target_sets(arena);
+
+    if(arrlen(f->pools) > 1 || f->capacity < target)
+    {
+        destroy_frame_pools(arena, f);
+        push_arena_pool(arena, f, target);
+    }
+    else
+    {
+        for(int i = 0; i < arrlen(f->pools); i++)
+            VK_CHECK(vkResetDescriptorPool(arena->device, f->pools[i].pool, 0));
+    }
+
+    f->sets_allocated = 0;
+    f->fence          = VK_NULL_HANDLE;
+    f->timeline       = VK_NULL_HANDLE;
+    f->timeline_value = 0;
+    f->in_flight      = false;
+}
+
+void descriptor_arena_init(DescriptorArena* arena, VkDevice device, uint32_t frame_count)
+{
+    assert(frame_count > 0 && frame_count <= DESCRIPTOR_ARENA_MAX_FRAMES);
+
+    memset(arena, 0, sizeof(*arena));
+    arena->device      = device;
+    arena->frame_count = frame_count;
+
+    descriptor_arena_set_pool_sizes(arena, default_set_sizes, sizeof default_set_sizes / sizeof default_set_sizes[0]);
+}
+
+void descriptor_arena_destroy(DescriptorArena* arena)
+{
+    for(uint32_t i = 0; i < arena->frame_count; i++)
+    {
+        destroy_frame_pools(arena, &arena->frames[i]);
+        arrfree(arena->frames[i].pools);
+    }
+}
+
+void descriptor_arena_set_pool_sizes(DescriptorArena* arena, const VkDescriptorPoolSize* sizes, uint32_t count)
+{
+    assert(count <= DESCRIPTOR_POOL_MAX_TYPES);
+
+    memcpy(arena->set_sizes, sizes, count * sizeof(VkDescriptorPoolSize));
+    arena->set_size_count = count;
+}
+
+void descriptor_arena_begin_frame(DescriptorArena* arena)
+{
+    arena->frame_index      = (arena->frame_index + 1) % arena->frame_count;
+    DescriptorArenaFrame* f = &arena->frames[arena->frame_index];
+
+    if(f->in_flight && !frame_retired(arena, f))
+    {
+        wait_frame(arena, f);
+        arena->stats.frames_waited++;
+    }
+
+    if(f->in_flight || f->sets_allocated > 0)
+        reset_frame(arena, f);
+}
+
+static void close_frame(DescriptorArena* arena, DescriptorArenaFrame* f)
+{
+    arena->history[arena->history_cursor] = f->sets_allocated;
+    arena->history_cursor                 = (arena->history_cursor + 1) % DESCRIPTOR_ARENA_HISTORY;
+    f->in_flight                          = true;
+}
+
+void descriptor_arena_end_frame(DescriptorArena* arena, VkFence fence)
+{
+    DescriptorArenaFrame* f = &arena->frames[arena->frame_index];
+    f->fence                = fence;
+    close_frame(arena, f);
+}
+
+void descriptor_arena_end_frame_timeline(DescriptorArena* arena, VkSemaphore timeline, uint64_t value)
+{
+    DescriptorArenaFrame* f = &arena->frames[arena->frame_index];
+    f->timeline             = timeline;
+    f->timeline_value       = value;
+    close_frame(arena, f);
+}
+
+void descriptor_arena_collect(DescriptorArena* arena)
+{
+    for(uint32_t i = 0; i < arena->frame_count; i++)
+    {
+        DescriptorArenaFrame* f = &arena->frames[i];
+        if(f->in_flight && frame_retired(arena, f))
+            reset_frame(arena, f);
+    }
+}
+
+static bool pool_out_of_memory(VkResult r)
+{
+    return r == VK_ERROR_OUT_OF_POOL_MEMORY || r == VK_ERROR_FRAGMENTED_POOL;
+}
+
+VkResult descriptor_arena_allocate_many(DescriptorArena* arena, const VkDescriptorSetLayout* layouts, uint32_t count, VkDescriptorSet* out)
+{
+    if(count == 0)
+        return VK_SUCCESS;
+
+    DescriptorArenaFrame* f = &arena->frames[arena->frame_index];
+    assert(!f->in_flight);
+
+    DescriptorPoolChunk* chunk = arrlen(f->pools) > 0 ? &f->pools[arrlen(f->pools) - 1] : push_arena_pool(arena, f, target_sets(arena));
+
+    VkDescriptorSetAllocateInfo info = {.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+                                        .descriptorPool     = chunk->pool,
+                                        .descriptorSetCount = count,
+                                        .pSetLayouts        = layouts};
+
+    VkResult r = vkAllocateDescriptorSets(arena->device, &info, out);
+
+    if(pool_out_of_memory(r))
+    {
+        // this frame outgrew the high-water mark, chain a pool as big as everything so far
+        chunk               = push_arena_pool(arena, f, MAX(f->capacity, round_up(count, 16)));
+        info.descriptorPool = chunk->pool;
+        r                   = vkAllocateDescriptorSets(arena->device, &info, out);
+
+        arena->stats.overflow_pools++;
+    }
+
+    if(r == VK_SUCCESS)
+    {
+        f->sets_allocated += count;
+        arena->stats.sets_allocated += count;
+    }
+
+    return r;
+}
+
+VkResult descriptor_arena_allocate(DescriptorArena* arena, VkDescriptorSetLayout layout, VkDescriptorSet* out)
+{
+    return descriptor_arena_allocate_many(arena, &layout, 1, out);
+}
+
+void descriptor_arena_get_stats(const DescriptorArena* arena, DescriptorArenaStats* out)
+{
+    *out                 = arena->stats;
+    out->high_water_sets = high_water_mark(arena);
+}
@@ -0,0 +1,85 @@
+#ifndef VK_DESCRIPTOR_ARENA_H_
+#define VK_DESCRIPTOR_ARENA_H_
+
+#include "vk_defaults.h"
+#include "vk_descriptor.h"
+
+/* ------------------ Transient descriptor arena ------------------ */
+//
+// Per-frame linear allocator for descriptor sets that live for one frame.
+// Sets are never freed individually, so pools are created without
+// FREE_DESCRIPTOR_SET_BIT and a frame is recycled with vkResetDescriptorPool
+// once the GPU is done with it.
+//
+//   descriptor_arena_begin_frame(&arena);          // waits for this slot's previous frame
+//   descriptor_arena_allocate(&arena, layout, &set);
+//   ...submit...
+//   descriptor_arena_end_frame(&arena, fence);     // or _end_frame_timeline(sem, value)
+//
+// Each frame slot starts with one pool sized from the highest set count
+// seen over the last DESCRIPTOR_ARENA_HISTORY frames; overflow chains
+// extra pools that get folded back into one on the next reuse.
+
+#define DESCRIPTOR_ARENA_MAX_FRAMES 4
+#define DESCRIPTOR_ARENA_HISTORY 16
+#define DESCRIPTOR_ARENA_MIN_SETS 64u
+
+typedef struct DescriptorArenaFrame
+{
+    DescriptorPoolChunk* pools;  // stretchy buffer, the last one is allocated from
+    uint32_t             sets_allocated;
+    uint32_t             capacity;  // maxSets summed over pools
+
+    // retire condition, set by end_frame
+    VkFence     fence;
+    VkSemaphore timeline;
+    uint64_t    timeline_value;
+    bool        in_flight;
+} DescriptorArenaFrame;
+
+typedef struct DescriptorArenaStats
+{
+    uint32_t high_water_sets;  // largest frame in the history window
+    uint32_t overflow_pools;   // pools chained because the first one ran out, cumulative
+    uint64_t sets_allocated;   // cumulative
+    uint64_t frames_waited;    // begin_frame had to block on the GPU
+} DescriptorArenaStats;
+
+typedef struct DescriptorArena
+{
+    VkDevice             device;
+    uint32_t             frame_count;
+    uint32_t             frame_index;
+    DescriptorArenaFrame frames[DESCRIPTOR_ARENA_MAX_FRAMES];
+
+    // per-set descriptor budget used to size pools
+    VkDescriptorPoolSize set_sizes[DESCRIPTOR_POOL_MAX_TYPES];
+    uint32_t             set_size_count;
+
+    uint32_t             history[DESCRIPTOR_ARENA_HISTORY];  // sets used by recent frames
+    uint32_t             history_cursor;
+    DescriptorArenaStats stats;
+} DescriptorArena;
+
+// frame_count is the number of frames in flight, at most DESCRIPTOR_ARENA_MAX_FRAMES
+void descriptor_arena_init(DescriptorArena* arena, VkDevice device, uint32_t frame_count);
+void descriptor_arena_destroy(DescriptorArena* arena);
+
+// replace the generic per-set descriptor mix pools are sized with
+void descriptor_arena_set_pool_sizes(DescriptorArena* arena, const VkDescriptorPoolSize* sizes, uint32_t count);
+
+// moves to the next frame slot, waiting for its retire condition if it is still in flight
+void descriptor_arena_begin_frame(DescriptorArena* arena);
+// the current frame retires when fence signals
+void descriptor_arena_end_frame(DescriptorArena* arena, VkFence fence);
+// the current frame retires when timeline reaches value
+void descriptor_arena_end_frame_timeline(DescriptorArena* arena, VkSemaphore timeline, uint64_t value);
+// resets every in-flight frame whose work already finished, never blocks
+void descriptor_arena_collect(DescriptorArena* arena);
+
+VkResult descriptor_arena_allocate(DescriptorArena* arena, VkDescriptorSetLayout layout, VkDescriptorSet* out);
+VkResult descriptor_arena_allocate_many(DescriptorArena* arena, const VkDescriptorSetLayout* layouts, uint32_t count, VkDescriptorSet* out);
+
+void descriptor_arena_get_stats(const DescriptorArena* arena, DescriptorArenaStats* out);
+
+#endif // VK_DESCRIPTOR_ARENA_H_
@@ -61,7 +61,7 @@ static VkDescriptorPool create_frame_pool(VkDevice device)
     return pool;
 }
 
-static void create_set0_layout(VkDevice device, BindlessSet0Layout* out)
+static void create_set0_layout(VkDevice device, BindlessSet0Layout* out, bool descriptor_buffer)
 {
     /*
      * Set 0 contains all bindless resources with special flags:
@@ -84,6 +84,13 @@ static void create_set0_layout(VkDevice device, BindlessSet0Layout* out)
         VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT,  // storage buffers
     };
 
+    // descriptor buffers have no update-after-bind: writes land in memory directly
+    if (descriptor_buffer)
+    {
+        for (uint32_t i = 0; i < 4; i++)
+            binding_flags[i] &= ~VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT;
+    }
+
     VkDescriptorSetLayoutBindingFlagsCreateInfo binding_flags_info = {
         .sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
         .bindingCount  = 4,
@@ -124,7 +131,8 @@ static void create_set0_layout(VkDevice device, BindlessSet0Layout* out)
     VkDescriptorSetLayoutCreateInfo info = {
         .sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
         .pNext        = &binding_flags_info,
-        .flags        = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT,
+        .flags        = descriptor_buffer ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT :
+                                            VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT,
         .bindingCount = 4,
         .pBindings    = bindings,
     };
@@ -132,7 +140,7 @@ static void create_set0_layout(VkDevice device, BindlessSet0Layout* out)
     VK_CHECK(vkCreateDescriptorSetLayout(device, &info, NULL, &out->layout));
 }
 
-static void create_set1_layout(VkDevice device, BindlessSet1Layout* out)
+static void create_set1_layout(VkDevice device, BindlessSet1Layout* out, bool descriptor_buffer)
 {
     VkDescriptorSetLayoutBinding bindings[] = {
         // Binding 0: Global UBO
@@ -167,11 +175,16 @@ static void create_set1_layout(VkDevice device, BindlessSet1Layout* out)
 
     VkDescriptorSetLayoutCreateInfo info = {
         .sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .flags        = descriptor_buffer ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT : 0,
         .bindingCount = 4,
         .pBindings    = bindings,
     };
 
     VK_CHECK(vkCreateDescriptorSetLayout(device, &info, NULL, &out->layout));
+
+    // templates update sets, the descriptor buffer backend has none
+    if (!descriptor_buffer)
+        descriptor_template_create(device, out->layout, bindings, info.bindingCount, &out->update_template);
 }
 
 static VkDescriptorSet allocate_set(VkDevice device, VkDescriptorPool pool, VkDescriptorSetLayout layout)
@@ -188,6 +201,126 @@ static VkDescriptorSet allocate_set(VkDevice device, VkDescriptorPool pool, VkDe
     return set;
 }
 
+/* =============================================================================
+ * DESCRIPTOR BUFFER BACKEND
+ * =============================================================================
+ */
+
+static bool descriptor_buffer_available(VkPhysicalDevice physical_device)
+{
+#if BINDLESS_USE_DESCRIPTOR_BUFFER
+    // volk leaves these NULL unless the device enabled VK_EXT_descriptor_buffer
+    if (!vkGetDescriptorEXT || !vkCmdBindDescriptorBuffersEXT || !vkCmdSetDescriptorBufferOffsetsEXT)
+        return false;
+
+    return bindless_check_descriptor_buffer_support(physical_device);
+#else
+    (void)physical_device;
+    return false;
+#endif
+}
+
+static size_t descriptor_size(const BindlessDescriptorSystem* sys, VkDescriptorType type)
+{
+    const VkPhysicalDeviceDescriptorBufferPropertiesEXT* props = &sys->descriptor_buffer_props;
+
+    switch (type)
+    {
+        case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:  return props->sampledImageDescriptorSize;
+        case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:  return props->storageImageDescriptorSize;
+        case VK_DESCRIPTOR_TYPE_SAMPLER:        return props->samplerDescriptorSize;
+        case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+            return sys->robust_buffer_access ? props->robustUniformBufferDescriptorSize : props->uniformBufferDescriptorSize;
+        default:
+            return sys->robust_buffer_access ? props->robustStorageBufferDescriptorSize : props->storageBufferDescriptorSize;
+    }
+}
+
+static VkDeviceSize align_offset(VkDeviceSize value, VkDeviceSize alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// Set 0 first, then one set 1 region per frame, each at the required offset alignment
+static void create_descriptor_buffer(BindlessDescriptorSystem* sys, VkPhysicalDevice physical_device)
+{
+    sys->descriptor_buffer_props = (VkPhysicalDeviceDescriptorBufferPropertiesEXT){
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_PROPERTIES_EXT,
+    };
+
+    VkPhysicalDeviceProperties2 props = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+        .pNext = &sys->descriptor_buffer_props,
+    };
+    vkGetPhysicalDeviceProperties2(physical_device, &props);
+
+    VkDeviceSize alignment = sys->descriptor_buffer_props.descriptorBufferOffsetAlignment;
+
+    VkDeviceSize set0_size, set1_size;
+    vkGetDescriptorSetLayoutSizeEXT(sys->device, sys->set0_layout.layout, &set0_size);
+    vkGetDescriptorSetLayoutSizeEXT(sys->device, sys->set1_layout.layout, &set1_size);
+
+    for (uint32_t b = 0; b < 4; b++)
+    {
+        vkGetDescriptorSetLayoutBindingOffsetEXT(sys->device, sys->set0_layout.layout, b, &sys->set0_binding_offsets[b]);
+        vkGetDescriptorSetLayoutBindingOffsetEXT(sys->device, sys->set1_layout.layout, b, &sys->set1_binding_offsets[b]);
+    }
+
+    VkDeviceSize size = align_offset(set0_size, alignment);
+    for (uint32_t i = 0; i < BINDLESS_MAX_FRAMES_IN_FLIGHT; i++)
+    {
+        sys->frames[i].set1_offset = size;
+        size = align_offset(size + set1_size, alignment);
+    }
+
+    res_create_buffer(sys->allocator,
+                      sys->device,
+                      size,
+                      VK_BUFFER_USAGE_2_SAMPLER_DESCRIPTOR_BUFFER_BIT_EXT | VK_BUFFER_USAGE_2_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT,
+                      VMA_MEMORY_USAGE_CPU_TO_GPU,
+                      VMA_ALLOCATION_CREATE_MAPPED_BIT,
+                      alignment,
+                      &sys->descriptor_buffer);
+}
+
+// Write one descriptor at a byte offset into the descriptor buffer
+static void write_descriptor(BindlessDescriptorSystem* sys, VkDeviceSize offset, VkDescriptorType type, VkDescriptorDataEXT data)
+{
+    VkDescriptorGetInfoEXT info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_GET_INFO_EXT,
+        .type  = type,
+        .data  = data,
+    };
+
+    vkGetDescriptorEXT(sys->device, &info, descriptor_size(sys, type), sys->descriptor_buffer.mapping + offset);
+}
+
+static VkDeviceSize set0_element_offset(const BindlessDescriptorSystem* sys, uint32_t binding, VkDescriptorType type, uint32_t idx)
+{
+    return sys->set0_binding_offsets[binding] + idx * descriptor_size(sys, type);
+}
+
+static void write_buffer_descriptor(BindlessDescriptorSystem* sys,
+                                    VkDeviceSize offset,
+                                    VkDescriptorType type,
+                                    VkDeviceAddress address,
+                                    VkDeviceSize range)
+{
+    VkDescriptorAddressInfoEXT address_info = {
+        .sType   = VK_STRUCTURE_TYPE_DESCRIPTOR_ADDRESS_INFO_EXT,
+        .address = address,
+        .range   = range,
+    };
+
+    VkDescriptorDataEXT data;
+    if (type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
+        data.pUniformBuffer = &address_info;
+    else
+        data.pStorageBuffer = &address_info;
+
+    write_descriptor(sys, offset, type, data);
+}
+
 static void create_frame_resources(BindlessDescriptorSystem* sys, uint32_t frame_idx)
 {
     BindlessFrameResources* frame = &sys->frames[frame_idx];
@@ -236,6 +369,23 @@ static void create_frame_resources(BindlessDescriptorSystem* sys, uint32_t frame
                       4,
                       &frame->draw_count_buffer);
 
+    if (sys->use_descriptor_buffer)
+    {
+        // Set 1 region for this frame, same four buffers written as raw descriptors
+        const Buffer* buffers[4] = {&frame->global_buffer, &frame->draw_data_buffer, &sys->material_buffer, &sys->transform_buffer};
+
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            VkDescriptorType type  = i == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            VkDeviceSize     range = i == 0 ? sizeof(BindlessGlobalData) : buffers[i]->buffer_size;
+
+            write_buffer_descriptor(sys, frame->set1_offset + sys->set1_binding_offsets[i], type, buffers[i]->address, range);
+        }
+
+        frame->draw_count = 0;
+        return;
+    }
+
     // Allocate Set 1
     frame->set1 = allocate_set(sys->device, sys->frame_pool, sys->set1_layout.layout);
 
@@ -263,42 +413,16 @@ static void create_frame_resources(BindlessDescriptorSystem* sys, uint32_t frame
         },
     };
 
-    VkWriteDescriptorSet writes[4] = {
-        {
-            .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-            .dstSet          = frame->set1,
-            .dstBinding      = 0,
-            .descriptorCount = 1,
-            .descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-            .pBufferInfo     = &buffer_infos[0],
-        },
-        {
-            .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-            .dstSet          = frame->set1,
-            .dstBinding      = 1,
-            .descriptorCount = 1,
-            .descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-            .pBufferInfo     = &buffer_infos[1],
-        },
-        {
-            .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-            .dstSet          = frame->set1,
-            .dstBinding      = 2,
-            .descriptorCount = 1,
-            .descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-            .pBufferInfo     = &buffer_infos[2],
-        },
-        {
-            .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-            .dstSet          = frame->set1,
-            .dstBinding      = 3,
-            .descriptorCount = 1,
-            .descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-            .pBufferInfo     = &buffer_infos[3],
-        },
-    };
+    const DescriptorTemplate* tmpl = &sys->set1_layout.update_template;
+    uint64_t data[4 * sizeof(VkDescriptorBufferInfo) / sizeof(uint64_t)];
+    assert(tmpl->data_size <= sizeof(data));
 
-    vkUpdateDescriptorSets(sys->device, 4, writes, 0, NULL);
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        descriptor_template_write_buffer(tmpl, data, i, 0, &buffer_infos[i]);
+    }
+
+    descriptor_template_update(sys->device, tmpl, frame->set1, data);
 
     frame->draw_count = 0;
 }
@@ -347,6 +471,23 @@ bool bindless_check_support(VkPhysicalDevice physical_device)
 }
 
 
+bool bindless_check_descriptor_buffer_support(VkPhysicalDevice physical_device)
+{
+    VkPhysicalDeviceDescriptorBufferFeaturesEXT descriptor_buffer_features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_FEATURES_EXT,
+    };
+
+    VkPhysicalDeviceFeatures2 features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+        .pNext = &descriptor_buffer_features,
+    };
+
+    vkGetPhysicalDeviceFeatures2(physical_device, &features);
+
+    return descriptor_buffer_features.descriptorBuffer;
+}
+
+
 /* =============================================================================
  * PUBLIC API - INITIALIZATION
  * =============================================================================
@@ -355,27 +496,39 @@ bool bindless_check_support(VkPhysicalDevice physical_device)
 void bindless_init(BindlessDescriptorSystem* sys, 
                    VkDevice device, 
                    VkPhysicalDevice physical_device,
-                   ResourceAllocator* allocator)
+                   ResourceAllocator* allocator,
+                   bool robust_buffer_access)
 {
     memset(sys, 0, sizeof(*sys));
-    sys->device    = device;
-    sys->allocator = allocator;
+    sys->device               = device;
+    sys->allocator            = allocator;
+    sys->robust_buffer_access = robust_buffer_access;
 
     // Check feature support
     sys->supports_descriptor_indexing = true;  // Assume checked before calling
     sys->supports_buffer_device_address = true;
     sys->supports_draw_indirect_count = true;
 
-    // Create pools
-    sys->bindless_pool = create_bindless_pool(device);
-    sys->frame_pool    = create_frame_pool(device);
+    sys->use_descriptor_buffer = descriptor_buffer_available(physical_device);
 
     // Create layouts
-    create_set0_layout(device, &sys->set0_layout);
-    create_set1_layout(device, &sys->set1_layout);
+    create_set0_layout(device, &sys->set0_layout, sys->use_descriptor_buffer);
+    create_set1_layout(device, &sys->set1_layout, sys->use_descriptor_buffer);
+
+    if (sys->use_descriptor_buffer)
+    {
+        // Set 0 and every frame's set 1 live in one descriptor buffer, no pools needed
+        create_descriptor_buffer(sys, physical_device);
+    }
+    else
+    {
+        // Create pools
+        sys->bindless_pool = create_bindless_pool(device);
+        sys->frame_pool    = create_frame_pool(device);
 
-    // Allocate the ONE bindless set (Set 0)
-    sys->set0 = allocate_set(device, sys->bindless_pool, sys->set0_layout.layout);
+        // Allocate the ONE bindless set (Set 0)
+        sys->set0 = allocate_set(device, sys->bindless_pool, sys->set0_layout.layout);
+    }
 
     // Create material storage buffer
     size_t material_buffer_size = 1024 * sizeof(BindlessMaterial);  // Start with 1024 materials
@@ -449,8 +602,6 @@ void bindless_init(BindlessDescriptorSystem* sys,
     sys->transform_count = 0;
     sys->materials_dirty = false;
     sys->transforms_dirty = false;
-
-    (void)physical_device;
 }
 
 void bindless_destroy(BindlessDescriptorSystem* sys)
@@ -472,12 +623,20 @@ void bindless_destroy(BindlessDescriptorSystem* sys)
     arrfree(sys->transforms);
 
     // Destroy layouts
+    descriptor_template_destroy(sys->device, &sys->set1_layout.update_template);
     vkDestroyDescriptorSetLayout(sys->device, sys->set0_layout.layout, NULL);
     vkDestroyDescriptorSetLayout(sys->device, sys->set1_layout.layout, NULL);
 
-    // Destroy pools
-    vkDestroyDescriptorPool(sys->device, sys->bindless_pool, NULL);
-    vkDestroyDescriptorPool(sys->device, sys->frame_pool, NULL);
+    // Destroy pools (or the descriptor buffer that replaced them)
+    if (sys->use_descriptor_buffer)
+    {
+        res_destroy_buffer(sys->allocator, &sys->descriptor_buffer);
+    }
+    else
+    {
+        vkDestroyDescriptorPool(sys->device, sys->bindless_pool, NULL);
+        vkDestroyDescriptorPool(sys->device, sys->frame_pool, NULL);
+    }
 
     // Destroy pipeline layout if created
     if (sys->pipeline_layout != VK_NULL_HANDLE)
@@ -547,6 +706,13 @@ BindlessTextureHandle bindless_register_texture(BindlessDescriptorSystem* sys,
         .imageLayout = layout,
     };
 
+    if (sys->use_descriptor_buffer)
+    {
+        VkDescriptorDataEXT data = {.pSampledImage = &image_info};
+        write_descriptor(sys, set0_element_offset(sys, 0, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, idx), VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, data);
+        return (BindlessTextureHandle){idx, view, format};
+    }
+
     VkWriteDescriptorSet write = {
         .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
         .dstSet          = sys->set0,
@@ -587,6 +753,13 @@ BindlessTextureHandle bindless_register_storage_image(BindlessDescriptorSystem*
         .imageLayout = VK_IMAGE_LAYOUT_GENERAL,
     };
 
+    if (sys->use_descriptor_buffer)
+    {
+        VkDescriptorDataEXT data = {.pStorageImage = &image_info};
+        write_descriptor(sys, set0_element_offset(sys, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, idx), VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, data);
+        return (BindlessTextureHandle){idx, view, format};
+    }
+
     VkWriteDescriptorSet write = {
         .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
         .dstSet          = sys->set0,
@@ -611,6 +784,13 @@ BindlessSamplerHandle bindless_register_sampler(BindlessDescriptorSystem* sys, V
 
     uint32_t idx = sys->next_sampler_idx++;
 
+    if (sys->use_descriptor_buffer)
+    {
+        VkDescriptorDataEXT data = {.pSampler = &sampler};
+        write_descriptor(sys, set0_element_offset(sys, 2, VK_DESCRIPTOR_TYPE_SAMPLER, idx), VK_DESCRIPTOR_TYPE_SAMPLER, data);
+        return (BindlessSamplerHandle){idx, sampler};
+    }
+
     VkDescriptorImageInfo sampler_info = {
         .sampler = sampler,
     };
@@ -640,8 +820,32 @@ BindlessBufferHandle bindless_register_buffer(BindlessDescriptorSystem* sys,
         return (BindlessBufferHandle){BINDLESS_INVALID_INDEX, VK_NULL_HANDLE, 0, 0};
     }
 
+    if (sys->use_descriptor_buffer && range == 0)
+    {
+        // Raw descriptors need an explicit size, VK_WHOLE_SIZE isn't allowed
+        log_error("bindless_register_buffer: range 0 is not supported with descriptor buffers");
+        return (BindlessBufferHandle){BINDLESS_INVALID_INDEX, VK_NULL_HANDLE, 0, 0};
+    }
+
     uint32_t idx = sys->next_buffer_idx++;
 
+    // Get buffer device address
+    VkBufferDeviceAddressInfo addr_info = {
+        .sType  = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO,
+        .buffer = buffer,
+    };
+    VkDeviceAddress address = vkGetBufferDeviceAddress(sys->device, &addr_info);
+
+    if (sys->use_descriptor_buffer)
+    {
+        write_buffer_descriptor(sys,
+                                set0_element_offset(sys, 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, idx),
+                                VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                address + offset,
+                                range);
+        return (BindlessBufferHandle){idx, buffer, address, range};
+    }
+
     VkDescriptorBufferInfo buffer_info = {
         .buffer = buffer,
         .offset = offset,
@@ -660,13 +864,6 @@ BindlessBufferHandle bindless_register_buffer(BindlessDescriptorSystem* sys,
 
     vkUpdateDescriptorSets(sys->device, 1, &write, 0, NULL);
 
-    // Get buffer device address
-    VkBufferDeviceAddressInfo addr_info = {
-        .sType  = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO,
-        .buffer = buffer,
-    };
-    VkDeviceAddress address = vkGetBufferDeviceAddress(sys->device, &addr_info);
-
     return (BindlessBufferHandle){idx, buffer, address, range};
 }
 
@@ -877,6 +1074,21 @@ void bindless_bind(BindlessDescriptorSystem* sys,
 {
     BindlessFrameResources* frame = &sys->frames[sys->current_frame];
 
+    if (sys->use_descriptor_buffer)
+    {
+        VkDescriptorBufferBindingInfoEXT binding = {
+            .sType   = VK_STRUCTURE_TYPE_DESCRIPTOR_BUFFER_BINDING_INFO_EXT,
+            .address = sys->descriptor_buffer.address,
+            .usage   = VK_BUFFER_USAGE_SAMPLER_DESCRIPTOR_BUFFER_BIT_EXT | VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT,
+        };
+        vkCmdBindDescriptorBuffersEXT(cmd, 1, &binding);
+
+        uint32_t     buffer_indices[2] = {0, 0};
+        VkDeviceSize offsets[2]        = {0, frame->set1_offset};
+        vkCmdSetDescriptorBufferOffsetsEXT(cmd, bind_point, layout, 0, 2, buffer_indices, offsets);
+        return;
+    }
+
     VkDescriptorSet sets[2] = {sys->set0, frame->set1};
 
     vkCmdBindDescriptorSets(cmd, bind_point, layout, 0, 2, sets, 0, NULL);
@@ -960,3 +1172,8 @@ VkPipelineLayout bindless_get_pipeline_layout(BindlessDescriptorSystem* sys)
     VK_CHECK(vkCreatePipelineLayout(sys->device, &info, NULL, &sys->pipeline_layout));
     return sys->pipeline_layout;
 }
+
+VkPipelineCreateFlags bindless_get_pipeline_create_flags(const BindlessDescriptorSystem* sys)
+{
+    return sys->use_descriptor_buffer ? VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT : 0;
+}
@@ -128,6 +128,16 @@
  * Vertex v = vertex_ptr.vertices[gl_VertexIndex];
  * gl_Position = viewproj * model * vec4(v.position, 1.0);
  *
+ * DESCRIPTOR BUFFER BACKEND:
+ * --------------------------
+ * When the device was created with VK_EXT_descriptor_buffer (and
+ * BINDLESS_USE_DESCRIPTOR_BUFFER is non-zero), bindless_init skips the
+ * pools entirely. Set 0 and the per-frame set 1 regions live in one host
+ * visible descriptor buffer, registration writes descriptors straight into
+ * the mapping with vkGetDescriptorEXT, and bindless_bind binds the buffer
+ * and sets offsets instead of binding sets. Pipelines used with it must be
+ * created with bindless_get_pipeline_create_flags().
+ *
  * PERFORMANCE CHARACTERISTICS:
  * ----------------------------
  * Pros:
@@ -152,6 +162,7 @@
 
 #include "vk_defaults.h"
 #include "vk_resources.h"
+#include "vk_descriptor_template.h"
 
 // Resource array limits
 #define BINDLESS_MAX_TEXTURES       4096
@@ -166,6 +177,11 @@
 // Invalid index sentinel
 #define BINDLESS_INVALID_INDEX 0xFFFFFFFF
 
+// Set to 0 to always use the descriptor pool path
+#ifndef BINDLESS_USE_DESCRIPTOR_BUFFER
+#define BINDLESS_USE_DESCRIPTOR_BUFFER 1
+#endif
+
 
 /* =============================================================================
  * GPU DATA STRUCTURES (match your GLSL)
@@ -326,6 +342,7 @@ typedef struct BindlessSet0Layout
 typedef struct BindlessSet1Layout
 {
     VkDescriptorSetLayout layout;
+    DescriptorTemplate    update_template;  // all four buffers in one update
     
     // Binding info:
     // 0: uniform GlobalData           - per-frame UBO
@@ -354,8 +371,11 @@ typedef struct BindlessFrameResources
     Buffer indirect_buffer;
     Buffer draw_count_buffer;  // For vkCmdDrawIndirectCount
     
-    // Set 1 descriptor for this frame
+    // Set 1 descriptor for this frame (pool backend)
     VkDescriptorSet set1;
+
+    // Offset of this frame's set 1 in the descriptor buffer (descriptor buffer backend)
+    VkDeviceSize set1_offset;
     
 } BindlessFrameResources;
 
@@ -374,6 +394,14 @@ typedef struct BindlessDescriptorSystem
     bool supports_descriptor_indexing;
     bool supports_buffer_device_address;
     bool supports_draw_indirect_count;
+
+    // Descriptor buffer backend, chosen at init; pools and sets below stay unused
+    bool use_descriptor_buffer;
+    Buffer descriptor_buffer;               // set 0 at offset 0, then one set 1 region per frame
+    VkDeviceSize set0_binding_offsets[4];   // vkGetDescriptorSetLayoutBindingOffsetEXT
+    VkDeviceSize set1_binding_offsets[4];
+    VkPhysicalDeviceDescriptorBufferPropertiesEXT descriptor_buffer_props;  // descriptor sizes
+    bool robust_buffer_access;              // device enabled robustBufferAccess, buffer descriptors use the robust sizes
     
     // Descriptor layouts
     BindlessSet0Layout set0_layout;
@@ -443,11 +471,18 @@ typedef struct BindlessDescriptorSystem
 // Check if device supports bindless features
 bool bindless_check_support(VkPhysicalDevice physical_device);
 
-// Initialize the bindless system
+// Check if the device supports the descriptor buffer backend
+bool bindless_check_descriptor_buffer_support(VkPhysicalDevice physical_device);
+
+// Initialize the bindless system, picks the descriptor buffer backend when the
+// device supports it and was created with VK_EXT_descriptor_buffer enabled.
+// robust_buffer_access must match the feature the device was created with,
+// it selects the UBO/SSBO descriptor sizes of the descriptor buffer backend
 void bindless_init(BindlessDescriptorSystem* sys, 
                    VkDevice device, 
                    VkPhysicalDevice physical_device,
-                   ResourceAllocator* allocator);
+                   ResourceAllocator* allocator,
+                   bool robust_buffer_access);
 
 // Destroy the system
 void bindless_destroy(BindlessDescriptorSystem* sys);
@@ -478,7 +513,8 @@ BindlessTextureHandle bindless_register_storage_image(BindlessDescriptorSystem*
 // Register a sampler
 BindlessSamplerHandle bindless_register_sampler(BindlessDescriptorSystem* sys, VkSampler sampler);
 
-// Register a storage buffer
+// Register a storage buffer; range 0 means the whole buffer, which the
+// descriptor buffer backend can't express, so pass the size there
 BindlessBufferHandle bindless_register_buffer(BindlessDescriptorSystem* sys,
                                                VkBuffer buffer,
                                                VkDeviceSize offset,
@@ -585,6 +621,9 @@ void bindless_get_layouts(BindlessDescriptorSystem* sys, VkDescriptorSetLayout*
 // Get or create pipeline layout
 VkPipelineLayout bindless_get_pipeline_layout(BindlessDescriptorSystem* sys);
 
+// Extra VkPipelineCreateFlags for pipelines bound with bindless_bind
+VkPipelineCreateFlags bindless_get_pipeline_create_flags(const BindlessDescriptorSystem* sys);
+
 
 /* =============================================================================
  * PUSH CONSTANT LAYOUTS (example for vertex buffer address)
@@ -612,7 +651,7 @@ typedef struct BindlessPushConstants
  * }
  *
  * BindlessDescriptorSystem bindless;
- * bindless_init(&bindless, device, physical_device, &allocator);
+ * bindless_init(&bindless, device, physical_device, &allocator, features.core.features.robustBufferAccess);
  * bindless_create_defaults(&bindless, init_cmd);
  *
  * // === LOAD TEXTURES ===
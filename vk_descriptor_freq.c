@@ -23,7 +23,7 @@ static VkDescriptorPool create_freq_pool(VkDevice device)
 
     VkDescriptorPoolCreateInfo info = {
         .sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-        .flags         = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
+        .flags         = 0,  // sets are only released by resetting the pool
         .maxSets       = FREQ_MAX_FRAMES_IN_FLIGHT + FREQ_MAX_MATERIALS + 16,
         .poolSizeCount = (uint32_t)(sizeof(sizes) / sizeof(sizes[0])),
         .pPoolSizes    = sizes,
@@ -74,6 +74,9 @@ static void create_set0_layout(VkDevice device, FreqSet0Layout* out)
     };
 
     VK_CHECK(vkCreateDescriptorSetLayout(device, &info, NULL, &out->layout));
+
+    // shadow and environment maps are optional, the template only covers the UBOs
+    descriptor_template_create(device, out->layout, bindings, 2, &out->update_template);
 }
 
 static void create_set1_layout(VkDevice device, FreqSet1Layout* out)
@@ -130,6 +133,7 @@ static void create_set1_layout(VkDevice device, FreqSet1Layout* out)
     };
 
     VK_CHECK(vkCreateDescriptorSetLayout(device, &info, NULL, &out->layout));
+    descriptor_template_create(device, out->layout, bindings, info.bindingCount, &out->update_template);
 }
 
 static void create_set2_layout(VkDevice device, FreqSet2Layout* out)
@@ -151,6 +155,7 @@ static void create_set2_layout(VkDevice device, FreqSet2Layout* out)
     };
 
     VK_CHECK(vkCreateDescriptorSetLayout(device, &info, NULL, &out->layout));
+    descriptor_template_create(device, out->layout, bindings, info.bindingCount, &out->update_template);
 }
 
 static VkDescriptorSet allocate_set(VkDevice device, VkDescriptorPool pool, VkDescriptorSetLayout layout)
@@ -209,6 +214,8 @@ static void create_frame_resources(FreqDescriptorSystem* sys, uint32_t frame_idx
     frame->set2 = allocate_set(sys->device, sys->pool, sys->set2_layout.layout);
 
     // Write Set 0 descriptors
+    uint64_t data[DESCRIPTOR_TEMPLATE_MAX_ENTRIES * sizeof(VkDescriptorImageInfo) / sizeof(uint64_t)];
+
     VkDescriptorBufferInfo global_info = {
         .buffer = frame->global_buffer.buffer,
         .offset = 0,
@@ -221,26 +228,9 @@ static void create_frame_resources(FreqDescriptorSystem* sys, uint32_t frame_idx
         .range  = sizeof(FreqLightData),
     };
 
-    VkWriteDescriptorSet writes[] = {
-        {
-            .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-            .dstSet          = frame->set0,
-            .dstBinding      = 0,
-            .descriptorCount = 1,
-            .descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-            .pBufferInfo     = &global_info,
-        },
-        {
-            .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-            .dstSet          = frame->set0,
-            .dstBinding      = 1,
-            .descriptorCount = 1,
-            .descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-            .pBufferInfo     = &light_info,
-        },
-    };
-
-    vkUpdateDescriptorSets(sys->device, 2, writes, 0, NULL);
+    descriptor_template_write_buffer(&sys->set0_layout.update_template, data, 0, 0, &global_info);
+    descriptor_template_write_buffer(&sys->set0_layout.update_template, data, 1, 0, &light_info);
+    descriptor_template_update(sys->device, &sys->set0_layout.update_template, frame->set0, data);
 
     // Write Set 2 descriptor (dynamic UBO covers entire buffer)
     VkDescriptorBufferInfo draw_info = {
@@ -249,16 +239,8 @@ static void create_frame_resources(FreqDescriptorSystem* sys, uint32_t frame_idx
         .range  = FREQ_MIN_UBO_ALIGNMENT,  // Size of one draw data (dynamic offset handles the rest)
     };
 
-    VkWriteDescriptorSet draw_write = {
-        .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-        .dstSet          = frame->set2,
-        .dstBinding      = 0,
-        .descriptorCount = 1,
-        .descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
-        .pBufferInfo     = &draw_info,
-    };
-
-    vkUpdateDescriptorSets(sys->device, 1, &draw_write, 0, NULL);
+    descriptor_template_write_buffer(&sys->set2_layout.update_template, data, 0, 0, &draw_info);
+    descriptor_template_update(sys->device, &sys->set2_layout.update_template, frame->set2, data);
 
     frame->draw_count        = 0;
     frame->draw_buffer_offset = 0;
@@ -321,6 +303,9 @@ void freq_destroy(FreqDescriptorSystem* sys)
         vkDestroySampler(sys->device, sys->default_sampler, NULL);
 
     // Destroy layouts
+    descriptor_template_destroy(sys->device, &sys->set0_layout.update_template);
+    descriptor_template_destroy(sys->device, &sys->set1_layout.update_template);
+    descriptor_template_destroy(sys->device, &sys->set2_layout.update_template);
     vkDestroyDescriptorSetLayout(sys->device, sys->set0_layout.layout, NULL);
     vkDestroyDescriptorSetLayout(sys->device, sys->set1_layout.layout, NULL);
     vkDestroyDescriptorSetLayout(sys->device, sys->set2_layout.layout, NULL);
@@ -484,6 +469,10 @@ void freq_material_set_params(FreqDescriptorSystem* sys, uint32_t material_id, c
 
 void freq_material_flush(FreqDescriptorSystem* sys)
 {
+    const DescriptorTemplate* tmpl = &sys->set1_layout.update_template;
+    uint64_t data[DESCRIPTOR_TEMPLATE_MAX_ENTRIES * sizeof(VkDescriptorImageInfo) / sizeof(uint64_t)];
+    assert(tmpl->data_size <= sizeof(data));
+
     for (int i = 0; i < arrlen(sys->materials); i++)
     {
         FreqMaterial* mat = &sys->materials[i];
@@ -499,64 +488,14 @@ void freq_material_flush(FreqDescriptorSystem* sys)
             .range  = sizeof(FreqMaterialParams),
         };
 
-        VkWriteDescriptorSet writes[] = {
-            // Binding 0: Material params UBO
-            {
-                .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-                .dstSet          = mat->set,
-                .dstBinding      = 0,
-                .descriptorCount = 1,
-                .descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-                .pBufferInfo     = &buffer_info,
-            },
-            // Binding 1: Albedo
-            {
-                .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-                .dstSet          = mat->set,
-                .dstBinding      = 1,
-                .descriptorCount = 1,
-                .descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                .pImageInfo      = &mat->albedo,
-            },
-            // Binding 2: Normal
-            {
-                .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-                .dstSet          = mat->set,
-                .dstBinding      = 2,
-                .descriptorCount = 1,
-                .descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                .pImageInfo      = &mat->normal,
-            },
-            // Binding 3: Metallic-roughness
-            {
-                .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-                .dstSet          = mat->set,
-                .dstBinding      = 3,
-                .descriptorCount = 1,
-                .descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                .pImageInfo      = &mat->metallic_roughness,
-            },
-            // Binding 4: Occlusion
-            {
-                .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-                .dstSet          = mat->set,
-                .dstBinding      = 4,
-                .descriptorCount = 1,
-                .descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                .pImageInfo      = &mat->occlusion,
-            },
-            // Binding 5: Emissive
-            {
-                .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-                .dstSet          = mat->set,
-                .dstBinding      = 5,
-                .descriptorCount = 1,
-                .descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                .pImageInfo      = &mat->emissive,
-            },
-        };
+        descriptor_template_write_buffer(tmpl, data, 0, 0, &buffer_info);
+        descriptor_template_write_image(tmpl, data, 1, 0, &mat->albedo);
+        descriptor_template_write_image(tmpl, data, 2, 0, &mat->normal);
+        descriptor_template_write_image(tmpl, data, 3, 0, &mat->metallic_roughness);
+        descriptor_template_write_image(tmpl, data, 4, 0, &mat->occlusion);
+        descriptor_template_write_image(tmpl, data, 5, 0, &mat->emissive);
 
-        vkUpdateDescriptorSets(sys->device, 6, writes, 0, NULL);
+        descriptor_template_update(sys->device, tmpl, mat->set, data);
         mat->dirty = false;
     }
 }
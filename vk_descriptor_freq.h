@@ -71,6 +71,7 @@
 
 #include "vk_defaults.h"
 #include "vk_resources.h"
+#include "vk_descriptor_template.h"
 
 // Maximum frames in flight for per-frame resources
 #define FREQ_MAX_FRAMES_IN_FLIGHT 3
@@ -146,6 +147,7 @@ typedef struct FreqDrawData
 typedef struct FreqSet0Layout
 {
     VkDescriptorSetLayout layout;
+    DescriptorTemplate    update_template;  // bindings 0-1, the optional maps are not part of it
     
     // Binding indices (for reference)
     // Binding 0: UBO for FreqGlobalData
@@ -158,6 +160,7 @@ typedef struct FreqSet0Layout
 typedef struct FreqSet1Layout
 {
     VkDescriptorSetLayout layout;
+    DescriptorTemplate    update_template;  // all bindings, one update per material flush
     
     // Binding indices:
     // Binding 0: UBO for FreqMaterialParams
@@ -172,6 +175,7 @@ typedef struct FreqSet1Layout
 typedef struct FreqSet2Layout
 {
     VkDescriptorSetLayout layout;
+    DescriptorTemplate    update_template;
     
     // Binding indices:
     // Binding 0: Dynamic UBO for FreqDrawData
@@ -0,0 +1,194 @@
+#include "vk_descriptor_template.h"
+
+typedef enum DescriptorSlotKind
+{
+    DESCRIPTOR_SLOT_IMAGE,
+    DESCRIPTOR_SLOT_BUFFER,
+    DESCRIPTOR_SLOT_TEXEL,
+    DESCRIPTOR_SLOT_HANDLE,
+    DESCRIPTOR_SLOT_INLINE,
+} DescriptorSlotKind;
+
+static DescriptorSlotKind slot_kind(VkDescriptorType type)
+{
+    switch(type)
+    {
+        case VK_DESCRIPTOR_TYPE_SAMPLER:
+        case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+        case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+        case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+        case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+            return DESCRIPTOR_SLOT_IMAGE;
+        case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+        case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+        case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+        case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
+            return DESCRIPTOR_SLOT_BUFFER;
+        case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+        case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+            return DESCRIPTOR_SLOT_TEXEL;
+        case VK_DESCRIPTOR_TYPE_INLINE_UNIFORM_BLOCK:
+            return DESCRIPTOR_SLOT_INLINE;
+        default:
+            // acceleration structures are written as bare handles
+            return DESCRIPTOR_SLOT_HANDLE;
+    }
+}
+
+static uint32_t slot_stride(DescriptorSlotKind kind)
+{
+    switch(kind)
+    {
+        case DESCRIPTOR_SLOT_IMAGE:  return sizeof(VkDescriptorImageInfo);
+        case DESCRIPTOR_SLOT_BUFFER: return sizeof(VkDescriptorBufferInfo);
+        case DESCRIPTOR_SLOT_TEXEL:  return sizeof(VkBufferView);
+        case DESCRIPTOR_SLOT_INLINE: return 1;
+        default:                     return sizeof(uint64_t);
+    }
+}
+
+static uint32_t align_up(uint32_t value, uint32_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+void descriptor_template_create(VkDevice                            device,
+                                VkDescriptorSetLayout               layout,
+                                const VkDescriptorSetLayoutBinding* bindings,
+                                uint32_t                            binding_count,
+                                DescriptorTemplate*                 out)
+{
+    assert(binding_count <= DESCRIPTOR_TEMPLATE_MAX_ENTRIES);
+
+    memset(out, 0, sizeof(*out));
+    out->layout = layout;
+
+    // insertion sort by binding, the lists are short
+    for(uint32_t i = 0; i < binding_count; i++)
+    {
+        if(bindings[i].descriptorCount == 0)
+            continue;
+
+        // sampler bindings with immutable samplers must not be written at all
+        if(bindings[i].descriptorType == VK_DESCRIPTOR_TYPE_SAMPLER && bindings[i].pImmutableSamplers)
+            continue;
+
+        DescriptorTemplateEntry e = {
+            .binding = bindings[i].binding,
+            .type    = bindings[i].descriptorType,
+            .count   = bindings[i].descriptorCount,
+            .stride  = slot_stride(slot_kind(bindings[i].descriptorType)),
+        };
+
+        uint32_t j = out->entry_count++;
+        while(j > 0 && out->entries[j - 1].binding > e.binding)
+        {
+            out->entries[j] = out->entries[j - 1];
+            j--;
+        }
+        out->entries[j] = e;
+    }
+
+    VkDescriptorUpdateTemplateEntry entries[DESCRIPTOR_TEMPLATE_MAX_ENTRIES];
+
+    uint32_t offset = 0;
+    for(uint32_t i = 0; i < out->entry_count; i++)
+    {
+        DescriptorTemplateEntry* e = &out->entries[i];
+
+        e->offset = align_up(offset, DESCRIPTOR_TEMPLATE_ALIGNMENT);
+        offset    = e->offset + e->count * e->stride;
+
+        entries[i] = (VkDescriptorUpdateTemplateEntry){
+            .dstBinding      = e->binding,
+            .dstArrayElement = 0,
+            .descriptorCount = e->count,
+            .descriptorType  = e->type,
+            .offset          = e->offset,
+            .stride          = e->stride,
+        };
+    }
+
+    out->data_size = align_up(offset, DESCRIPTOR_TEMPLATE_ALIGNMENT);
+
+    if(out->entry_count == 0)
+        return;
+
+    VkDescriptorUpdateTemplateCreateInfo info = {
+        .sType                      = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO,
+        .descriptorUpdateEntryCount = out->entry_count,
+        .pDescriptorUpdateEntries   = entries,
+        .templateType               = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET,
+        .descriptorSetLayout        = layout,
+    };
+
+    VK_CHECK(vkCreateDescriptorUpdateTemplate(device, &info, NULL, &out->handle));
+}
+
+void descriptor_template_destroy(VkDevice device, DescriptorTemplate* tmpl)
+{
+    if(tmpl->handle != VK_NULL_HANDLE)
+        vkDestroyDescriptorUpdateTemplate(device, tmpl->handle, NULL);
+
+    memset(tmpl, 0, sizeof(*tmpl));
+}
+
+const DescriptorTemplateEntry* descriptor_template_find(const DescriptorTemplate* tmpl, uint32_t binding)
+{
+    for(uint32_t i = 0; i < tmpl->entry_count; i++)
+    {
+        if(tmpl->entries[i].binding == binding)
+            return &tmpl->entries[i];
+    }
+    return NULL;
+}
+
+void* descriptor_template_slot(const DescriptorTemplate* tmpl, void* data, uint32_t binding, uint32_t element)
+{
+    const DescriptorTemplateEntry* e = descriptor_template_find(tmpl, binding);
+    if(!e || element >= e->count)
+    {
+        // a write past the block would corrupt whatever follows it
+        log_fatal("descriptor template has no binding %u element %u", binding, element);
+        abort();
+    }
+
+    return (uint8_t*)data + e->offset + element * e->stride;
+}
+
+void descriptor_template_write_buffer(const DescriptorTemplate*     tmpl,
+                                      void*                         data,
+                                      uint32_t                      binding,
+                                      uint32_t                      element,
+                                      const VkDescriptorBufferInfo* info)
+{
+    void* slot = descriptor_template_slot(tmpl, data, binding, element);
+    assert(slot_kind(descriptor_template_find(tmpl, binding)->type) == DESCRIPTOR_SLOT_BUFFER);
+    memcpy(slot, info, sizeof(*info));
+}
+
+void descriptor_template_write_image(const DescriptorTemplate*    tmpl,
+                                     void*                        data,
+                                     uint32_t                     binding,
+                                     uint32_t                     element,
+                                     const VkDescriptorImageInfo* info)
+{
+    void* slot = descriptor_template_slot(tmpl, data, binding, element);
+    assert(slot_kind(descriptor_template_find(tmpl, binding)->type) == DESCRIPTOR_SLOT_IMAGE);
+    memcpy(slot, info, sizeof(*info));
+}
+
+void descriptor_template_write_texel(const DescriptorTemplate* tmpl, void* data, uint32_t binding, uint32_t element, VkBufferView view)
+{
+    void* slot = descriptor_template_slot(tmpl, data, binding, element);
+    assert(slot_kind(descriptor_template_find(tmpl, binding)->type) == DESCRIPTOR_SLOT_TEXEL);
+    memcpy(slot, &view, sizeof(view));
+}
+
+void descriptor_template_update(VkDevice device, const DescriptorTemplate* tmpl, VkDescriptorSet set, const void* data)
+{
+    if(tmpl->handle == VK_NULL_HANDLE)
+        return;
+
+    vkUpdateDescriptorSetWithTemplate(device, set, tmpl->handle, data);
+}
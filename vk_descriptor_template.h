@@ -0,0 +1,74 @@
+#ifndef VK_DESCRIPTOR_TEMPLATE_H_
+#define VK_DESCRIPTOR_TEMPLATE_H_
+
+#include "vk_defaults.h"
+#include "vk_shader_reflect.h"
+
+/* ------------------ Descriptor update templates ------------------ */
+//
+// One VkDescriptorUpdateTemplate per set layout plus the CPU side layout
+// it reads from. Every binding gets a fixed slot in a packed block:
+// image infos and buffer infos take their Vulkan struct size, texel buffer
+// views and acceleration structures a single handle, inline uniform blocks
+// their raw bytes. Slots are ordered by binding and aligned to 8 bytes.
+//
+// Fill a block of data_size bytes with the write helpers, then update a
+// whole set with one descriptor_template_update call instead of building
+// a VkWriteDescriptorSet per binding.
+
+#define DESCRIPTOR_TEMPLATE_MAX_ENTRIES SHADER_REFLECT_MAX_BINDINGS
+#define DESCRIPTOR_TEMPLATE_ALIGNMENT 8u
+
+typedef struct DescriptorTemplateEntry
+{
+    uint32_t         binding;
+    VkDescriptorType type;
+    uint32_t         count;   // array elements, bytes for inline uniform blocks
+    uint32_t         offset;  // byte offset of element 0 in the packed block
+    uint32_t         stride;  // bytes between elements
+} DescriptorTemplateEntry;
+
+typedef struct DescriptorTemplate
+{
+    VkDescriptorUpdateTemplate handle;
+    VkDescriptorSetLayout      layout;
+    uint32_t                   data_size;  // bytes descriptor_template_update reads
+    uint32_t                   entry_count;
+    DescriptorTemplateEntry    entries[DESCRIPTOR_TEMPLATE_MAX_ENTRIES];  // sorted by binding
+} DescriptorTemplate;
+
+// bindings with descriptorCount 0 (unsized runtime arrays) are left out,
+// write those with vkUpdateDescriptorSets. So are SAMPLER bindings with
+// pImmutableSamplers, Vulkan forbids writing them.
+void descriptor_template_create(VkDevice                            device,
+                                VkDescriptorSetLayout               layout,
+                                const VkDescriptorSetLayoutBinding* bindings,
+                                uint32_t                            binding_count,
+                                DescriptorTemplate*                 out);
+
+void descriptor_template_destroy(VkDevice device, DescriptorTemplate* tmpl);
+
+// NULL when the template has no entry for binding
+const DescriptorTemplateEntry* descriptor_template_find(const DescriptorTemplate* tmpl, uint32_t binding);
+
+// address of one array element inside a packed block, aborts when the
+// template has no such binding or element
+void* descriptor_template_slot(const DescriptorTemplate* tmpl, void* data, uint32_t binding, uint32_t element);
+
+void descriptor_template_write_buffer(const DescriptorTemplate*     tmpl,
+                                      void*                         data,
+                                      uint32_t                      binding,
+                                      uint32_t                      element,
+                                      const VkDescriptorBufferInfo* info);
+
+void descriptor_template_write_image(const DescriptorTemplate*    tmpl,
+                                     void*                        data,
+                                     uint32_t                     binding,
+                                     uint32_t                     element,
+                                     const VkDescriptorImageInfo* info);
+
+void descriptor_template_write_texel(const DescriptorTemplate* tmpl, void* data, uint32_t binding, uint32_t element, VkBufferView view);
+
+void descriptor_template_update(VkDevice device, const DescriptorTemplate* tmpl, VkDescriptorSet set, const void* data);
+
+#endif // VK_DESCRIPTOR_TEMPLATE_H_
@@ -0,0 +1,153 @@
+#include "vk_dynamic_state.h"
+
+uint32_t pipeline_dynamic_state_supported(VkPhysicalDevice physical_device)
+{
+    VkPhysicalDeviceExtendedDynamicState3FeaturesEXT eds3_features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT,
+    };
+
+    VkPhysicalDeviceFeatures2 features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+        .pNext = &eds3_features,
+    };
+
+    vkGetPhysicalDeviceFeatures2(physical_device, &features);
+
+    uint32_t mask = PIPELINE_DYNAMIC_CORE;
+    if(eds3_features.extendedDynamicState3PolygonMode)
+        mask |= PIPELINE_DYNAMIC_POLYGON_MODE;
+
+    return mask;
+}
+
+uint32_t pipeline_dynamic_state_list(uint32_t mask, VkDynamicState* out)
+{
+    uint32_t count = 0;
+
+    if(mask & PIPELINE_DYNAMIC_CULL_MODE)
+        out[count++] = VK_DYNAMIC_STATE_CULL_MODE;
+    if(mask & PIPELINE_DYNAMIC_FRONT_FACE)
+        out[count++] = VK_DYNAMIC_STATE_FRONT_FACE;
+    if(mask & PIPELINE_DYNAMIC_PRIMITIVE_TOPOLOGY)
+        out[count++] = VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY;
+    if(mask & PIPELINE_DYNAMIC_DEPTH_TEST)
+        out[count++] = VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE;
+    if(mask & PIPELINE_DYNAMIC_DEPTH_WRITE)
+        out[count++] = VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE;
+    if(mask & PIPELINE_DYNAMIC_POLYGON_MODE)
+        out[count++] = VK_DYNAMIC_STATE_POLYGON_MODE_EXT;
+
+    return count;
+}
+
+VkPrimitiveTopology topology_class(VkPrimitiveTopology topology)
+{
+    switch(topology)
+    {
+        case VK_PRIMITIVE_TOPOLOGY_POINT_LIST:
+            return VK_PRIMITIVE_TOPOLOGY_POINT_LIST;
+        case VK_PRIMITIVE_TOPOLOGY_LINE_LIST:
+        case VK_PRIMITIVE_TOPOLOGY_LINE_STRIP:
+        case VK_PRIMITIVE_TOPOLOGY_LINE_LIST_WITH_ADJACENCY:
+        case VK_PRIMITIVE_TOPOLOGY_LINE_STRIP_WITH_ADJACENCY:
+            return VK_PRIMITIVE_TOPOLOGY_LINE_LIST;
+        case VK_PRIMITIVE_TOPOLOGY_PATCH_LIST:
+            return VK_PRIMITIVE_TOPOLOGY_PATCH_LIST;
+        default:
+            return VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    }
+}
+
+void dynamic_state_tracker_reset(DynamicStateTracker* t)
+{
+    memset(t, 0, sizeof(*t));
+}
+
+void dynamic_state_tracker_bind(DynamicStateTracker* t, uint32_t dynamic_state)
+{
+    // a state stays known only if neither pipeline set it statically
+    t->dynamic = dynamic_state & PIPELINE_DYNAMIC_ALL;
+    t->valid &= t->dynamic;
+}
+
+// true if the command needs recording, marks the state valid either way
+static bool needs_set(DynamicStateTracker* t, uint32_t bit, bool same)
+{
+    assert(t->dynamic & bit);
+
+    if((t->valid & bit) && same)
+    {
+        t->skipped++;
+        return false;
+    }
+
+    t->valid |= bit;
+    t->emitted++;
+    return true;
+}
+
+void dynamic_state_set_cull_mode(VkCommandBuffer cmd, DynamicStateTracker* t, VkCullModeFlags cull_mode)
+{
+    if(!needs_set(t, PIPELINE_DYNAMIC_CULL_MODE, t->cull_mode == cull_mode))
+        return;
+    t->cull_mode = cull_mode;
+    vkCmdSetCullMode(cmd, cull_mode);
+}
+
+void dynamic_state_set_front_face(VkCommandBuffer cmd, DynamicStateTracker* t, VkFrontFace front_face)
+{
+    if(!needs_set(t, PIPELINE_DYNAMIC_FRONT_FACE, t->front_face == front_face))
+        return;
+    t->front_face = front_face;
+    vkCmdSetFrontFace(cmd, front_face);
+}
+
+void dynamic_state_set_topology(VkCommandBuffer cmd, DynamicStateTracker* t, VkPrimitiveTopology topology)
+{
+    if(!needs_set(t, PIPELINE_DYNAMIC_PRIMITIVE_TOPOLOGY, t->topology == topology))
+        return;
+    t->topology = topology;
+    vkCmdSetPrimitiveTopology(cmd, topology);
+}
+
+void dynamic_state_set_depth_test(VkCommandBuffer cmd, DynamicStateTracker* t, VkBool32 enable)
+{
+    if(!needs_set(t, PIPELINE_DYNAMIC_DEPTH_TEST, t->depth_test_enable == enable))
+        return;
+    t->depth_test_enable = enable;
+    vkCmdSetDepthTestEnable(cmd, enable);
+}
+
+void dynamic_state_set_depth_write(VkCommandBuffer cmd, DynamicStateTracker* t, VkBool32 enable)
+{
+    if(!needs_set(t, PIPELINE_DYNAMIC_DEPTH_WRITE, t->depth_write_enable == enable))
+        return;
+    t->depth_write_enable = enable;
+    vkCmdSetDepthWriteEnable(cmd, enable);
+}
+
+void dynamic_state_set_polygon_mode(VkCommandBuffer cmd, DynamicStateTracker* t, VkPolygonMode polygon_mode)
+{
+    if(!needs_set(t, PIPELINE_DYNAMIC_POLYGON_MODE, t->polygon_mode == polygon_mode))
+        return;
+    t->polygon_mode = polygon_mode;
+    vkCmdSetPolygonModeEXT(cmd, polygon_mode);
+}
+
+void dynamic_state_tracker_apply(VkCommandBuffer cmd, DynamicStateTracker* t, const GraphicsPipelineConfig* cfg)
+{
+    uint32_t dyn = t->dynamic;
+
+    if(dyn & PIPELINE_DYNAMIC_CULL_MODE)
+        dynamic_state_set_cull_mode(cmd, t, cfg->cull_mode);
+    if(dyn & PIPELINE_DYNAMIC_FRONT_FACE)
+        dynamic_state_set_front_face(cmd, t, cfg->front_face);
+    if(dyn & PIPELINE_DYNAMIC_PRIMITIVE_TOPOLOGY)
+        dynamic_state_set_topology(cmd, t, cfg->topology);
+    if(dyn & PIPELINE_DYNAMIC_DEPTH_TEST)
+        dynamic_state_set_depth_test(cmd, t, cfg->depth_test_enable);
+    if(dyn & PIPELINE_DYNAMIC_DEPTH_WRITE)
+        dynamic_state_set_depth_write(cmd, t, cfg->depth_write_enable);
+    if(dyn & PIPELINE_DYNAMIC_POLYGON_MODE)
+        dynamic_state_set_polygon_mode(cmd, t, cfg->polygon_mode);
+}
@@ -0,0 +1,75 @@
+#ifndef VK_DYNAMIC_STATE_H_
+#define VK_DYNAMIC_STATE_H_
+
+#include "vk_defaults.h"
+#include "vk_pipelines.h"
+
+/* ------------------ Extended dynamic state ------------------ */
+//
+// Cull mode, front face, topology, depth test/write and polygon mode are
+// the usual reasons one material turns into many pipelines. A config with
+// those bits in dynamic_state builds a pipeline where they are dynamic,
+// and the pipeline caches key only on what is left static. Every
+// permutation then shares a single VkPipeline.
+//
+//   cfg.dynamic_state = pipeline_dynamic_state_supported(physical_device);
+//   VkPipeline p = create_graphics_pipeline(..., &cfg, &layout);
+//   ...recording...
+//   dynamic_state_tracker_reset(&tracker);
+//   vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, p);
+//   dynamic_state_tracker_bind(&tracker, cfg.dynamic_state);
+//   dynamic_state_tracker_apply(cmd, &tracker, &draw_cfg);  // only what changed is recorded
+//
+// The tracker keeps the values last recorded into one command buffer and
+// skips vkCmdSet* calls that would not change anything. Binding a pipeline
+// where a state is static overwrites it, so bind forgets those states.
+//
+// A dynamic topology may only change within the class (point, line,
+// triangle, patch) of cfg.topology unless dynamicPrimitiveTopologyUnrestricted
+// is supported. Polygon mode needs VK_EXT_extended_dynamic_state3 with
+// extendedDynamicState3PolygonMode enabled on the device.
+
+#define PIPELINE_DYNAMIC_STATE_MAX 6
+
+typedef struct DynamicStateTracker
+{
+    uint32_t dynamic;  // PipelineDynamicStateBits of the bound pipeline
+    uint32_t valid;    // states whose value below is what the command buffer holds
+
+    VkCullModeFlags     cull_mode;
+    VkFrontFace         front_face;
+    VkPrimitiveTopology topology;
+    VkBool32            depth_test_enable;
+    VkBool32            depth_write_enable;
+    VkPolygonMode       polygon_mode;
+
+    uint32_t emitted;  // vkCmdSet* calls recorded
+    uint32_t skipped;  // redundant calls filtered out
+} DynamicStateTracker;
+
+// PipelineDynamicStateBits the device can use, core states assume Vulkan 1.3
+uint32_t pipeline_dynamic_state_supported(VkPhysicalDevice physical_device);
+
+// VkDynamicState values for mask, returns the count (at most PIPELINE_DYNAMIC_STATE_MAX)
+uint32_t pipeline_dynamic_state_list(uint32_t mask, VkDynamicState* out);
+
+// first topology of the class topology belongs to, used as its cache key
+VkPrimitiveTopology topology_class(VkPrimitiveTopology topology);
+
+// call at the start of every command buffer
+void dynamic_state_tracker_reset(DynamicStateTracker* t);
+
+// call after vkCmdBindPipeline with the dynamic_state the pipeline was built with
+void dynamic_state_tracker_bind(DynamicStateTracker* t, uint32_t dynamic_state);
+
+// records the dynamic fields of cfg that differ from the command buffer
+void dynamic_state_tracker_apply(VkCommandBuffer cmd, DynamicStateTracker* t, const GraphicsPipelineConfig* cfg);
+
+void dynamic_state_set_cull_mode(VkCommandBuffer cmd, DynamicStateTracker* t, VkCullModeFlags cull_mode);
+void dynamic_state_set_front_face(VkCommandBuffer cmd, DynamicStateTracker* t, VkFrontFace front_face);
+void dynamic_state_set_topology(VkCommandBuffer cmd, DynamicStateTracker* t, VkPrimitiveTopology topology);
+void dynamic_state_set_depth_test(VkCommandBuffer cmd, DynamicStateTracker* t, VkBool32 enable);
+void dynamic_state_set_depth_write(VkCommandBuffer cmd, DynamicStateTracker* t, VkBool32 enable);
+void dynamic_state_set_polygon_mode(VkCommandBuffer cmd, DynamicStateTracker* t, VkPolygonMode polygon_mode);
+
+#endif // VK_DYNAMIC_STATE_H_
@@ -0,0 +1,95 @@
+// mmap and friends are POSIX, hidden under strict -std=c99
+#define _POSIX_C_SOURCE 200112L
+
+#include "vk_file.h"
+#include "vk_thread.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool mapped_file_open(MappedFile* file, const char* path, bool quiet)
+{
+    memset(file, 0, sizeof(*file));
+
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+    {
+        if(!quiet || errno != ENOENT)
+            log_error("Failed to open '%s' (errno=%d)", path, errno);
+        return false;
+    }
+
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size <= 0)
+    {
+        log_error("Invalid size for '%s'", path);
+        close(fd);
+        return false;
+    }
+
+    size_t size = (size_t)st.st_size;
+    void*  data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);  // the mapping keeps the file alive
+
+    if(data == MAP_FAILED)
+    {
+        log_error("Failed to map '%s' (errno=%d)", path, errno);
+        return false;
+    }
+
+    file->data = data;
+    file->size = size;
+    return true;
+}
+
+void mapped_file_close(MappedFile* file)
+{
+    if(file->data)
+        munmap((void*)file->data, file->size);
+
+    memset(file, 0, sizeof(*file));
+}
+
+// distinguishes concurrent writers inside one process, the pid the ones across processes
+static uint32_t tmp_counter;
+
+bool write_file_atomic(const char* path, const void* const* parts, const size_t* part_sizes, uint32_t part_count)
+{
+    // a fixed path.tmp would let two savers truncate each other's half written file
+    size_t len      = strlen(path) + 32;
+    char*  tmp_path = malloc(len);
+    snprintf(tmp_path, len, "%s.%ld.%u.tmp", path, (long)getpid(), ATOMIC_FETCH_ADD(&tmp_counter, 1u));
+
+    int   fd = open(tmp_path, O_WRONLY | O_CREAT | O_EXCL, 0666);
+    FILE* f  = fd >= 0 ? fdopen(fd, "wb") : NULL;
+    if(!f)
+    {
+        log_error("Failed to open '%s' (errno=%d)", tmp_path, errno);
+        if(fd >= 0)
+        {
+            close(fd);
+            remove(tmp_path);
+        }
+        free(tmp_path);
+        return false;
+    }
+
+    bool ok = true;
+    for(uint32_t i = 0; i < part_count && ok; i++)
+        ok = part_sizes[i] == 0 || fwrite(parts[i], part_sizes[i], 1, f) == 1;
+
+    ok = fclose(f) == 0 && ok;
+    ok = ok && rename(tmp_path, path) == 0;
+
+    if(!ok)
+    {
+        log_error("Failed to write '%s' (errno=%d)", path, errno);
+        remove(tmp_path);
+    }
+
+    free(tmp_path);
+    return ok;
+}
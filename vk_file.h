@@ -0,0 +1,24 @@
+#ifndef VK_FILE_H_
+#define VK_FILE_H_
+
+#include "vk_defaults.h"
+
+/* ------------------ Read-only file mappings ------------------ */
+// Binary caches and archives are mapped once and read in place.
+
+typedef struct MappedFile
+{
+    const uint8_t* data;
+    size_t         size;
+} MappedFile;
+
+// false if path is missing, empty or cannot be mapped; quiet maps a missing file without logging
+bool mapped_file_open(MappedFile* file, const char* path, bool quiet);
+void mapped_file_close(MappedFile* file);
+
+// Writes data to a temporary file next to path and renames it over path, so
+// readers never see a partial file. The temporary name is unique per process
+// and call, so concurrent savers never share one; the last rename wins.
+bool write_file_atomic(const char* path, const void* const* parts, const size_t* part_sizes, uint32_t part_count);
+
+#endif // VK_FILE_H_
@@ -0,0 +1,97 @@
+#include "vk_hashmap.h"
+#include "vk_thread.h"
+
+static HashIndexTable* alloc_table(uint32_t min_capacity)
+{
+    uint32_t capacity = HASH_INDEX_MIN_CAPACITY;
+    while(capacity < min_capacity)
+        capacity <<= 1;
+
+    HashIndexTable* t = calloc(1, sizeof(HashIndexTable) + capacity * sizeof(HashIndexSlot));
+    t->capacity       = capacity;
+    return t;
+}
+
+void hash_index_init(HashIndex* index, uint32_t initial_capacity)
+{
+    index->table   = initial_capacity ? alloc_table(initial_capacity) : NULL;
+    index->retired = NULL;
+    index->count   = 0;
+}
+
+void hash_index_destroy(HashIndex* index)
+{
+    for(int i = 0; i < arrlen(index->retired); i++)
+        free(index->retired[i]);
+
+    arrfree(index->retired);
+    free(index->table);
+
+    index->table = NULL;
+    index->count = 0;
+}
+
+// hash is written before the value is released, so a reader that sees the
+// value also sees the matching hash
+static void place_slot(HashIndexTable* t, Hash64 hash, void* value)
+{
+    uint32_t mask = t->capacity - 1;
+    uint32_t i    = (uint32_t)hash & mask;
+
+    while(t->slots[i].value)
+        i = (i + 1) & mask;
+
+    t->slots[i].hash = hash;
+    ATOMIC_STORE_RELEASE(&t->slots[i].value, value);
+}
+
+static void grow(HashIndex* index)
+{
+    HashIndexTable* old = index->table;
+    HashIndexTable* t   = alloc_table(old ? old->capacity * 2 : HASH_INDEX_MIN_CAPACITY);
+
+    if(old)
+    {
+        for(uint32_t i = 0; i < old->capacity; i++)
+        {
+            if(old->slots[i].value)
+                place_slot(t, old->slots[i].hash, old->slots[i].value);
+        }
+
+        arrpush(index->retired, old);
+    }
+
+    ATOMIC_STORE_RELEASE(&index->table, t);
+}
+
+void* hash_index_find(const HashIndex* index, Hash64 hash, HashIndexEqualFn equal, const void* key)
+{
+    HashIndexTable* t = ATOMIC_LOAD_ACQUIRE(&index->table);
+    if(!t)
+        return NULL;
+
+    uint32_t mask = t->capacity - 1;
+    uint32_t i    = (uint32_t)hash & mask;
+
+    // load factor < 1 guarantees an empty slot terminates the probe
+    for(;;)
+    {
+        void* value = ATOMIC_LOAD_ACQUIRE(&t->slots[i].value);
+        if(!value)
+            return NULL;
+
+        if(t->slots[i].hash == hash && equal(value, key))
+            return value;
+
+        i = (i + 1) & mask;
+    }
+}
+
+void hash_index_insert(HashIndex* index, Hash64 hash, void* value)
+{
+    if(!index->table || (float)(index->count + 1) > (float)index->table->capacity * HASH_INDEX_MAX_LOAD)
+        grow(index);
+
+    place_slot(index->table, hash, value);
+    index->count++;
+}
@@ -0,0 +1,54 @@
+#ifndef VK_HASHMAP_H_
+#define VK_HASHMAP_H_
+
+#include "vk_defaults.h"
+
+/* ------------------ Open addressing hash index ------------------ */
+//
+// Maps a precomputed 64 bit hash to a caller owned value pointer.
+// Values must stay at a stable address for as long as they are indexed,
+// the index never copies or frees them. Linear probing, power of two
+// capacity, grows once the load factor passes HASH_INDEX_MAX_LOAD.
+// There is no removal, caches built on this only grow until destroyed.
+//
+// hash_index_find may run on any number of threads concurrently with a
+// single inserter: slots are published with release stores and growth
+// swaps in a fully built table. Replaced tables are kept alive until
+// hash_index_destroy so in-flight readers never touch freed memory.
+// Inserts must be serialized by the caller.
+
+#define HASH_INDEX_MIN_CAPACITY 16u
+#define HASH_INDEX_MAX_LOAD 0.7f
+
+typedef struct HashIndexSlot
+{
+    Hash64 hash;
+    void*  value;  // NULL marks an empty slot
+} HashIndexSlot;
+
+typedef struct HashIndexTable
+{
+    uint32_t      capacity;  // always a power of two
+    HashIndexSlot slots[];
+} HashIndexTable;
+
+typedef struct HashIndex
+{
+    HashIndexTable*  table;    // current table, read with acquire
+    HashIndexTable** retired;  // stretchy buffer of tables replaced by growth
+    uint32_t         count;
+} HashIndex;
+
+// returns true when the stored value matches the lookup key
+typedef bool (*HashIndexEqualFn)(const void* value, const void* key);
+
+void hash_index_init(HashIndex* index, uint32_t initial_capacity);
+void hash_index_destroy(HashIndex* index);
+
+// NULL when no value with this hash compares equal to key
+void* hash_index_find(const HashIndex* index, Hash64 hash, HashIndexEqualFn equal, const void* key);
+
+// caller guarantees the key is not already present (find first)
+void hash_index_insert(HashIndex* index, Hash64 hash, void* value);
+
+#endif // VK_HASHMAP_H_
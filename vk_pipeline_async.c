@@ -0,0 +1,290 @@
+#include "vk_pipeline_async.h"
+
+static char* copy_string(const char* s)
+{
+    size_t len  = strlen(s) + 1;
+    char*  copy = malloc(len);
+    memcpy(copy, s, len);
+    return copy;
+}
+
+// deep copy into p, NULL when there is nothing to specialize
+static const PipelineSpecialization* copy_specialization(AsyncPipeline* p, const PipelineSpecialization* spec)
+{
+    if(!spec || spec->count == 0)
+        return NULL;
+
+    assert(spec->count <= PIPELINE_SPEC_MAX_CONSTANTS);
+
+    for(uint32_t i = 0; i < spec->count; i++)
+    {
+        p->spec_constants[i]      = spec->constants[i];
+        p->spec_constants[i].name = spec->constants[i].name ? copy_string(spec->constants[i].name) : NULL;
+    }
+
+    p->specialization = (PipelineSpecialization){.constants = p->spec_constants, .count = spec->count};
+    return &p->specialization;
+}
+
+static void free_handle(PipelineCompiler* compiler, AsyncPipeline* p)
+{
+    if(!compiler->obj_cache && p->pipeline != VK_NULL_HANDLE)
+        vkDestroyPipeline(compiler->device, p->pipeline, NULL);
+
+    for(uint32_t j = 0; j < p->specialization.count; j++)
+        free((char*)p->spec_constants[j].name);
+
+    free(p->paths[0]);
+    free(p->paths[1]);
+    free(p);
+}
+
+static void finish(PipelineCompiler* compiler, AsyncPipeline* p, PipelineAsyncStatus status)
+{
+    mutex_lock(&compiler->lock);
+
+    // released while compiling, nobody is left to see the result
+    bool released = p->released;
+    if(!released)
+    {
+        ATOMIC_STORE_RELEASE(&p->status, (uint32_t)status);
+        condvar_broadcast(&compiler->done);
+    }
+
+    mutex_unlock(&compiler->lock);
+
+    if(released)
+        free_handle(compiler, p);
+}
+
+static void compile(PipelineCompiler* compiler, AsyncPipeline* p)
+{
+    uint64_t start = time_now_ns();
+
+    if(p->kind == PIPELINE_OBJECT_COMPUTE)
+    {
+        p->pipeline = create_compute_pipeline(compiler->device, compiler->cache, compiler->desc_cache, compiler->pipe_cache,
+                                              compiler->obj_cache, p->paths[0], p->specialization.count ? &p->specialization : NULL,
+                                              &p->layout);
+    }
+    else
+    {
+        p->pipeline = create_graphics_pipeline(compiler->device, compiler->cache, compiler->desc_cache, compiler->pipe_cache,
+                                               compiler->obj_cache, p->paths[0], p->paths[1], &p->config, &p->layout);
+    }
+
+    p->compile_ns = time_now_ns() - start;
+
+    finish(compiler, p, p->pipeline != VK_NULL_HANDLE ? PIPELINE_ASYNC_READY : PIPELINE_ASYNC_FAILED);
+}
+
+static void* compiler_thread_main(void* arg)
+{
+    PipelineCompiler* compiler = arg;
+
+    for(;;)
+    {
+        mutex_lock(&compiler->lock);
+
+        while(!compiler->shutdown && compiler->queue_head == arrlen(compiler->queue))
+            condvar_wait(&compiler->work, &compiler->lock);
+
+        if(compiler->shutdown)
+        {
+            mutex_unlock(&compiler->lock);
+            break;
+        }
+
+        AsyncPipeline* p = compiler->queue[compiler->queue_head++];
+
+        // drained, start over at the front instead of growing forever
+        if(compiler->queue_head == arrlen(compiler->queue))
+        {
+            arrsetlen(compiler->queue, 0);
+            compiler->queue_head = 0;
+        }
+
+        mutex_unlock(&compiler->lock);
+
+        compile(compiler, p);
+    }
+
+    return NULL;
+}
+
+void pipeline_compiler_init(PipelineCompiler*      compiler,
+                            VkDevice               device,
+                            VkPipelineCache        cache,
+                            DescriptorLayoutCache* desc_cache,
+                            PipelineLayoutCache*   pipe_cache,
+                            PipelineObjectCache*   obj_cache,
+                            uint32_t               thread_count)
+{
+    memset(compiler, 0, sizeof(*compiler));
+    compiler->device     = device;
+    compiler->cache      = cache;
+    compiler->desc_cache = desc_cache;
+    compiler->pipe_cache = pipe_cache;
+    compiler->obj_cache  = obj_cache;
+
+    mutex_init(&compiler->lock);
+    condvar_init(&compiler->work);
+    condvar_init(&compiler->done);
+
+    thread_count = CLAMP(thread_count, 1u, (uint32_t)PIPELINE_COMPILER_MAX_THREADS);
+
+    for(uint32_t i = 0; i < thread_count; i++)
+    {
+        if(!thread_create(&compiler->threads[i], compiler_thread_main, compiler))
+        {
+            log_error("pipeline compiler: failed to start thread %u", i);
+            break;
+        }
+        compiler->thread_count++;
+    }
+
+    assert(compiler->thread_count > 0);
+}
+
+void pipeline_compiler_destroy(PipelineCompiler* compiler)
+{
+    mutex_lock(&compiler->lock);
+    compiler->shutdown = true;
+    condvar_broadcast(&compiler->work);
+    mutex_unlock(&compiler->lock);
+
+    for(uint32_t i = 0; i < compiler->thread_count; i++)
+        thread_join(&compiler->threads[i]);
+
+    // wake async_pipeline_wait callers still blocked on cancelled requests
+    mutex_lock(&compiler->lock);
+    for(int i = (int)compiler->queue_head; i < arrlen(compiler->queue); i++)
+        ATOMIC_STORE_RELEASE(&compiler->queue[i]->status, (uint32_t)PIPELINE_ASYNC_CANCELLED);
+    condvar_broadcast(&compiler->done);
+    mutex_unlock(&compiler->lock);
+
+    for(int i = 0; i < arrlen(compiler->handles); i++)
+        free_handle(compiler, compiler->handles[i]);
+
+    arrfree(compiler->handles);
+    arrfree(compiler->queue);
+
+    condvar_destroy(&compiler->done);
+    condvar_destroy(&compiler->work);
+    mutex_destroy(&compiler->lock);
+}
+
+static AsyncPipeline* submit(PipelineCompiler* compiler, AsyncPipeline* p)
+{
+    mutex_lock(&compiler->lock);
+    arrpush(compiler->handles, p);
+    arrpush(compiler->queue, p);
+    condvar_signal(&compiler->work);
+    mutex_unlock(&compiler->lock);
+
+    return p;
+}
+
+AsyncPipeline* create_graphics_pipeline_async(PipelineCompiler*             compiler,
+                                              const char*                   vert_path,
+                                              const char*                   frag_path,
+                                              const GraphicsPipelineConfig* config,
+                                              VkPipeline                    fallback,
+                                              VkPipelineLayout              fallback_layout)
+{
+    assert(config->color_attachment_count <= PIPELINE_OBJECT_MAX_COLOR_FORMATS);
+
+    AsyncPipeline* p   = calloc(1, sizeof(AsyncPipeline));
+    p->status          = PIPELINE_ASYNC_PENDING;
+    p->kind            = PIPELINE_OBJECT_GRAPHICS;
+    p->paths[0]        = copy_string(vert_path);
+    p->paths[1]        = copy_string(frag_path);
+    p->fallback        = fallback;
+    p->fallback_layout = fallback_layout;
+
+    p->config = *config;
+    if(config->color_attachment_count)
+        memcpy(p->color_formats, config->color_formats, config->color_attachment_count * sizeof(VkFormat));
+    p->config.color_formats  = p->color_formats;
+    p->config.specialization = copy_specialization(p, config->specialization);
+
+    return submit(compiler, p);
+}
+
+AsyncPipeline* create_compute_pipeline_async(PipelineCompiler*             compiler,
+                                             const char*                   comp_path,
+                                             const PipelineSpecialization* specialization,
+                                             VkPipeline                    fallback,
+                                             VkPipelineLayout              fallback_layout)
+{
+    AsyncPipeline* p   = calloc(1, sizeof(AsyncPipeline));
+    p->status          = PIPELINE_ASYNC_PENDING;
+    p->kind            = PIPELINE_OBJECT_COMPUTE;
+    p->paths[0]        = copy_string(comp_path);
+    p->fallback        = fallback;
+    p->fallback_layout = fallback_layout;
+
+    copy_specialization(p, specialization);
+
+    return submit(compiler, p);
+}
+
+void async_pipeline_release(PipelineCompiler* compiler, AsyncPipeline* p)
+{
+    mutex_lock(&compiler->lock);
+
+    for(int i = 0; i < arrlen(compiler->handles); i++)
+    {
+        if(compiler->handles[i] == p)
+        {
+            arrdelswap(compiler->handles, i);
+            break;
+        }
+    }
+
+    // not started yet, a worker will never see it
+    bool queued = false;
+    for(int i = (int)compiler->queue_head; i < arrlen(compiler->queue); i++)
+    {
+        if(compiler->queue[i] == p)
+        {
+            arrdel(compiler->queue, i);
+            queued = true;
+            break;
+        }
+    }
+
+    // a worker is compiling it and frees it in finish
+    bool running = !queued && async_pipeline_status(p) == PIPELINE_ASYNC_PENDING;
+    p->released  = true;
+
+    mutex_unlock(&compiler->lock);
+
+    if(!running)
+        free_handle(compiler, p);
+}
+
+PipelineAsyncStatus async_pipeline_status(const AsyncPipeline* p)
+{
+    return (PipelineAsyncStatus)ATOMIC_LOAD_ACQUIRE(&p->status);
+}
+
+VkPipeline async_pipeline_get(const AsyncPipeline* p, VkPipelineLayout* out_layout)
+{
+    bool ready = async_pipeline_status(p) == PIPELINE_ASYNC_READY;
+
+    if(out_layout)
+        *out_layout = ready ? p->layout : p->fallback_layout;
+
+    return ready ? p->pipeline : p->fallback;
+}
+
+PipelineAsyncStatus async_pipeline_wait(PipelineCompiler* compiler, const AsyncPipeline* p)
+{
+    mutex_lock(&compiler->lock);
+    while(async_pipeline_status(p) == PIPELINE_ASYNC_PENDING)
+        condvar_wait(&compiler->done, &compiler->lock);
+    mutex_unlock(&compiler->lock);
+
+    return async_pipeline_status(p);
+}
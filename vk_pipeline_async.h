@@ -0,0 +1,119 @@
+#ifndef VK_PIPELINE_ASYNC_H_
+#define VK_PIPELINE_ASYNC_H_
+
+#include "vk_defaults.h"
+#include "vk_pipelines.h"
+
+/* ------------------ Asynchronous pipeline creation ------------------ */
+//
+// Moves pipeline compilation off the render thread. A request returns an
+// AsyncPipeline right away and a background thread builds it. The render
+// thread polls it every frame and binds the fallback pipeline until the
+// real one is ready.
+//
+//   AsyncPipeline* p = create_graphics_pipeline_async(&compiler, "a.vert.spv", "a.frag.spv", &cfg, fallback, fallback_layout);
+//   ...every frame...
+//   VkPipelineLayout layout;
+//   VkPipeline       pipe = async_pipeline_get(p, &layout);  // fallback until ready
+//
+// Handles are owned by the compiler and stay valid until
+// async_pipeline_release or pipeline_compiler_destroy. Created pipelines
+// belong to obj_cache when one is given, otherwise to the compiler, which
+// destroys them together with their handle.
+
+#define PIPELINE_COMPILER_MAX_THREADS 8
+
+typedef enum PipelineAsyncStatus
+{
+    PIPELINE_ASYNC_PENDING,
+    PIPELINE_ASYNC_READY,
+    PIPELINE_ASYNC_FAILED,     // shaders could not be loaded
+    PIPELINE_ASYNC_CANCELLED,  // compiler destroyed before the job ran
+} PipelineAsyncStatus;
+
+typedef struct AsyncPipeline
+{
+    uint32_t status;  // PipelineAsyncStatus, published with release once the result is written
+
+    PipelineObjectKind     kind;
+    char*                  paths[2];  // vert and frag, or comp and NULL
+    GraphicsPipelineConfig config;
+    VkFormat               color_formats[PIPELINE_OBJECT_MAX_COLOR_FORMATS];  // config.color_formats points here
+    PipelineSpecialization specialization;                                    // config.specialization points here for graphics
+    PipelineSpecConstant   spec_constants[PIPELINE_SPEC_MAX_CONSTANTS];      // names are copies
+
+    VkPipeline       fallback;
+    VkPipelineLayout fallback_layout;
+
+    // valid once status is READY
+    VkPipeline       pipeline;
+    VkPipelineLayout layout;
+    uint64_t         compile_ns;
+
+    bool released;  // guarded by the compiler lock, freed by the worker that finishes it
+} AsyncPipeline;
+
+typedef struct PipelineCompiler
+{
+    VkDevice               device;
+    VkPipelineCache        cache;
+    DescriptorLayoutCache* desc_cache;
+    PipelineLayoutCache*   pipe_cache;
+    PipelineObjectCache*   obj_cache;
+
+    AsyncPipeline** handles;  // stretchy buffer, every request ever made
+    AsyncPipeline** queue;    // stretchy buffer, pending requests from queue_head on
+    uint32_t        queue_head;
+    bool            shutdown;
+
+    Mutex   lock;  // guards handles, queue and shutdown
+    CondVar work;  // queue gained a request or shutdown
+    CondVar done;  // a request finished
+
+    Thread   threads[PIPELINE_COMPILER_MAX_THREADS];
+    uint32_t thread_count;
+} PipelineCompiler;
+
+// thread_count 0 picks one thread, background compiles should not starve the frame
+void pipeline_compiler_init(PipelineCompiler*      compiler,
+                            VkDevice               device,
+                            VkPipelineCache        cache,
+                            DescriptorLayoutCache* desc_cache,
+                            PipelineLayoutCache*   pipe_cache,
+                            PipelineObjectCache*   obj_cache,
+                            uint32_t               thread_count);
+
+// cancels requests that have not started, waits for running ones.
+// Threads blocked in async_pipeline_wait are woken, but they must have
+// returned before the handles and the lock are freed, so join them first.
+void pipeline_compiler_destroy(PipelineCompiler* compiler);
+
+// config, its specialization and the paths are copied, the caller may free them right away
+AsyncPipeline* create_graphics_pipeline_async(PipelineCompiler*             compiler,
+                                              const char*                   vert_path,
+                                              const char*                   frag_path,
+                                              const GraphicsPipelineConfig* config,
+                                              VkPipeline                    fallback,
+                                              VkPipelineLayout              fallback_layout);
+
+AsyncPipeline* create_compute_pipeline_async(PipelineCompiler*             compiler,
+                                             const char*                   comp_path,
+                                             const PipelineSpecialization* specialization,
+                                             VkPipeline                    fallback,
+                                             VkPipelineLayout              fallback_layout);
+
+// lock-free, meant to be called every frame
+PipelineAsyncStatus async_pipeline_status(const AsyncPipeline* p);
+
+// the real pipeline once ready, the fallback before that (or if it failed)
+VkPipeline async_pipeline_get(const AsyncPipeline* p, VkPipelineLayout* out_layout);
+
+// Frees p, and its pipeline if the compiler owns it. A queued request is
+// dropped, a running one is freed by its worker when done. p must not be
+// used afterwards, nor be waited on by another thread.
+void async_pipeline_release(PipelineCompiler* compiler, AsyncPipeline* p);
+
+// blocks until the request leaves PENDING, for loading screens
+PipelineAsyncStatus async_pipeline_wait(PipelineCompiler* compiler, const AsyncPipeline* p);
+
+#endif // VK_PIPELINE_ASYNC_H_
@@ -0,0 +1,203 @@
+#include "vk_pipeline_batch.h"
+#include "vk_pipeline_cache.h"
+
+// shared by every worker of one pipeline_batch_compile call
+typedef struct PipelineBatchJob
+{
+    VkDevice                 device;
+    DescriptorLayoutCache*   desc_cache;
+    PipelineLayoutCache*     pipe_cache;
+    PipelineObjectCache*     obj_cache;
+    const PipelineBatchDesc* descs;
+    PipelineBatchResult*     results;
+    uint32_t                 count;
+    uint32_t                 next;  // next desc to claim, bumped atomically
+} PipelineBatchJob;
+
+typedef struct PipelineBatchWorker
+{
+    PipelineBatchJob* job;
+    uint32_t          index;
+    VkPipelineCache   cache;  // private to this worker until the merge
+    Thread            thread;
+} PipelineBatchWorker;
+
+static void compile_one(PipelineBatchJob* job, const PipelineBatchWorker* w, uint32_t i)
+{
+    const PipelineBatchDesc* d = &job->descs[i];
+    PipelineBatchResult*     r = &job->results[i];
+
+    uint64_t start = time_now_ns();
+
+    if(d->kind == PIPELINE_OBJECT_COMPUTE && d->archive)
+    {
+        r->pipeline = create_compute_pipeline_from_archive(job->device, w->cache, job->desc_cache, job->pipe_cache, job->obj_cache,
+                                                           d->archive, d->comp_path, d->specialization, &r->layout);
+    }
+    else if(d->kind == PIPELINE_OBJECT_COMPUTE)
+    {
+        r->pipeline = create_compute_pipeline(job->device, w->cache, job->desc_cache, job->pipe_cache, job->obj_cache, d->comp_path,
+                                              d->specialization, &r->layout);
+    }
+    else if(d->archive)
+    {
+        r->pipeline = create_graphics_pipeline_from_archive(job->device, w->cache, job->desc_cache, job->pipe_cache, job->obj_cache,
+                                                            d->archive, d->vert_path, d->frag_path, d->config, &r->layout);
+    }
+    else
+    {
+        r->pipeline = create_graphics_pipeline(job->device, w->cache, job->desc_cache, job->pipe_cache, job->obj_cache, d->vert_path,
+                                               d->frag_path, d->config, &r->layout);
+    }
+
+    r->compile_ns = time_now_ns() - start;
+    r->worker     = w->index;
+}
+
+static void* batch_worker_main(void* arg)
+{
+    PipelineBatchWorker* w   = arg;
+    PipelineBatchJob*    job = w->job;
+
+    for(;;)
+    {
+        uint32_t i = ATOMIC_FETCH_ADD(&job->next, 1);
+        if(i >= job->count)
+            break;
+
+        compile_one(job, w, i);
+    }
+
+    return NULL;
+}
+
+// worker caches start from what the destination already has, so warm loads stay warm
+static VkPipelineCache create_worker_cache(VkDevice device, const void* seed, size_t seed_size)
+{
+    VkPipelineCacheCreateInfo info = {
+        .sType           = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+        .initialDataSize = seed_size,
+        .pInitialData    = seed,
+    };
+
+    VkPipelineCache cache = VK_NULL_HANDLE;
+    VK_CHECK(vkCreatePipelineCache(device, &info, NULL, &cache));
+    return cache;
+}
+
+static void* read_cache_data(VkDevice device, VkPipelineCache cache, size_t* out_size)
+{
+    *out_size = 0;
+
+    size_t size = 0;
+    if(vkGetPipelineCacheData(device, cache, &size, NULL) != VK_SUCCESS || size == 0)
+        return NULL;
+
+    void* data = malloc(size);
+    if(vkGetPipelineCacheData(device, cache, &size, data) != VK_SUCCESS)
+    {
+        free(data);
+        return NULL;
+    }
+
+    *out_size = size;
+    return data;
+}
+
+uint32_t pipeline_batch_compile(VkDevice                 device,
+                                VkPipelineCache          cache,
+                                PipelineCacheSaver*      saver,
+                                DescriptorLayoutCache*   desc_cache,
+                                PipelineLayoutCache*     pipe_cache,
+                                PipelineObjectCache*     obj_cache,
+                                const PipelineBatchDesc* descs,
+                                uint32_t                 count,
+                                uint32_t                 worker_count,
+                                PipelineBatchResult*     results,
+                                PipelineBatchStats*      out_stats)
+{
+    assert(!saver || saver->cache == cache);
+
+    uint64_t batch_start = time_now_ns();
+
+    if(worker_count == 0)
+        worker_count = thread_cpu_count();
+    worker_count = CLAMP(worker_count, 1u, MIN((uint32_t)PIPELINE_BATCH_MAX_WORKERS, MAX(count, 1u)));
+
+    memset(results, 0, count * sizeof(PipelineBatchResult));
+
+    PipelineBatchJob job = {
+        .device     = device,
+        .desc_cache = desc_cache,
+        .pipe_cache = pipe_cache,
+        .obj_cache  = obj_cache,
+        .descs      = descs,
+        .results    = results,
+        .count      = count,
+    };
+
+    size_t seed_size = 0;
+    void*  seed      = cache != VK_NULL_HANDLE ? read_cache_data(device, cache, &seed_size) : NULL;
+
+    PipelineBatchWorker workers[PIPELINE_BATCH_MAX_WORKERS];
+    for(uint32_t i = 0; i < worker_count; i++)
+    {
+        workers[i] = (PipelineBatchWorker){
+            .job   = &job,
+            .index = i,
+            .cache = cache != VK_NULL_HANDLE ? create_worker_cache(device, seed, seed_size) : VK_NULL_HANDLE,
+        };
+    }
+    free(seed);
+
+    // worker 0 is this thread, if a spawn fails the remaining workers pick up the slack
+    uint32_t spawned = 1;
+    for(uint32_t i = 1; i < worker_count; i++)
+    {
+        if(!thread_create(&workers[i].thread, batch_worker_main, &workers[i]))
+        {
+            log_error("pipeline batch: failed to start worker %u, continuing with %u", i, spawned);
+            break;
+        }
+        spawned++;
+    }
+
+    batch_worker_main(&workers[0]);
+
+    for(uint32_t i = 1; i < spawned; i++)
+        thread_join(&workers[i].thread);
+
+    uint64_t merge_start = time_now_ns();
+
+    if(cache != VK_NULL_HANDLE)
+    {
+        VkPipelineCache sources[PIPELINE_BATCH_MAX_WORKERS];
+        for(uint32_t i = 0; i < worker_count; i++)
+            sources[i] = workers[i].cache;
+
+        if(saver)
+            pipeline_cache_saver_merge(saver, sources, worker_count);
+        else
+            pipeline_cache_merge(device, cache, sources, worker_count);
+    }
+
+    PipelineBatchStats stats = {.worker_count = spawned, .merge_ns = time_now_ns() - merge_start};
+
+    uint32_t created = 0;
+    for(uint32_t i = 0; i < count; i++)
+    {
+        stats.compile_ns += results[i].compile_ns;
+        stats.max_compile_ns = MAX(stats.max_compile_ns, results[i].compile_ns);
+
+        if(results[i].pipeline != VK_NULL_HANDLE)
+            created++;
+    }
+
+    stats.failed  = count - created;
+    stats.wall_ns = time_now_ns() - batch_start;
+
+    if(out_stats)
+        *out_stats = stats;
+
+    return created;
+}
@@ -0,0 +1,80 @@
+#ifndef VK_PIPELINE_BATCH_H_
+#define VK_PIPELINE_BATCH_H_
+
+#include "vk_defaults.h"
+#include "vk_pipeline_cache.h"
+#include "vk_pipelines.h"
+
+/* ------------------ Parallel pipeline compilation ------------------ */
+//
+// Builds many pipelines at once across a pool of worker threads. The
+// calling thread is one of the workers. Each worker compiles into its own
+// VkPipelineCache, seeded from the destination cache, so drivers that
+// lock the cache internally do not serialize the workers. When the batch
+// finishes, the worker caches are merged back into the destination with
+// vkMergePipelineCaches. That destination is normally the one loaded
+// through vk_pipeline_cache.h. The merge needs the destination to itself,
+// so when a PipelineCacheSaver is running on it, pass the saver and the
+// merge goes through pipeline_cache_saver_merge.
+//
+// The descriptor layout, pipeline layout and pipeline object caches are
+// shared by all workers, they are all safe to use from several threads.
+//
+//   PipelineBatchResult results[N];
+//   pipeline_batch_compile(device, cache, &saver, &desc_cache, &pipe_cache, &obj_cache, descs, N, 0, results, &stats);
+
+#define PIPELINE_BATCH_MAX_WORKERS 32
+
+typedef struct PipelineBatchDesc
+{
+    PipelineObjectKind kind;
+
+    // PIPELINE_OBJECT_GRAPHICS
+    const char*             vert_path;
+    const char*             frag_path;
+    GraphicsPipelineConfig* config;  // gets the reflected vertex input, one per desc
+
+    // PIPELINE_OBJECT_COMPUTE
+    const char*                   comp_path;
+    const PipelineSpecialization* specialization;  // optional
+
+    // Optional: the paths are then names in this archive
+    const ShaderArchive* archive;
+} PipelineBatchDesc;
+
+typedef struct PipelineBatchResult
+{
+    VkPipeline       pipeline;  // VK_NULL_HANDLE if the shaders could not be loaded
+    VkPipelineLayout layout;
+    uint64_t         compile_ns;  // load, reflection and creation of this pipeline
+    uint32_t         worker;      // 0 is the calling thread
+} PipelineBatchResult;
+
+typedef struct PipelineBatchStats
+{
+    uint64_t wall_ns;         // whole batch including cache seeding and merge
+    uint64_t merge_ns;        // vkMergePipelineCaches plus worker cache teardown
+    uint64_t compile_ns;      // sum over pipelines
+    uint64_t max_compile_ns;  // slowest pipeline
+    uint32_t worker_count;    // threads that actually ran
+    uint32_t failed;
+} PipelineBatchStats;
+
+// worker_count 0 uses one worker per core. cache may be VK_NULL_HANDLE to
+// skip the per-worker caches. saver is optional and must be the saver of
+// cache when one is running on it. Pipelines follow the ownership rules of
+// create_graphics_pipeline: obj_cache owns them when given. results must
+// hold count entries; returns how many pipelines were created.
+uint32_t pipeline_batch_compile(VkDevice                 device,
+                                VkPipelineCache          cache,
+                                PipelineCacheSaver*      saver,
+                                DescriptorLayoutCache*   desc_cache,
+                                PipelineLayoutCache*     pipe_cache,
+                                PipelineObjectCache*     obj_cache,
+                                const PipelineBatchDesc* descs,
+                                uint32_t                 count,
+                                uint32_t                 worker_count,
+                                PipelineBatchResult*     results,
+                                PipelineBatchStats*      out_stats);
+
+#endif // VK_PIPELINE_BATCH_H_
@@ -0,0 +1,360 @@
+#include "vk_pipeline_cache.h"
+
+static const uint8_t zero_pad[PIPELINE_CACHE_ALIGN];
+
+PipelineCacheDeviceKey pipeline_cache_device_key(VkPhysicalDevice phys)
+{
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(phys, &props);
+
+    PipelineCacheDeviceKey key;
+    memset(&key, 0, sizeof(key));
+    key.vendor_id      = props.vendorID;
+    key.device_id      = props.deviceID;
+    key.driver_version = props.driverVersion;
+    key.driver_abi     = sizeof(void*);
+    memcpy(key.uuid, props.pipelineCacheUUID, VK_UUID_SIZE);
+
+    return key;
+}
+
+// entry table of a mapped cache file, NULL if the file is stale or malformed
+static const PipelineCacheFileEntry* file_entries(const MappedFile* file, uint32_t* out_count)
+{
+    *out_count = 0;
+
+    const PipelineCacheFileHeader* header = (const PipelineCacheFileHeader*)file->data;
+    if(file->size < sizeof(*header) || header->magic != PIPELINE_CACHE_MAGIC || header->version != PIPELINE_CACHE_VERSION)
+        return NULL;
+    if((file->size - sizeof(*header)) / sizeof(PipelineCacheFileEntry) < header->entry_count)
+        return NULL;
+
+    *out_count = header->entry_count;
+    return (const PipelineCacheFileEntry*)(file->data + sizeof(*header));
+}
+
+static bool entry_in_bounds(const MappedFile* file, const PipelineCacheFileEntry* e)
+{
+    return e->offset <= file->size && e->size <= file->size - e->offset;
+}
+
+static VkPipelineCache create_cache(VkDevice device, const void* data, size_t size)
+{
+    VkPipelineCacheCreateInfo ci = {
+        .sType           = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+        .initialDataSize = size,
+        .pInitialData    = data,
+    };
+
+    VkPipelineCache cache = VK_NULL_HANDLE;
+    if(vkCreatePipelineCache(device, &ci, NULL, &cache) != VK_SUCCESS)
+        return VK_NULL_HANDLE;
+    return cache;
+}
+
+VkPipelineCache pipeline_cache_load_or_create(VkDevice device, VkPhysicalDevice phys, const char* path)
+{
+    PipelineCacheDeviceKey key = pipeline_cache_device_key(phys);
+
+    VkPipelineCache cache = VK_NULL_HANDLE;
+
+    MappedFile file;
+    if(mapped_file_open(&file, path, true))
+    {
+        uint32_t                      count   = 0;
+        const PipelineCacheFileEntry* entries = file_entries(&file, &count);
+
+        for(uint32_t i = 0; i < count; i++)
+        {
+            const PipelineCacheFileEntry* e = &entries[i];
+            if(memcmp(&e->device, &key, sizeof(key)) != 0)
+                continue;
+
+            // the driver reads the blob straight out of the mapping
+            if(entry_in_bounds(&file, e) && hash64_bytes(file.data + e->offset, e->size) == e->hash)
+                cache = create_cache(device, file.data + e->offset, e->size);
+            break;
+        }
+
+        mapped_file_close(&file);
+    }
+
+    if(cache == VK_NULL_HANDLE)
+    {
+        // missing, stale or rejected by the driver: start empty
+        cache = create_cache(device, NULL, 0);
+    }
+
+    return cache;
+}
+
+// copy of the cache's blob, NULL if the driver has nothing
+static void* get_cache_data(VkDevice device, VkPipelineCache cache, size_t* out_size)
+{
+    *out_size = 0;
+
+    size_t size = 0;
+    if(vkGetPipelineCacheData(device, cache, &size, NULL) != VK_SUCCESS || size == 0)
+        return NULL;
+
+    void* blob = malloc(size);
+
+    // VK_INCOMPLETE if it grew in between, what was written is still a valid blob
+    VkResult res = vkGetPipelineCacheData(device, cache, &size, blob);
+    if((res != VK_SUCCESS && res != VK_INCOMPLETE) || size == 0)
+    {
+        free(blob);
+        return NULL;
+    }
+
+    *out_size = size;
+    return blob;
+}
+
+// writes blob as the entry for key, keeping the other devices' entries of the current file
+static bool save_blob(const char* path, const PipelineCacheDeviceKey* key, const void* blob, size_t size)
+{
+    MappedFile                    old;
+    uint32_t                      old_count   = 0;
+    bool                          old_mapped  = mapped_file_open(&old, path, true);
+    const PipelineCacheFileEntry* old_entries = old_mapped ? file_entries(&old, &old_count) : NULL;
+
+    PipelineCacheFileEntry entries[PIPELINE_CACHE_MAX_DEVICES];
+    const void*            blobs[PIPELINE_CACHE_MAX_DEVICES];
+    uint32_t               count = 0;
+
+    memset(entries, 0, sizeof(entries));
+    entries[count].device = *key;
+    entries[count].size   = size;
+    entries[count].hash   = hash64_bytes(blob, size);
+    blobs[count++]        = blob;
+
+    // most recently saved first, the oldest devices fall off the end
+    for(uint32_t i = 0; i < old_count && count < PIPELINE_CACHE_MAX_DEVICES; i++)
+    {
+        const PipelineCacheFileEntry* e = &old_entries[i];
+        if(memcmp(&e->device, key, sizeof(*key)) == 0 || !entry_in_bounds(&old, e))
+            continue;
+
+        entries[count] = *e;
+        blobs[count++] = old.data + e->offset;
+    }
+
+    PipelineCacheFileHeader header = {
+        .magic       = PIPELINE_CACHE_MAGIC,
+        .version     = PIPELINE_CACHE_VERSION,
+        .entry_count = count,
+    };
+
+    // header | entries | (pad | blob)*
+    const void* parts[2 + 2 * PIPELINE_CACHE_MAX_DEVICES];
+    size_t      part_sizes[2 + 2 * PIPELINE_CACHE_MAX_DEVICES];
+    uint32_t    part_count = 0;
+
+    parts[part_count]        = &header;
+    part_sizes[part_count++] = sizeof(header);
+    parts[part_count]        = entries;
+    part_sizes[part_count++] = count * sizeof(PipelineCacheFileEntry);
+
+    uint64_t offset = sizeof(header) + count * sizeof(PipelineCacheFileEntry);
+    for(uint32_t i = 0; i < count; i++)
+    {
+        uint64_t aligned = round_up_64(offset, PIPELINE_CACHE_ALIGN);
+
+        parts[part_count]        = zero_pad;
+        part_sizes[part_count++] = (size_t)(aligned - offset);
+        parts[part_count]        = blobs[i];
+        part_sizes[part_count++] = (size_t)entries[i].size;
+
+        entries[i].offset = aligned;
+        offset            = aligned + entries[i].size;
+    }
+
+    // the old blobs are read from the old mapping, which survives the rename
+    bool ok = write_file_atomic(path, parts, part_sizes, part_count);
+
+    if(old_mapped)
+        mapped_file_close(&old);
+
+    return ok;
+}
+
+bool pipeline_cache_save(VkDevice device, VkPhysicalDevice phys, VkPipelineCache cache, const char* path)
+{
+    size_t size = 0;
+    void*  blob = get_cache_data(device, cache, &size);
+    if(!blob)
+        return false;
+
+    PipelineCacheDeviceKey key = pipeline_cache_device_key(phys);
+    bool                   ok  = save_blob(path, &key, blob, size);
+
+    free(blob);
+    return ok;
+}
+
+void pipeline_cache_merge(VkDevice device, VkPipelineCache dst, VkPipelineCache* srcs, uint32_t count)
+{
+    if(count == 0)
+        return;
+
+    VK_CHECK(vkMergePipelineCaches(device, dst, count, srcs));
+
+    for(uint32_t i = 0; i < count; i++)
+    {
+        vkDestroyPipelineCache(device, srcs[i], NULL);
+        srcs[i] = VK_NULL_HANDLE;
+    }
+}
+
+// ============================================================================
+// Background saving
+// ============================================================================
+
+static size_t cache_data_size(VkDevice device, VkPipelineCache cache)
+{
+    size_t size = 0;
+    if(vkGetPipelineCacheData(device, cache, &size, NULL) != VK_SUCCESS)
+        return 0;
+    return size;
+}
+
+// called from the save thread, or from stop after it was joined
+static void saver_save_if_grown(PipelineCacheSaver* saver)
+{
+    mutex_lock(&saver->cache_lock);
+
+    size_t size = cache_data_size(saver->device, saver->cache);
+    void*  blob = NULL;
+    if(size != saver->saved_size)
+        blob = get_cache_data(saver->device, saver->cache, &size);
+
+    mutex_unlock(&saver->cache_lock);
+
+    if(!blob)
+    {
+        mutex_lock(&saver->lock);
+        saver->stats.skipped++;
+        mutex_unlock(&saver->lock);
+        return;
+    }
+
+    uint64_t start   = time_now_ns();
+    bool     ok      = save_blob(saver->path, &saver->key, blob, size);
+    uint64_t elapsed = time_now_ns() - start;
+
+    free(blob);
+
+    if(!ok)
+        return;  // saved_size unchanged, the next wakeup tries again
+
+    saver->saved_size = size;
+
+    mutex_lock(&saver->lock);
+    saver->stats.saves++;
+    saver->stats.bytes = size;
+    saver->stats.save_ns += elapsed;
+    saver->stats.max_save_ns = MAX(saver->stats.max_save_ns, elapsed);
+    mutex_unlock(&saver->lock);
+}
+
+static void* saver_thread_main(void* arg)
+{
+    PipelineCacheSaver* saver = arg;
+
+    mutex_lock(&saver->lock);
+
+    for(;;)
+    {
+        if(!saver->shutdown && !saver->save_requested)
+            condvar_wait_timeout(&saver->wake, &saver->lock, saver->interval_ns);
+
+        if(saver->shutdown)
+            break;
+
+        saver->save_requested = false;
+        mutex_unlock(&saver->lock);
+
+        saver_save_if_grown(saver);
+
+        mutex_lock(&saver->lock);
+    }
+
+    mutex_unlock(&saver->lock);
+
+    return NULL;
+}
+
+bool pipeline_cache_saver_start(PipelineCacheSaver* saver,
+                                VkDevice            device,
+                                VkPhysicalDevice    phys,
+                                VkPipelineCache     cache,
+                                const char*         path,
+                                uint32_t            interval_ms)
+{
+    memset(saver, 0, sizeof(*saver));
+    saver->device      = device;
+    saver->cache       = cache;
+    saver->key         = pipeline_cache_device_key(phys);
+    saver->interval_ns = (uint64_t)MAX(interval_ms, 1u) * 1000000ull;
+    saver->saved_size  = cache_data_size(device, cache);
+
+    size_t len  = strlen(path) + 1;
+    saver->path = malloc(len);
+    memcpy(saver->path, path, len);
+
+    mutex_init(&saver->cache_lock);
+    mutex_init(&saver->lock);
+    condvar_init(&saver->wake);
+
+    saver->running = thread_create(&saver->thread, saver_thread_main, saver);
+    if(!saver->running)
+        log_error("pipeline cache: failed to start the save thread, saving only on stop");
+
+    return saver->running;
+}
+
+void pipeline_cache_saver_stop(PipelineCacheSaver* saver)
+{
+    if(saver->running)
+    {
+        mutex_lock(&saver->lock);
+        saver->shutdown = true;
+        condvar_signal(&saver->wake);
+        mutex_unlock(&saver->lock);
+
+        thread_join(&saver->thread);
+        saver->running = false;
+    }
+
+    saver_save_if_grown(saver);
+
+    free(saver->path);
+    saver->path = NULL;
+
+    condvar_destroy(&saver->wake);
+    mutex_destroy(&saver->lock);
+    mutex_destroy(&saver->cache_lock);
+}
+
+void pipeline_cache_saver_request(PipelineCacheSaver* saver)
+{
+    mutex_lock(&saver->lock);
+    saver->save_requested = true;
+    condvar_signal(&saver->wake);
+    mutex_unlock(&saver->lock);
+}
+
+void pipeline_cache_saver_merge(PipelineCacheSaver* saver, VkPipelineCache* srcs, uint32_t count)
+{
+    mutex_lock(&saver->cache_lock);
+    pipeline_cache_merge(saver->device, saver->cache, srcs, count);
+    mutex_unlock(&saver->cache_lock);
+}
+
+void pipeline_cache_saver_get_stats(PipelineCacheSaver* saver, PipelineCacheSaverStats* out)
+{
+    mutex_lock(&saver->lock);
+    *out = saver->stats;
+    mutex_unlock(&saver->lock);
+}
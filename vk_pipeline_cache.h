@@ -1,173 +1,128 @@
 #ifndef VK_PIPELINE_CACHE_H_
 #define VK_PIPELINE_CACHE_H_
 
-// Single-file Vulkan pipeline cache utility.
-// Loads a pipeline cache from disk (safely), validates it,
-// and falls back to empty cache if anything smells wrong.
+#include "vk_defaults.h"
+#include "vk_file.h"
+#include "vk_thread.h"
+
+/* ------------------ Pipeline cache persistence ------------------ */
+//
+// Loads a VkPipelineCache from disk, validates it, and falls back to an
+// empty cache if anything smells wrong. One file holds a blob per
+// device and driver, so switching GPUs or updating the driver does not
+// throw away the other caches:
+//
+//   header | entries, most recently saved first | blobs
 //
+// The file is mmapped and the blob goes to the driver straight from the
+// mapping. Saving rewrites the file atomically (write_file_atomic) and
+// keeps the entries of other devices, up to PIPELINE_CACHE_MAX_DEVICES.
+//
+// The driver only hands out its whole blob, so every save writes all of
+// it. PipelineCacheSaver moves that off the caller's thread and skips
+// it while the cache has not grown:
+//
+//   VkPipelineCache cache = pipeline_cache_load_or_create(device, phys, "pipelines.cache");
+//   PipelineCacheSaver saver;
+//   pipeline_cache_saver_start(&saver, device, phys, cache, "pipelines.cache", 30000);
+//   ...
+//   pipeline_cache_saver_stop(&saver);  // final save if the cache grew
+//
+// Integers are stored in the byte order of the saving machine, which is
+// also covered by the driver's own blob header.
+
 #ifndef PIPELINE_CACHE_MAGIC
-#define PIPELINE_CACHE_MAGIC 0xCAFEBABE
+#define PIPELINE_CACHE_MAGIC 0x43504B56u  // "VKPC"
 #endif
+#define PIPELINE_CACHE_VERSION 2
+#define PIPELINE_CACHE_MAX_DEVICES 8
+#define PIPELINE_CACHE_ALIGN 8
 
-#include "vk_defaults.h"
-typedef struct PipelineCachePrefixHeader
+typedef struct PipelineCacheFileHeader
 {
     uint32_t magic;
-    uint32_t dataSize;
-    uint64_t dataHash;
-
-    uint32_t vendorID;
-    uint32_t deviceID;
-    uint32_t driverVersion;
-    uint32_t driverABI;
+    uint32_t version;
+    uint32_t entry_count;
+    uint32_t reserved;
+} PipelineCacheFileHeader;
 
-    uint8_t uuid[VK_UUID_SIZE];
-} PipelineCachePrefixHeader;
+// identifies which device and driver a blob belongs to
+typedef struct PipelineCacheDeviceKey
+{
+    uint32_t vendor_id;
+    uint32_t device_id;
+    uint32_t driver_version;
+    uint32_t driver_abi;  // sizeof(void*)
+    uint8_t  uuid[VK_UUID_SIZE];
+} PipelineCacheDeviceKey;
+
+typedef struct PipelineCacheFileEntry
+{
+    PipelineCacheDeviceKey device;
+    uint64_t               offset;  // blob offset from the start of the file
+    uint64_t               size;
+    Hash64                 hash;  // XXH64 of the blob
+} PipelineCacheFileEntry;
 
-// very boring but reliable hash (FNV-1a)
+PipelineCacheDeviceKey pipeline_cache_device_key(VkPhysicalDevice phys);
 
+VkPipelineCache pipeline_cache_load_or_create(VkDevice device, VkPhysicalDevice phys, const char* path);
 
-static int write_all(FILE* f, const void* data, size_t size)
-{
-    return fwrite(data, 1, size, f) == size;
-}
+// blocking save of the blob for phys, other devices' blobs in path are kept
+bool pipeline_cache_save(VkDevice device, VkPhysicalDevice phys, VkPipelineCache cache, const char* path);
 
-static int read_all(FILE* f, void* data, size_t size)
-{
-    return fread(data, 1, size, f) == size;
-}
+// merges per-thread caches into dst and destroys them; dst must not be in use meanwhile,
+// use pipeline_cache_saver_merge instead while a saver runs on dst
+void pipeline_cache_merge(VkDevice device, VkPipelineCache dst, VkPipelineCache* srcs, uint32_t count);
 
-static void get_device_props(VkPhysicalDevice phys, VkPhysicalDeviceProperties* out)
-{
-    vkGetPhysicalDeviceProperties(phys, out);
-}
+/* ------------------ Background saving ------------------ */
 
-static int validate_header(const PipelineCachePrefixHeader* h, const VkPhysicalDeviceProperties* props)
-{
-    if(h->magic != PIPELINE_CACHE_MAGIC)
-        return 0;
-    if(h->driverABI != sizeof(void*))
-        return 0;
-    if(h->vendorID != props->vendorID)
-        return 0;
-    if(h->deviceID != props->deviceID)
-        return 0;
-    if(h->driverVersion != props->driverVersion)
-        return 0;
-    if(memcmp(h->uuid, props->pipelineCacheUUID, VK_UUID_SIZE) != 0)
-        return 0;
-    return 1;
-}
-
-VkPipelineCache pipeline_cache_load_or_create(VkDevice device, VkPhysicalDevice phys, const char* path)
+typedef struct PipelineCacheSaverStats
 {
-    VkPhysicalDeviceProperties props;
-    get_device_props(phys, &props);
-
-    VkPipelineCache cache = VK_NULL_HANDLE;
-
-    FILE* f = fopen(path, "rb");
-    if(!f)
-    {
-        // file missing, build empty cache
-        VkPipelineCacheCreateInfo ci = {.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO};
-        vkCreatePipelineCache(device, &ci, NULL, &cache);
-        return cache;
-    }
-
-    PipelineCachePrefixHeader hdr;
-    if(!read_all(f, &hdr, sizeof(hdr)))
-    {
-        fclose(f);
-        goto fallback;
-    }
-
-    if(!validate_header(&hdr, &props))
-    {
-        fclose(f);.
-        goto fallback;
-    }
-
-    void* blob = malloc(hdr.dataSize);
-    if(!blob)
-    {
-        fclose(f);
-        goto fallback;
-    }
-
-    if(!read_all(f, blob, hdr.dataSize))
-    {
-        free(blob);
-        fclose(f);
-        goto fallback;
-    }
-
-    fclose(f);
-
-    if(hash64_bytes(blob, hdr.dataSize) != hdr.dataHash)
-    {
-        free(blob);
-        goto fallback;
-    }
-
-    VkPipelineCacheCreateInfo ci = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO, .initialDataSize = hdr.dataSize, .pInitialData = blob};
-
-    VkResult res = vkCreatePipelineCache(device, &ci, NULL, &cache);
-    free(blob);
-
-    if(res != VK_SUCCESS)
-    {
-    fallback:
-        // sigh… drivers
-        VkPipelineCacheCreateInfo empty = {.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO};
-        vkCreatePipelineCache(device, &empty, NULL, &cache);
-    }
-
-    return cache;
-}
-
-void pipeline_cache_save(VkDevice device, VkPhysicalDevice phys, VkPipelineCache cache, const char* path)
+    uint32_t saves;
+    uint32_t skipped;     // wakeups where the cache had not grown
+    uint64_t bytes;       // last saved blob size
+    uint64_t save_ns;     // total time spent saving
+    uint64_t max_save_ns;
+} PipelineCacheSaverStats;
+
+typedef struct PipelineCacheSaver
 {
-    size_t size = 0;
-    vkGetPipelineCacheData(device, cache, &size, NULL);
-    if(size == 0)
-        return;
-
-    void* blob = malloc(size);
-    if(!blob)
-        return;
-
-    vkGetPipelineCacheData(device, cache, &size, blob);
-
-    VkPhysicalDeviceProperties props;
-    get_device_props(phys, &props);
-
-    PipelineCachePrefixHeader hdr = {.magic         = PIPELINE_CACHE_MAGIC,
-                                     .dataSize      = (uint32_t)size,
-                                     .dataHash      = hash64_bytes(blob, size),
-                                     .vendorID      = props.vendorID,
-                                     .deviceID      = props.deviceID,
-                                     .driverVersion = props.driverVersion,
-                                     .driverABI     = sizeof(void*)};
-    memcpy(hdr.uuid, props.pipelineCacheUUID, VK_UUID_SIZE);
-
-    char tmp[1024];
-    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
-
-    FILE* f = fopen(tmp, "wb");
-    if(!f)
-    {
-        free(blob);
-        return;
-    }
-
-    write_all(f, &hdr, sizeof(hdr));
-    write_all(f, blob, size);
-    fclose(f);
-
-    rename(tmp, path);
-    free(blob);
-}
+    VkDevice               device;
+    VkPipelineCache        cache;
+    PipelineCacheDeviceKey key;
+    char*                  path;
+    uint64_t               interval_ns;
+    size_t                 saved_size;  // blob size at the last save or load
+
+    Mutex   cache_lock;  // serializes blob reads with pipeline_cache_saver_merge
+    Mutex   lock;        // guards the fields below
+    CondVar wake;
+    Thread  thread;
+    bool    running;
+    bool    save_requested;
+    bool    shutdown;
+
+    PipelineCacheSaverStats stats;
+} PipelineCacheSaver;
+
+// saves cache to path every interval_ms on its own thread, when it grew
+bool pipeline_cache_saver_start(PipelineCacheSaver* saver,
+                                VkDevice            device,
+                                VkPhysicalDevice    phys,
+                                VkPipelineCache     cache,
+                                const char*         path,
+                                uint32_t            interval_ms);
+
+// stops the thread, saves one last time if the cache grew
+void pipeline_cache_saver_stop(PipelineCacheSaver* saver);
+
+// wakes the thread for a save now, e.g. after a loading screen
+void pipeline_cache_saver_request(PipelineCacheSaver* saver);
+
+// pipeline_cache_merge into the saved cache, safe against the save thread
+void pipeline_cache_saver_merge(PipelineCacheSaver* saver, VkPipelineCache* srcs, uint32_t count);
+
+void pipeline_cache_saver_get_stats(PipelineCacheSaver* saver, PipelineCacheSaverStats* out);
 
 #endif // VK_PIPELINE_CACHE_H_
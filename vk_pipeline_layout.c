@@ -1,24 +1,43 @@
 #include "vk_pipeline_layout.h"
 
 
-static Hash64 hash_pipeline_layout_key(const PipelineLayoutKey* k)
+// borrowed view of the caller's arrays, so the hit path never copies a key
+typedef struct PipelineLayoutLookup
 {
-    Hash64 h = 0;
-
-    h ^= hash64_bytes(k->set_layouts, k->set_layout_count * sizeof(VkDescriptorSetLayout));
+    const VkDescriptorSetLayout* set_layouts;
+    uint32_t                     set_layout_count;
+    const VkPushConstantRange*   push_constants;
+    uint32_t                     push_constant_count;
+    Hash64                       hash;
+} PipelineLayoutLookup;
+
+// chained so that order matters, counts seed the chain so no split of the arrays aliases another
+static Hash64 hash_pipeline_layout(const VkDescriptorSetLayout* set_layouts,
+                                   uint32_t                     set_layout_count,
+                                   const VkPushConstantRange*   push_ranges,
+                                   uint32_t                     push_range_count)
+{
+    Hash64 h = XXH64(set_layouts, set_layout_count * sizeof(VkDescriptorSetLayout), ((uint64_t)push_range_count << 32) | set_layout_count);
+    return XXH64(push_ranges, push_range_count * sizeof(VkPushConstantRange), h);
+}
 
-    h ^= hash64_bytes(k->push_constants, k->push_constant_count * sizeof(VkPushConstantRange));
 
-    h ^= k->set_layout_count;
-    h ^= k->push_constant_count << 16;
+static bool pipeline_layout_entry_matches(const void* value, const void* key)
+{
+    const PipelineLayoutKey*    a = &((const PipelineLayoutEntry*)value)->key;
+    const PipelineLayoutLookup* b = key;
 
-    return h;
+    return a->hash == b->hash && a->set_layout_count == b->set_layout_count && a->push_constant_count == b->push_constant_count
+           && memcmp(a->set_layouts, b->set_layouts, b->set_layout_count * sizeof(VkDescriptorSetLayout)) == 0
+           && memcmp(a->push_constants, b->push_constants, b->push_constant_count * sizeof(VkPushConstantRange)) == 0;
 }
 
 
 void pipeline_layout_cache_init(PipelineLayoutCache* cache)
 {
     cache->entries = NULL;
+    hash_index_init(&cache->index, 0);
+    mutex_init(&cache->lock);
 }
 
 
@@ -29,51 +48,61 @@ VkPipelineLayout pipeline_layout_cache_get(VkDevice                     device,
                                            const VkPushConstantRange*   push_ranges,
                                            uint32_t                     push_range_count)
 {
-    PipelineLayoutKey key = {0};
+    assert(set_layout_count <= 8 && push_range_count <= 4);
 
-    key.set_layout_count = set_layout_count;
-    memcpy(key.set_layouts, set_layouts, set_layout_count * sizeof(VkDescriptorSetLayout));
+    PipelineLayoutLookup lookup = {
+        .set_layouts         = set_layouts,
+        .set_layout_count    = set_layout_count,
+        .push_constants      = push_ranges,
+        .push_constant_count = push_range_count,
+        .hash                = hash_pipeline_layout(set_layouts, set_layout_count, push_ranges, push_range_count),
+    };
 
-    key.push_constant_count = push_range_count;
-    memcpy(key.push_constants, push_ranges, push_range_count * sizeof(VkPushConstantRange));
+    PipelineLayoutEntry* hit = hash_index_find(&cache->index, lookup.hash, pipeline_layout_entry_matches, &lookup);
+    if(hit)
+        return hit->layout;
 
-    key.hash = hash_pipeline_layout_key(&key);
+    mutex_lock(&cache->lock);
 
-    // search existing
-    for(int i = 0; i < arrlen(cache->entries); i++)
+    // another thread may have created it while we waited
+    PipelineLayoutEntry* entry = hash_index_find(&cache->index, lookup.hash, pipeline_layout_entry_matches, &lookup);
+    if(!entry)
     {
-        PipelineLayoutEntry* e = &cache->entries[i];
-
-        if(e->key.hash == key.hash && e->key.set_layout_count == key.set_layout_count && e->key.push_constant_count == key.push_constant_count
-           && memcmp(e->key.set_layouts, key.set_layouts, key.set_layout_count * sizeof(VkDescriptorSetLayout)) == 0
-           && memcmp(e->key.push_constants, key.push_constants, key.push_constant_count * sizeof(VkPushConstantRange)) == 0)
-        {
-            return e->layout;
-        }
+        VkPipelineLayoutCreateInfo info = {.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+                                           .setLayoutCount         = set_layout_count,
+                                           .pSetLayouts            = set_layouts,
+                                           .pushConstantRangeCount = push_range_count,
+                                           .pPushConstantRanges    = push_ranges};
+
+        entry = calloc(1, sizeof(PipelineLayoutEntry));
+        memcpy(entry->key.set_layouts, set_layouts, set_layout_count * sizeof(VkDescriptorSetLayout));
+        if(push_range_count)
+            memcpy(entry->key.push_constants, push_ranges, push_range_count * sizeof(VkPushConstantRange));
+        entry->key.set_layout_count    = set_layout_count;
+        entry->key.push_constant_count = push_range_count;
+        entry->key.hash                = lookup.hash;
+        VK_CHECK(vkCreatePipelineLayout(device, &info, NULL, &entry->layout));
+
+        arrpush(cache->entries, entry);
+        hash_index_insert(&cache->index, lookup.hash, entry);
     }
 
-    // create new layout
-    VkPipelineLayoutCreateInfo info = {.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
-                                       .setLayoutCount         = set_layout_count,
-                                       .pSetLayouts            = set_layouts,
-                                       .pushConstantRangeCount = push_range_count,
-                                       .pPushConstantRanges    = push_ranges};
+    mutex_unlock(&cache->lock);
 
-    VkPipelineLayout layout;
-    VK_CHECK(vkCreatePipelineLayout(device, &info, NULL, &layout));
-
-    PipelineLayoutEntry entry = {key, layout};
-    arrpush(cache->entries, entry);
-
-    return layout;
+    return entry->layout;
 }
 
 void pipeline_layout_cache_destroy(VkDevice device, PipelineLayoutCache* cache)
 {
     for(int i = 0; i < arrlen(cache->entries); i++)
-        vkDestroyPipelineLayout(device, cache->entries[i].layout, NULL);
+    {
+        vkDestroyPipelineLayout(device, cache->entries[i]->layout, NULL);
+        free(cache->entries[i]);
+    }
 
     arrfree(cache->entries);
+    hash_index_destroy(&cache->index);
+    mutex_destroy(&cache->lock);
 }
 
 
@@ -86,6 +115,8 @@ VkPipelineLayout pipeline_layout_cache_build(VkDevice
                                              const VkPushConstantRange*                 push_ranges,
                                              uint32_t                                   push_count)
 {
+    assert(set_count <= 8);
+
     VkDescriptorSetLayout layouts[8];
 
     for(uint32_t i = 0; i < set_count; i++)
@@ -24,9 +24,12 @@ typedef struct PipelineLayoutEntry
 
 } PipelineLayoutEntry;
 
+// safe to share between threads: hits are lock-free, misses serialize on lock
 typedef struct PipelineLayoutCache
 {
-    PipelineLayoutEntry* entries;  // stretchy buffer
+    PipelineLayoutEntry** entries;  // stretchy buffer of heap allocated entries
+    HashIndex             index;    // key hash -> entry
+    Mutex                 lock;     // guards entries and inserts into index
 } PipelineLayoutCache;
 
 void pipeline_layout_cache_init(PipelineLayoutCache* cache);
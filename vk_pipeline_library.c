@@ -0,0 +1,500 @@
+#include "vk_pipeline_library.h"
+#include "vk_dynamic_state.h"
+
+#define LIBRARY_CREATE_FLAGS (VK_PIPELINE_CREATE_LIBRARY_BIT_KHR | VK_PIPELINE_CREATE_RETAIN_LINK_TIME_OPTIMIZATION_INFO_BIT_EXT)
+
+static const VkGraphicsPipelineLibraryFlagsEXT part_flags[PIPELINE_LIBRARY_PART_COUNT] = {
+    VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT,
+    VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT,
+    VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT,
+    VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT,
+};
+
+// dynamic states each part has to declare, the linked pipeline gets their union
+static const uint32_t part_dynamic[PIPELINE_LIBRARY_PART_COUNT] = {
+    PIPELINE_DYNAMIC_PRIMITIVE_TOPOLOGY,
+    PIPELINE_DYNAMIC_CULL_MODE | PIPELINE_DYNAMIC_FRONT_FACE | PIPELINE_DYNAMIC_POLYGON_MODE,
+    PIPELINE_DYNAMIC_DEPTH_TEST | PIPELINE_DYNAMIC_DEPTH_WRITE,
+    0,
+};
+
+// ============================================================================
+// Part keys
+// ============================================================================
+
+static Hash64 hash_part_key(const PipelineLibraryPartKey* k)
+{
+    Hash64 h = XXH64(&k->layout, sizeof(k->layout), k->part);
+    h        = XXH64(&k->content_hash, sizeof(k->content_hash), h);
+    return XXH64(k->state, sizeof(k->state), h);
+}
+
+static bool part_entry_matches(const void* value, const void* key)
+{
+    const PipelineLibraryPartKey* a = &((const PipelineLibraryPartEntry*)value)->key;
+    const PipelineLibraryPartKey* b = key;
+
+    return a->hash == b->hash && a->part == b->part && a->layout == b->layout && a->content_hash == b->content_hash
+           && memcmp(a->state, b->state, sizeof(a->state)) == 0;
+}
+
+// only the static config fields a part actually consumes go into its key
+static void make_part_key(PipelineLibraryPartKey*       key,
+                          PipelineLibraryPart           part,
+                          const GraphicsPipelineConfig* cfg,
+                          VkPipelineLayout              layout,
+                          Hash64                        shader_hash)
+{
+    uint32_t dyn = cfg->dynamic_state & part_dynamic[part];
+
+    memset(key, 0, sizeof(*key));
+    key->part     = part;
+    key->state[0] = cfg->pipeline_flags;
+    key->state[1] = dyn;
+
+    switch(part)
+    {
+        case PIPELINE_LIBRARY_VERTEX_INPUT:
+        {
+            Hash64 h          = XXH64(cfg->vertex_bindings, cfg->vertex_binding_count * sizeof(VkVertexInputBindingDescription),
+                                      cfg->vertex_binding_count);
+            key->content_hash = XXH64(cfg->vertex_attributes, cfg->vertex_attribute_count * sizeof(VkVertexInputAttributeDescription), h);
+            key->state[2]     = (dyn & PIPELINE_DYNAMIC_PRIMITIVE_TOPOLOGY) ? topology_class(cfg->topology) : cfg->topology;
+            break;
+        }
+        case PIPELINE_LIBRARY_PRE_RASTERIZATION:
+            key->content_hash = shader_hash;
+            key->layout       = layout;
+            key->state[2]     = (dyn & PIPELINE_DYNAMIC_CULL_MODE) ? 0 : cfg->cull_mode;
+            key->state[3]     = (dyn & PIPELINE_DYNAMIC_FRONT_FACE) ? 0 : cfg->front_face;
+            key->state[4]     = (dyn & PIPELINE_DYNAMIC_POLYGON_MODE) ? 0 : cfg->polygon_mode;
+            break;
+        case PIPELINE_LIBRARY_FRAGMENT_SHADER:
+            key->content_hash = shader_hash;
+            key->layout       = layout;
+            key->state[2]     = (dyn & PIPELINE_DYNAMIC_DEPTH_TEST) ? 0 : cfg->depth_test_enable;
+            key->state[3]     = (dyn & PIPELINE_DYNAMIC_DEPTH_WRITE) ? 0 : cfg->depth_write_enable;
+            break;
+        case PIPELINE_LIBRARY_FRAGMENT_OUTPUT:
+            assert(cfg->color_attachment_count <= PIPELINE_OBJECT_MAX_COLOR_FORMATS);
+            key->state[2] = cfg->depth_format;
+            key->state[3] = cfg->stencil_format;
+            key->state[4] = cfg->color_attachment_count;
+            if(cfg->color_attachment_count)
+                memcpy(&key->state[5], cfg->color_formats, cfg->color_attachment_count * sizeof(VkFormat));
+            break;
+    }
+
+    key->hash = hash_part_key(key);
+}
+
+// ============================================================================
+// Part creation
+// ============================================================================
+
+static VkPipeline build_part(const PipelineLibraryCache*   lib,
+                             PipelineLibraryPart           part,
+                             const GraphicsPipelineConfig* cfg,
+                             VkPipelineLayout              layout,
+                             const void*                   code,
+                             size_t                        code_size)
+{
+    VkShaderModule module = VK_NULL_HANDLE;
+    if(code)
+    {
+        VkShaderModuleCreateInfo module_info = {
+            .sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+            .codeSize = code_size,
+            .pCode    = (const uint32_t*)code,
+        };
+        VK_CHECK(vkCreateShaderModule(lib->device, &module_info, NULL, &module));
+    }
+
+    VkPipelineShaderStageCreateInfo stage = {
+        .sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+        .stage  = part == PIPELINE_LIBRARY_PRE_RASTERIZATION ? VK_SHADER_STAGE_VERTEX_BIT : VK_SHADER_STAGE_FRAGMENT_BIT,
+        .module = module,
+        .pName  = "main",
+    };
+
+    VkPipelineVertexInputStateCreateInfo vertex_input = {
+        .sType                           = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+        .vertexBindingDescriptionCount   = cfg->vertex_binding_count,
+        .pVertexBindingDescriptions      = cfg->vertex_bindings,
+        .vertexAttributeDescriptionCount = cfg->vertex_attribute_count,
+        .pVertexAttributeDescriptions    = cfg->vertex_attributes,
+    };
+
+    VkPipelineInputAssemblyStateCreateInfo input_assembly = {
+        .sType    = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+        .topology = cfg->topology,
+    };
+
+    VkPipelineViewportStateCreateInfo viewport = {
+        .sType         = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+        .viewportCount = 1,
+        .scissorCount  = 1,
+    };
+
+    VkPipelineRasterizationStateCreateInfo raster = {
+        .sType       = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+        .polygonMode = cfg->polygon_mode,
+        .cullMode    = cfg->cull_mode,
+        .frontFace   = cfg->front_face,
+        .lineWidth   = 1.0f,
+    };
+
+    // viewport and scissor belong to pre-rasterization, everything else to the part that owns the field
+    VkDynamicState dyn_states[2 + PIPELINE_DYNAMIC_STATE_MAX] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    uint32_t       dyn_first = part == PIPELINE_LIBRARY_PRE_RASTERIZATION ? 0 : 2;
+    uint32_t       dyn_count = 2 + pipeline_dynamic_state_list(cfg->dynamic_state & part_dynamic[part], dyn_states + 2);
+
+    VkPipelineDynamicStateCreateInfo dynamic = {
+        .sType             = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+        .dynamicStateCount = dyn_count - dyn_first,
+        .pDynamicStates    = dyn_states + dyn_first,
+    };
+
+    VkPipelineMultisampleStateCreateInfo multisample = {
+        .sType                = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+        .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+    };
+
+    VkPipelineDepthStencilStateCreateInfo depth_stencil = {
+        .sType            = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+        .depthTestEnable  = cfg->depth_test_enable,
+        .depthWriteEnable = cfg->depth_write_enable,
+        .depthCompareOp   = VK_COMPARE_OP_LESS,
+    };
+
+    VkPipelineColorBlendAttachmentState blend_atts[PIPELINE_OBJECT_MAX_COLOR_FORMATS];
+    for(uint32_t i = 0; i < cfg->color_attachment_count; i++)
+    {
+        blend_atts[i] = (VkPipelineColorBlendAttachmentState){
+            .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
+        };
+    }
+
+    VkPipelineColorBlendStateCreateInfo blend = {
+        .sType           = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+        .attachmentCount = cfg->color_attachment_count,
+        .pAttachments    = blend_atts,
+    };
+
+    VkPipelineRenderingCreateInfo rendering = {
+        .sType                   = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO,
+        .colorAttachmentCount    = cfg->color_attachment_count,
+        .pColorAttachmentFormats = cfg->color_formats,
+        .depthAttachmentFormat   = cfg->depth_format,
+        .stencilAttachmentFormat = cfg->stencil_format,
+    };
+
+    VkGraphicsPipelineLibraryCreateInfoEXT library_info = {
+        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT,
+        .pNext = &rendering,
+        .flags = part_flags[part],
+    };
+
+    VkGraphicsPipelineCreateInfo ci = {
+        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+        .pNext = &library_info,
+        .flags = LIBRARY_CREATE_FLAGS | cfg->pipeline_flags,
+    };
+
+    switch(part)
+    {
+        case PIPELINE_LIBRARY_VERTEX_INPUT:
+            ci.pVertexInputState   = &vertex_input;
+            ci.pInputAssemblyState = &input_assembly;
+            ci.pDynamicState       = dynamic.dynamicStateCount ? &dynamic : NULL;
+            break;
+        case PIPELINE_LIBRARY_PRE_RASTERIZATION:
+            ci.stageCount          = 1;
+            ci.pStages             = &stage;
+            ci.pViewportState      = &viewport;
+            ci.pRasterizationState = &raster;
+            ci.pDynamicState       = &dynamic;
+            ci.layout              = layout;
+            break;
+        case PIPELINE_LIBRARY_FRAGMENT_SHADER:
+            ci.stageCount         = 1;
+            ci.pStages            = &stage;
+            ci.pDepthStencilState = &depth_stencil;
+            ci.pMultisampleState  = &multisample;
+            ci.pDynamicState      = dynamic.dynamicStateCount ? &dynamic : NULL;
+            ci.layout             = layout;
+            break;
+        case PIPELINE_LIBRARY_FRAGMENT_OUTPUT:
+            ci.pColorBlendState  = &blend;
+            ci.pMultisampleState = &multisample;
+            break;
+    }
+
+    VkPipeline library = VK_NULL_HANDLE;
+    VK_CHECK(vkCreateGraphicsPipelines(lib->device, lib->cache, 1, &ci, NULL, &library));
+
+    if(module != VK_NULL_HANDLE)
+        vkDestroyShaderModule(lib->device, module, NULL);
+
+    return library;
+}
+
+// cached part for key, built outside the lock on a miss
+static VkPipeline get_part(PipelineLibraryCache*         lib,
+                           const PipelineLibraryPartKey* key,
+                           const GraphicsPipelineConfig* cfg,
+                           const void*                   code,
+                           size_t                        code_size)
+{
+    PipelineLibraryPartEntry* hit = hash_index_find(&lib->part_index, key->hash, part_entry_matches, key);
+    if(hit)
+    {
+        ATOMIC_FETCH_ADD(&lib->stats.part_hits, 1);
+        return hit->library;
+    }
+
+    uint64_t   start   = time_now_ns();
+    VkPipeline library = build_part(lib, key->part, cfg, key->layout, code, code_size);
+    uint64_t   elapsed = time_now_ns() - start;
+
+    mutex_lock(&lib->lock);
+
+    lib->stats.part_misses++;
+    lib->stats.part_ns += elapsed;
+
+    PipelineLibraryPartEntry* entry = hash_index_find(&lib->part_index, key->hash, part_entry_matches, key);
+    if(entry)
+    {
+        vkDestroyPipeline(lib->device, library, NULL);
+    }
+    else
+    {
+        entry          = malloc(sizeof(PipelineLibraryPartEntry));
+        entry->key     = *key;
+        entry->library = library;
+
+        arrpush(lib->parts, entry);
+        hash_index_insert(&lib->part_index, key->hash, entry);
+    }
+
+    mutex_unlock(&lib->lock);
+
+    return entry->library;
+}
+
+// ============================================================================
+// Linking
+// ============================================================================
+
+static VkPipeline link_libraries(const PipelineLibraryCache* lib,
+                                 const VkPipeline*           libraries,
+                                 VkPipelineLayout            layout,
+                                 VkPipelineCreateFlags       flags)
+{
+    VkPipelineLibraryCreateInfoKHR link_info = {
+        .sType        = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR,
+        .libraryCount = PIPELINE_LIBRARY_PART_COUNT,
+        .pLibraries   = libraries,
+    };
+
+    VkGraphicsPipelineCreateInfo ci = {
+        .sType  = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+        .pNext  = &link_info,
+        .flags  = flags,
+        .layout = layout,
+    };
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VK_CHECK(vkCreateGraphicsPipelines(lib->device, lib->cache, 1, &ci, NULL, &pipeline));
+    return pipeline;
+}
+
+static bool link_matches(const void* value, const void* key)
+{
+    return ((const PipelineLibraryLink*)value)->fast == *(const VkPipeline*)key;
+}
+
+static Hash64 hash_handle(VkPipeline pipeline)
+{
+    return XXH64(&pipeline, sizeof(pipeline), 0);
+}
+
+static void* optimizer_main(void* arg)
+{
+    PipelineLibraryCache* lib = arg;
+
+    for(;;)
+    {
+        mutex_lock(&lib->lock);
+
+        while(!lib->shutdown && lib->optimize_head == arrlen(lib->links))
+            condvar_wait(&lib->work, &lib->lock);
+
+        if(lib->shutdown)
+        {
+            mutex_unlock(&lib->lock);
+            break;
+        }
+
+        PipelineLibraryLink* link = lib->links[lib->optimize_head++];
+
+        mutex_unlock(&lib->lock);
+
+        uint64_t   start     = time_now_ns();
+        VkPipeline optimized = link_libraries(lib, link->libraries, link->layout, link->flags | VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT);
+        uint64_t   elapsed   = time_now_ns() - start;
+
+        ATOMIC_STORE_RELEASE(&link->optimized, optimized);
+
+        mutex_lock(&lib->lock);
+        lib->stats.optimized++;
+        lib->stats.optimize_ns += elapsed;
+        mutex_unlock(&lib->lock);
+    }
+
+    return NULL;
+}
+
+bool pipeline_library_supported(VkPhysicalDevice physical_device)
+{
+    VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT gpl_features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT,
+    };
+
+    VkPhysicalDeviceFeatures2 features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+        .pNext = &gpl_features,
+    };
+
+    vkGetPhysicalDeviceFeatures2(physical_device, &features);
+
+    return gpl_features.graphicsPipelineLibrary;
+}
+
+void pipeline_library_cache_init(PipelineLibraryCache* lib, VkDevice device, VkPipelineCache cache, bool optimize)
+{
+    memset(lib, 0, sizeof(*lib));
+    lib->device = device;
+    lib->cache  = cache;
+
+    hash_index_init(&lib->part_index, 0);
+    hash_index_init(&lib->link_index, 0);
+    mutex_init(&lib->lock);
+    condvar_init(&lib->work);
+
+    if(optimize)
+    {
+        lib->optimize = thread_create(&lib->optimizer, optimizer_main, lib);
+        if(!lib->optimize)
+            log_error("pipeline library: failed to start the optimizer thread, links stay unoptimized");
+    }
+}
+
+void pipeline_library_cache_destroy(PipelineLibraryCache* lib)
+{
+    if(lib->optimize)
+    {
+        mutex_lock(&lib->lock);
+        lib->shutdown = true;
+        condvar_broadcast(&lib->work);
+        mutex_unlock(&lib->lock);
+
+        thread_join(&lib->optimizer);
+    }
+
+    for(int i = 0; i < arrlen(lib->links); i++)
+    {
+        if(lib->links[i]->optimized != VK_NULL_HANDLE)
+            vkDestroyPipeline(lib->device, lib->links[i]->optimized, NULL);
+        free(lib->links[i]);
+    }
+
+    for(int i = 0; i < arrlen(lib->parts); i++)
+    {
+        vkDestroyPipeline(lib->device, lib->parts[i]->library, NULL);
+        free(lib->parts[i]);
+    }
+
+    arrfree(lib->links);
+    arrfree(lib->parts);
+    hash_index_destroy(&lib->link_index);
+    hash_index_destroy(&lib->part_index);
+    condvar_destroy(&lib->work);
+    mutex_destroy(&lib->lock);
+}
+
+VkPipeline pipeline_library_link(PipelineLibraryCache*         lib,
+                                 const void*                   vert_code,
+                                 size_t                        vert_size,
+                                 const void*                   frag_code,
+                                 size_t                        frag_size,
+                                 const Hash64*                 hashes,
+                                 const GraphicsPipelineConfig* cfg,
+                                 VkPipelineLayout              layout)
+{
+    const void*  codes[PIPELINE_LIBRARY_PART_COUNT] = {NULL, vert_code, frag_code, NULL};
+    const size_t sizes[PIPELINE_LIBRARY_PART_COUNT] = {0, vert_size, frag_size, 0};
+
+    Hash64 shader_hashes[PIPELINE_LIBRARY_PART_COUNT] = {0};
+    shader_hashes[1] = hashes ? hashes[0] : hash64_bytes(vert_code, vert_size);
+    shader_hashes[2] = hashes ? hashes[1] : hash64_bytes(frag_code, frag_size);
+
+    VkPipeline libraries[PIPELINE_LIBRARY_PART_COUNT];
+    for(uint32_t part = 0; part < PIPELINE_LIBRARY_PART_COUNT; part++)
+    {
+        PipelineLibraryPartKey key;
+        make_part_key(&key, (PipelineLibraryPart)part, cfg, layout, shader_hashes[part]);
+        libraries[part] = get_part(lib, &key, cfg, codes[part], sizes[part]);
+    }
+
+    uint64_t   start    = time_now_ns();
+    VkPipeline pipeline = link_libraries(lib, libraries, layout, cfg->pipeline_flags);
+    uint64_t   elapsed  = time_now_ns() - start;
+
+    PipelineLibraryLink* link = calloc(1, sizeof(PipelineLibraryLink));
+    link->fast                = pipeline;
+    link->layout              = layout;
+    link->flags               = cfg->pipeline_flags;
+    memcpy(link->libraries, libraries, sizeof(libraries));
+
+    mutex_lock(&lib->lock);
+
+    lib->stats.links++;
+    lib->stats.link_ns += elapsed;
+    lib->stats.max_link_ns = MAX(lib->stats.max_link_ns, elapsed);
+
+    arrpush(lib->links, link);
+    hash_index_insert(&lib->link_index, hash_handle(pipeline), link);
+
+    if(lib->optimize)
+        condvar_signal(&lib->work);
+
+    mutex_unlock(&lib->lock);
+
+    return pipeline;
+}
+
+VkPipeline pipeline_library_resolve(const PipelineLibraryCache* lib, VkPipeline pipeline)
+{
+    PipelineLibraryLink* link = hash_index_find(&lib->link_index, hash_handle(pipeline), link_matches, &pipeline);
+    if(!link)
+        return pipeline;
+
+    VkPipeline optimized = ATOMIC_LOAD_ACQUIRE(&link->optimized);
+    return optimized != VK_NULL_HANDLE ? optimized : pipeline;
+}
+
+void pipeline_library_get_stats(PipelineLibraryCache* lib, PipelineLibraryStats* out)
+{
+    mutex_lock(&lib->lock);
+    out->part_misses = lib->stats.part_misses;
+    out->part_ns     = lib->stats.part_ns;
+    out->links       = lib->stats.links;
+    out->link_ns     = lib->stats.link_ns;
+    out->max_link_ns = lib->stats.max_link_ns;
+    out->optimized   = lib->stats.optimized;
+    out->optimize_ns = lib->stats.optimize_ns;
+    mutex_unlock(&lib->lock);
+
+    out->part_hits = ATOMIC_LOAD_RELAXED(&lib->stats.part_hits);
+}
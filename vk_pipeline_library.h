@@ -0,0 +1,129 @@
+#ifndef VK_PIPELINE_LIBRARY_H_
+#define VK_PIPELINE_LIBRARY_H_
+
+#include "vk_defaults.h"
+#include "vk_pipelines.h"
+
+/* ------------------ Graphics pipeline library fast-link ------------------ */
+//
+// Splits graphics pipelines into the four VK_EXT_graphics_pipeline_library
+// parts. Each part is cached on its own key:
+//   vertex input      vertex bindings/attributes, topology
+//   pre-rasterization vertex shader, layout, raster state
+//   fragment shader   fragment shader, layout, depth state
+//   fragment output   color/depth/stencil formats
+// State marked dynamic in cfg.dynamic_state is left out of the part keys.
+// Permutations share the parts they have in common, and a new permutation
+// is a cheap link of four existing libraries instead of a full compile.
+//
+// A fast-linked pipeline can run slower than a monolithic one. Every link
+// is queued for a link-time optimized relink on a background thread.
+// pipeline_library_resolve swaps the optimized pipeline in once it exists.
+//
+//   cfg.libraries = &libs;  // create_graphics_pipeline now fast-links
+//   VkPipeline p = create_graphics_pipeline(..., &cfg, &layout);
+//   ...at bind time...
+//   vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_library_resolve(&libs, p));
+//
+// Requires VK_EXT_graphics_pipeline_library and VK_KHR_pipeline_library
+// with the graphicsPipelineLibrary feature enabled.
+//
+// Parts and optimized pipelines belong to the cache. Fast-linked pipelines
+// follow the create_graphics_pipeline rules. If the caller owns them, it
+// must keep them alive while it still resolves through the cache, because
+// a recycled handle would resolve to a stale optimized pipeline.
+
+#define PIPELINE_LIBRARY_PART_COUNT 4
+#define PIPELINE_LIBRARY_STATE_WORDS 13
+
+typedef enum PipelineLibraryPart
+{
+    PIPELINE_LIBRARY_VERTEX_INPUT,
+    PIPELINE_LIBRARY_PRE_RASTERIZATION,
+    PIPELINE_LIBRARY_FRAGMENT_SHADER,
+    PIPELINE_LIBRARY_FRAGMENT_OUTPUT,
+} PipelineLibraryPart;
+
+typedef struct PipelineLibraryPartKey
+{
+    Hash64           hash;
+    Hash64           content_hash;  // shader SPIR-V, or the vertex input arrays
+    VkPipelineLayout layout;        // VK_NULL_HANDLE for parts without shaders
+    uint32_t         part;
+    uint32_t         state[PIPELINE_LIBRARY_STATE_WORDS];  // flags, dynamic bits, the part's static config, zero padded
+} PipelineLibraryPartKey;
+
+typedef struct PipelineLibraryPartEntry
+{
+    PipelineLibraryPartKey key;
+    VkPipeline             library;
+} PipelineLibraryPartEntry;
+
+// one per fast link, maps the handle callers hold to its optimized twin
+typedef struct PipelineLibraryLink
+{
+    VkPipeline            fast;
+    VkPipeline            optimized;  // published with release, VK_NULL_HANDLE until the relink finished
+    VkPipeline            libraries[PIPELINE_LIBRARY_PART_COUNT];
+    VkPipelineLayout      layout;
+    VkPipelineCreateFlags flags;
+} PipelineLibraryLink;
+
+typedef struct PipelineLibraryStats
+{
+    uint64_t part_hits;
+    uint64_t part_misses;
+    uint64_t part_ns;  // time spent compiling parts
+    uint64_t links;
+    uint64_t link_ns;  // time spent in fast links
+    uint64_t max_link_ns;
+    uint64_t optimized;    // background relinks finished
+    uint64_t optimize_ns;  // time spent in optimized relinks
+} PipelineLibraryStats;
+
+typedef struct PipelineLibraryCache
+{
+    VkDevice        device;
+    VkPipelineCache cache;
+
+    PipelineLibraryPartEntry** parts;  // stretchy buffer of heap allocated entries
+    HashIndex                  part_index;
+
+    PipelineLibraryLink** links;       // stretchy buffer of heap allocated links
+    HashIndex             link_index;  // fast pipeline handle -> link
+
+    // background relink queue, links from optimize_head on are pending
+    bool     optimize;
+    bool     shutdown;
+    uint32_t optimize_head;
+    Thread   optimizer;
+    CondVar  work;
+
+    Mutex                lock;  // guards everything above and stats other than part_hits
+    PipelineLibraryStats stats;
+} PipelineLibraryCache;
+
+bool pipeline_library_supported(VkPhysicalDevice physical_device);
+
+// optimize starts a background thread for link-time optimized relinks
+void pipeline_library_cache_init(PipelineLibraryCache* lib, VkDevice device, VkPipelineCache cache, bool optimize);
+void pipeline_library_cache_destroy(PipelineLibraryCache* lib);
+
+// fast-links a graphics pipeline out of cached parts, building missing ones.
+// cfg must already carry the reflected vertex input. hashes are the XXH64 of
+// vert and frag code, computed here when NULL.
+VkPipeline pipeline_library_link(PipelineLibraryCache*         lib,
+                                 const void*                   vert_code,
+                                 size_t                        vert_size,
+                                 const void*                   frag_code,
+                                 size_t                        frag_size,
+                                 const Hash64*                 hashes,
+                                 const GraphicsPipelineConfig* cfg,
+                                 VkPipelineLayout              layout);
+
+// the optimized relink of pipeline if it is ready, pipeline itself otherwise; lock-free
+VkPipeline pipeline_library_resolve(const PipelineLibraryCache* lib, VkPipeline pipeline);
+
+void pipeline_library_get_stats(PipelineLibraryCache* lib, PipelineLibraryStats* out);
+
+#endif // VK_PIPELINE_LIBRARY_H_
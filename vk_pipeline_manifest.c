@@ -0,0 +1,402 @@
+#include "vk_pipeline_manifest.h"
+#include "vk_pipeline_batch.h"
+
+#include <stddef.h>
+
+// the hash covers everything but the names, which follow from the shader hashes
+static Hash64 hash_manifest_entry(const PipelineManifestEntry* e)
+{
+    const uint8_t* begin = (const uint8_t*)e + offsetof(PipelineManifestEntry, shader_hashes);
+    const uint8_t* end   = (const uint8_t*)e + offsetof(PipelineManifestEntry, names);
+    return hash64_bytes(begin, (size_t)(end - begin));
+}
+
+static bool manifest_entry_matches(const void* value, const void* key)
+{
+    const PipelineManifestEntry* a = value;
+    const PipelineManifestEntry* b = key;
+
+    return a->hash == b->hash && a->source == b->source && memcmp(a->shader_hashes, b->shader_hashes, sizeof(a->shader_hashes)) == 0
+           && memcmp(&a->state, &b->state, sizeof(a->state)) == 0;
+}
+
+static bool copy_name(char* dst, const char* src)
+{
+    size_t length = src ? strlen(src) : 0;
+    if(length >= PIPELINE_MANIFEST_NAME_MAX)
+        return false;
+
+    memcpy(dst, src ? src : "", length + 1);
+    return true;
+}
+
+static bool entry_names_valid(const PipelineManifestEntry* e)
+{
+    return memchr(e->names[0], 0, PIPELINE_MANIFEST_NAME_MAX) && memchr(e->names[1], 0, PIPELINE_MANIFEST_NAME_MAX);
+}
+
+// caller holds the lock or owns the manifest
+static void add_entry(PipelineManifest* manifest, PipelineManifestEntry* entry)
+{
+    arrpush(manifest->entries, entry);
+    hash_index_insert(&manifest->index, entry->hash, entry);
+}
+
+void pipeline_manifest_init(PipelineManifest* manifest)
+{
+    memset(manifest, 0, sizeof(*manifest));
+    hash_index_init(&manifest->index, 0);
+    mutex_init(&manifest->lock);
+}
+
+void pipeline_manifest_destroy(PipelineManifest* manifest)
+{
+    for(int i = 0; i < arrlen(manifest->entries); i++)
+        free(manifest->entries[i]);
+
+    arrfree(manifest->entries);
+    hash_index_destroy(&manifest->index);
+    mutex_destroy(&manifest->lock);
+}
+
+bool pipeline_manifest_load(PipelineManifest* manifest, const char* path)
+{
+    pipeline_manifest_init(manifest);
+
+    MappedFile file;
+    if(!mapped_file_open(&file, path, true))
+        return false;
+
+    const PipelineManifestHeader* header = (const PipelineManifestHeader*)file.data;
+    if(file.size < sizeof(*header) || header->magic != PIPELINE_MANIFEST_MAGIC || header->version != PIPELINE_MANIFEST_VERSION
+       || header->entry_size != sizeof(PipelineManifestEntry)
+       || (file.size - sizeof(*header)) / sizeof(PipelineManifestEntry) < header->entry_count)
+    {
+        log_info("Pipeline manifest %s is stale or malformed, starting empty", path);
+        mapped_file_close(&file);
+        return false;
+    }
+
+    const PipelineManifestEntry* entries = (const PipelineManifestEntry*)(file.data + sizeof(*header));
+    for(uint32_t i = 0; i < header->entry_count; i++)
+    {
+        PipelineManifestEntry* entry = malloc(sizeof(PipelineManifestEntry));
+        memcpy(entry, &entries[i], sizeof(PipelineManifestEntry));
+
+        if(!entry_names_valid(entry) || entry->hash != hash_manifest_entry(entry)
+           || hash_index_find(&manifest->index, entry->hash, manifest_entry_matches, entry))
+        {
+            free(entry);
+            continue;
+        }
+
+        add_entry(manifest, entry);
+    }
+
+    mapped_file_close(&file);
+    return true;
+}
+
+// what a recorded shader file holds now, read once per save however many entries share it
+typedef struct ShaderFileState
+{
+    const char* path;
+    bool        present;
+    Hash64      code_hash;
+} ShaderFileState;
+
+typedef struct ShaderFileStates
+{
+    ShaderFileState* states;  // room for two per entry
+    uint32_t         count;
+    HashIndex        index;  // path hash -> state
+} ShaderFileStates;
+
+static bool file_state_matches(const void* value, const void* key)
+{
+    return strcmp(((const ShaderFileState*)value)->path, key) == 0;
+}
+
+static const ShaderFileState* shader_file_state(ShaderFileStates* files, const char* path)
+{
+    Hash64           path_hash = hash64_bytes(path, strlen(path));
+    ShaderFileState* state     = hash_index_find(&files->index, path_hash, file_state_matches, path);
+    if(state)
+        return state;
+
+    state       = &files->states[files->count++];
+    state->path = path;
+
+    MappedFile file;
+    state->present   = mapped_file_open(&file, path, true);
+    state->code_hash = state->present ? hash64_bytes(file.data, file.size) : 0;
+    mapped_file_close(&file);
+
+    hash_index_insert(&files->index, path_hash, state);
+    return state;
+}
+
+// FILES entries whose shader was deleted or rebuilt would be recompiled by
+// every warmup under their new hash and never match again, so they are dropped
+static bool entry_files_current(ShaderFileStates* files, const PipelineManifestEntry* e)
+{
+    if(e->source != PIPELINE_SOURCE_FILES)
+        return true;
+
+    uint32_t stage_count = e->state.kind == PIPELINE_OBJECT_COMPUTE ? 1 : 2;
+    for(uint32_t i = 0; i < stage_count; i++)
+    {
+        const ShaderFileState* state = shader_file_state(files, e->names[i]);
+        if(!state->present || state->code_hash != e->shader_hashes[i])
+            return false;
+    }
+
+    return true;
+}
+
+bool pipeline_manifest_save(PipelineManifest* manifest, const char* path)
+{
+    mutex_lock(&manifest->lock);
+
+    if(!manifest->dirty)
+    {
+        mutex_unlock(&manifest->lock);
+        return true;
+    }
+
+    uint32_t               count   = (uint32_t)arrlen(manifest->entries);
+    PipelineManifestEntry* entries = malloc(MAX(count, 1u) * sizeof(PipelineManifestEntry));
+    for(uint32_t i = 0; i < count; i++)
+        entries[i] = *manifest->entries[i];
+
+    manifest->dirty = false;
+    mutex_unlock(&manifest->lock);
+
+    ShaderFileStates files = {.states = malloc(MAX(count, 1u) * 2 * sizeof(ShaderFileState))};
+    hash_index_init(&files.index, 0);
+
+    uint32_t kept = 0;
+    for(uint32_t i = 0; i < count; i++)
+    {
+        if(entry_files_current(&files, &entries[i]))
+            entries[kept++] = entries[i];
+    }
+
+    hash_index_destroy(&files.index);
+    free(files.states);
+
+    if(kept < count)
+        log_info("Pipeline manifest: dropped %u entries whose shader files changed", count - kept);
+    count = kept;
+
+    PipelineManifestHeader header = {
+        .magic       = PIPELINE_MANIFEST_MAGIC,
+        .version     = PIPELINE_MANIFEST_VERSION,
+        .entry_count = count,
+        .entry_size  = sizeof(PipelineManifestEntry),
+    };
+
+    const void* parts[2]      = {&header, entries};
+    size_t      part_sizes[2] = {sizeof(header), count * sizeof(PipelineManifestEntry)};
+    bool        ok            = write_file_atomic(path, parts, part_sizes, 2);
+
+    free(entries);
+
+    if(!ok)
+    {
+        // try again on the next save
+        mutex_lock(&manifest->lock);
+        manifest->dirty = true;
+        mutex_unlock(&manifest->lock);
+    }
+
+    return ok;
+}
+
+void pipeline_manifest_record(PipelineManifest*       manifest,
+                              const PipelineStateKey* state,
+                              Hash64                  hash0,
+                              Hash64                  hash1,
+                              PipelineManifestSource  source,
+                              const char*             name0,
+                              const char*             name1)
+{
+    PipelineManifestEntry key;
+    memset(&key, 0, sizeof(key));
+    key.shader_hashes[0] = hash0;
+    key.shader_hashes[1] = hash1;
+    key.state            = *state;
+    key.source           = source;
+    key.hash             = hash_manifest_entry(&key);
+
+    if(hash_index_find(&manifest->index, key.hash, manifest_entry_matches, &key))
+        return;
+
+    if(!copy_name(key.names[0], name0) || !copy_name(key.names[1], name1))
+    {
+        log_error("Pipeline manifest: shader name too long, '%s' not recorded", name0);
+        return;
+    }
+
+    mutex_lock(&manifest->lock);
+
+    if(!hash_index_find(&manifest->index, key.hash, manifest_entry_matches, &key))
+    {
+        PipelineManifestEntry* entry = malloc(sizeof(PipelineManifestEntry));
+        *entry                       = key;
+
+        add_entry(manifest, entry);
+        manifest->dirty = true;
+    }
+
+    mutex_unlock(&manifest->lock);
+}
+
+// the recorded state is canonical, feeding it back yields the same key
+static GraphicsPipelineConfig config_from_state(const PipelineStateKey* state)
+{
+    GraphicsPipelineConfig cfg = graphics_pipeline_config_default();
+
+    cfg.cull_mode              = state->cull_mode;
+    cfg.front_face             = state->front_face;
+    cfg.polygon_mode           = state->polygon_mode;
+    cfg.topology               = state->topology;
+    cfg.depth_test_enable      = state->depth_test_enable;
+    cfg.depth_write_enable     = state->depth_write_enable;
+    cfg.color_attachment_count = state->color_attachment_count;
+    cfg.color_formats          = state->color_formats;
+    cfg.depth_format           = state->depth_format;
+    cfg.stencil_format         = state->stencil_format;
+    cfg.pipeline_flags         = state->flags;
+    cfg.dynamic_state          = state->dynamic_state;
+
+    return cfg;
+}
+
+// the resolved constants by ID, NULL when the entry has none
+static const PipelineSpecialization* specialization_from_state(const PipelineStateKey* state,
+                                                               PipelineSpecialization* spec,
+                                                               PipelineSpecConstant*   constants)
+{
+    if(state->spec_count == 0)
+        return NULL;
+
+    for(uint32_t i = 0; i < state->spec_count; i++)
+        constants[i] = (PipelineSpecConstant){.constant_id = state->spec_ids[i], .value = state->spec_values[i]};
+
+    *spec = (PipelineSpecialization){.constants = constants, .count = state->spec_count};
+    return spec;
+}
+
+// false if the entry can no longer be rebuilt as recorded
+static bool entry_current(const PipelineManifestEntry* e, const ShaderArchive* archive)
+{
+    if(e->source == PIPELINE_SOURCE_FILES)
+        return true;
+    if(!archive)
+        return false;
+
+    uint32_t stage_count = e->state.kind == PIPELINE_OBJECT_COMPUTE ? 1 : 2;
+    for(uint32_t i = 0; i < stage_count; i++)
+    {
+        const ShaderArchiveEntry* shader = shader_archive_find(archive, e->names[i]);
+        if(!shader || shader->code_hash != e->shader_hashes[i])
+            return false;
+    }
+
+    return true;
+}
+
+uint32_t pipeline_warmup_from_manifest(PipelineManifest*      manifest,
+                                       VkDevice               device,
+                                       VkPipelineCache        cache,
+                                       PipelineCacheSaver*    saver,
+                                       DescriptorLayoutCache* desc_cache,
+                                       PipelineLayoutCache*   pipe_cache,
+                                       PipelineObjectCache*   obj_cache,
+                                       const ShaderArchive*   archive,
+                                       uint32_t               worker_count,
+                                       PipelineWarmupStats*   out_stats)
+{
+    uint64_t start = time_now_ns();
+
+    // snapshot, recording from other threads may grow the manifest meanwhile
+    mutex_lock(&manifest->lock);
+    uint32_t               count   = (uint32_t)arrlen(manifest->entries);
+    PipelineManifestEntry* entries = malloc(MAX(count, 1u) * sizeof(PipelineManifestEntry));
+    for(uint32_t i = 0; i < count; i++)
+        entries[i] = *manifest->entries[i];
+    mutex_unlock(&manifest->lock);
+
+    PipelineBatchDesc*      descs   = calloc(MAX(count, 1u), sizeof(PipelineBatchDesc));
+    GraphicsPipelineConfig* configs = calloc(MAX(count, 1u), sizeof(GraphicsPipelineConfig));
+    PipelineSpecialization* specs   = calloc(MAX(count, 1u), sizeof(PipelineSpecialization));
+    PipelineSpecConstant*   consts  = calloc(MAX(count, 1u) * PIPELINE_SPEC_MAX_CONSTANTS, sizeof(PipelineSpecConstant));
+
+    PipelineWarmupStats stats = {.entries = count};
+
+    uint32_t desc_count = 0;
+    for(uint32_t i = 0; i < count; i++)
+    {
+        const PipelineManifestEntry* e = &entries[i];
+        if(!entry_current(e, archive))
+        {
+            stats.skipped++;
+            continue;
+        }
+
+        PipelineBatchDesc* d = &descs[desc_count];
+        d->kind              = e->state.kind;
+        d->archive           = e->source == PIPELINE_SOURCE_ARCHIVE ? archive : NULL;
+
+        const PipelineSpecialization* spec =
+            specialization_from_state(&e->state, &specs[desc_count], &consts[desc_count * PIPELINE_SPEC_MAX_CONSTANTS]);
+
+        if(e->state.kind == PIPELINE_OBJECT_COMPUTE)
+        {
+            d->comp_path      = e->names[0];
+            d->specialization = spec;
+        }
+        else
+        {
+            configs[desc_count]                = config_from_state(&e->state);
+            configs[desc_count].specialization = spec;
+            d->vert_path                       = e->names[0];
+            d->frag_path                       = e->names[1];
+            d->config                          = &configs[desc_count];
+        }
+
+        desc_count++;
+    }
+
+    PipelineObjectCacheStats before;
+    pipeline_object_cache_get_stats(obj_cache, &before);
+
+    PipelineBatchResult* results = calloc(MAX(desc_count, 1u), sizeof(PipelineBatchResult));
+    uint32_t built = pipeline_batch_compile(device, cache, saver, desc_cache, pipe_cache, obj_cache, descs, desc_count, worker_count, results, NULL);
+
+    PipelineObjectCacheStats after;
+    pipeline_object_cache_get_stats(obj_cache, &after);
+
+    // pipelines built elsewhere during the warmup may blur these slightly
+    stats.created           = (uint32_t)MIN(after.misses - before.misses, (uint64_t)built);
+    stats.already_cached    = built - stats.created;
+    stats.driver_cache_hits = (uint32_t)MIN(after.driver_cache_hits - before.driver_cache_hits, (uint64_t)stats.created);
+    stats.failed            = desc_count - built;
+    stats.wall_ns           = time_now_ns() - start;
+
+    log_info("Pipeline warmup: %u of %u pipelines ready (%u compiled, %u from the driver cache, %u skipped, %u failed) in %.2f ms",
+             built, count, stats.created, stats.driver_cache_hits, stats.skipped, stats.failed, (double)stats.wall_ns / 1e6);
+
+    free(results);
+    free(consts);
+    free(specs);
+    free(configs);
+    free(descs);
+    free(entries);
+
+    if(out_stats)
+        *out_stats = stats;
+
+    return built;
+}
@@ -0,0 +1,119 @@
+#ifndef VK_PIPELINE_MANIFEST_H_
+#define VK_PIPELINE_MANIFEST_H_
+
+#include "vk_defaults.h"
+#include "vk_hashmap.h"
+#include "vk_pipeline_cache.h"
+#include "vk_pipelines.h"
+#include "vk_shader_archive.h"
+#include "vk_thread.h"
+
+/* ------------------ Pipeline manifest and warmup ------------------ */
+//
+// Records every pipeline the object cache creates as shader names, shader
+// hashes and the canonical PipelineStateKey. On the next run
+// pipeline_warmup_from_manifest rebuilds all of them in parallel before
+// the first frame, so nothing compiles mid-frame. The pipeline layout is
+// not stored. It is rebuilt from the reflected shaders, and the shader
+// hashes pin those down.
+//
+//   PipelineManifest manifest;
+//   pipeline_manifest_load(&manifest, "pipelines.manifest");  // empty manifest if missing
+//   obj_cache.manifest = &manifest;
+//
+//   PipelineWarmupStats warm;
+//   pipeline_warmup_from_manifest(&manifest, device, cache, &saver, &desc_cache, &pipe_cache, &obj_cache, &archive, 0, &warm);
+//   ...run...
+//   pipeline_manifest_save(&manifest, "pipelines.manifest");
+//   pipeline_manifest_destroy(&manifest);
+//
+// Pipelines made from raw SPIR-V (create_*_from_spirv) have no name to
+// reload from and are not recorded. Config fields outside the state key
+// (libraries) are not recorded either, so warmup builds monolithic
+// pipelines. Specialization constants are replayed by their resolved
+// IDs. Bump PIPELINE_MANIFEST_VERSION whenever PipelineStateKey changes.
+//
+// Saving drops file entries whose shader file is gone or no longer hashes
+// to what was recorded. The rebuilt shader is recorded afresh by the next
+// create, so the manifest does not grow with every shader edit. Archive
+// entries are checked against the archive at warmup instead.
+
+#define PIPELINE_MANIFEST_MAGIC 0x4D504B56u  // "VKPM"
+#define PIPELINE_MANIFEST_VERSION 2
+#define PIPELINE_MANIFEST_NAME_MAX 128
+
+typedef enum PipelineManifestSource
+{
+    PIPELINE_SOURCE_FILES,    // names are shader file paths
+    PIPELINE_SOURCE_ARCHIVE,  // names are shader archive names
+} PipelineManifestSource;
+
+typedef struct PipelineManifestHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entry_count;
+    uint32_t entry_size;  // sizeof(PipelineManifestEntry), catches layout changes a version bump missed
+} PipelineManifestHeader;
+
+typedef struct PipelineManifestEntry
+{
+    Hash64           hash;              // of state, shader_hashes and source
+    Hash64           shader_hashes[2];  // vertex and fragment, or compute and 0
+    PipelineStateKey state;
+    uint32_t         source;  // PipelineManifestSource
+    char             names[2][PIPELINE_MANIFEST_NAME_MAX];
+} PipelineManifestEntry;
+
+typedef struct PipelineManifest
+{
+    PipelineManifestEntry** entries;  // stretchy buffer of heap allocated entries
+    HashIndex               index;    // entry hash -> entry
+    Mutex                   lock;     // guards entries, inserts into index and dirty
+    bool                    dirty;    // recorded something since load
+} PipelineManifest;
+
+typedef struct PipelineWarmupStats
+{
+    uint32_t entries;            // pipelines in the manifest
+    uint32_t created;            // compiled by the warmup
+    uint32_t already_cached;     // the object cache had them already
+    uint32_t driver_cache_hits;  // of created, served from the VkPipelineCache
+    uint32_t skipped;            // shader missing or changed since it was recorded
+    uint32_t failed;
+    uint64_t wall_ns;
+} PipelineWarmupStats;
+
+void pipeline_manifest_init(PipelineManifest* manifest);
+void pipeline_manifest_destroy(PipelineManifest* manifest);
+
+// initializes manifest from path; false and an empty manifest if path is missing or stale
+bool pipeline_manifest_load(PipelineManifest* manifest, const char* path);
+// writes the file back if anything new was recorded, minus stale file entries
+bool pipeline_manifest_save(PipelineManifest* manifest, const char* path);
+
+// called by the create functions, duplicates are ignored; name1 is NULL for compute
+void pipeline_manifest_record(PipelineManifest*       manifest,
+                              const PipelineStateKey* state,
+                              Hash64                  hash0,
+                              Hash64                  hash1,
+                              PipelineManifestSource  source,
+                              const char*             name0,
+                              const char*             name1);
+
+// Rebuilds every recorded pipeline through obj_cache (required) with
+// pipeline_batch_compile, saver as there. Archive entries need archive, entries whose
+// archive hash no longer matches are skipped. Returns the number of
+// pipelines now in obj_cache for the manifest.
+uint32_t pipeline_warmup_from_manifest(PipelineManifest*      manifest,
+                                       VkDevice               device,
+                                       VkPipelineCache        cache,
+                                       PipelineCacheSaver*    saver,
+                                       DescriptorLayoutCache* desc_cache,
+                                       PipelineLayoutCache*   pipe_cache,
+                                       PipelineObjectCache*   obj_cache,
+                                       const ShaderArchive*   archive,
+                                       uint32_t               worker_count,
+                                       PipelineWarmupStats*   out_stats);
+
+#endif // VK_PIPELINE_MANIFEST_H_
@@ -0,0 +1,299 @@
+#include "vk_pipeline_stats.h"
+#include "vk_pipelines.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+
+static PipelineStatsTable* installed_table;
+
+void pipeline_feedback_init(PipelineFeedback* feedback, uint32_t stage_count)
+{
+    assert(stage_count <= PIPELINE_STATS_MAX_STAGES);
+
+    memset(feedback, 0, sizeof(*feedback));
+    feedback->info = (VkPipelineCreationFeedbackCreateInfo){
+        .sType                              = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO,
+        .pPipelineCreationFeedback          = &feedback->pipeline,
+        .pipelineStageCreationFeedbackCount = stage_count,
+        .pPipelineStageCreationFeedbacks    = feedback->stages,
+    };
+}
+
+static bool feedback_hit(const VkPipelineCreationFeedback* feedback)
+{
+    const VkPipelineCreationFeedbackFlags hit =
+        VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT | VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT;
+    return (feedback->flags & hit) == hit;
+}
+
+bool pipeline_feedback_cache_hit(const PipelineFeedback* feedback)
+{
+    return feedback_hit(&feedback->pipeline);
+}
+
+void pipeline_stats_init(PipelineStatsTable* table)
+{
+    memset(table, 0, sizeof(*table));
+    mutex_init(&table->lock);
+}
+
+void pipeline_stats_destroy(PipelineStatsTable* table)
+{
+    if(pipeline_stats_installed() == table)
+        pipeline_stats_install(NULL);
+
+    arrfree(table->records);
+    mutex_destroy(&table->lock);
+}
+
+void pipeline_stats_install(PipelineStatsTable* table)
+{
+    ATOMIC_STORE_RELEASE(&installed_table, table);
+}
+
+PipelineStatsTable* pipeline_stats_installed(void)
+{
+    return ATOMIC_LOAD_ACQUIRE(&installed_table);
+}
+
+void pipeline_stats_add(PipelineStatsTable* table, const PipelineStatsRecord* record, const PipelineFeedback* feedback)
+{
+    PipelineStatsRecord r = *record;
+
+    if(feedback && (feedback->pipeline.flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT))
+    {
+        r.feedback_valid = true;
+        r.cache_hit      = feedback_hit(&feedback->pipeline);
+        r.driver_ns      = feedback->pipeline.duration;
+
+        for(uint32_t i = 0; i < r.stage_count; i++)
+        {
+            const VkPipelineCreationFeedback* stage = &feedback->stages[i];
+            if(!(stage->flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT))
+                continue;
+
+            r.stage_ns[i]        = stage->duration;
+            r.stage_cache_hit[i] = feedback_hit(stage);
+        }
+    }
+
+    mutex_lock(&table->lock);
+    arrpush(table->records, r);
+    mutex_unlock(&table->lock);
+}
+
+// copy of the records so queries do not hold the lock while sorting or writing
+static PipelineStatsRecord* snapshot(PipelineStatsTable* table, uint32_t* out_count)
+{
+    mutex_lock(&table->lock);
+
+    uint32_t             count   = (uint32_t)arrlen(table->records);
+    PipelineStatsRecord* records = malloc(MAX(count, 1u) * sizeof(PipelineStatsRecord));
+    if(count)
+        memcpy(records, table->records, count * sizeof(PipelineStatsRecord));
+
+    mutex_unlock(&table->lock);
+
+    *out_count = count;
+    return records;
+}
+
+void pipeline_stats_summary(PipelineStatsTable* table, PipelineStatsSummary* out)
+{
+    memset(out, 0, sizeof(*out));
+
+    mutex_lock(&table->lock);
+
+    for(int i = 0; i < arrlen(table->records); i++)
+    {
+        const PipelineStatsRecord* r = &table->records[i];
+
+        out->count++;
+        out->feedback_count += r->feedback_valid;
+        out->cache_hits += r->cache_hit;
+        out->total_create_ns += r->create_ns;
+        out->total_driver_ns += r->driver_ns;
+        out->max_create_ns = MAX(out->max_create_ns, r->create_ns);
+    }
+
+    mutex_unlock(&table->lock);
+
+    out->hit_ratio = out->feedback_count ? (float)out->cache_hits / (float)out->feedback_count : 0.0f;
+}
+
+static int compare_slowest(const void* a, const void* b)
+{
+    uint64_t ta = ((const PipelineStatsRecord*)a)->create_ns;
+    uint64_t tb = ((const PipelineStatsRecord*)b)->create_ns;
+    return (ta < tb) - (ta > tb);
+}
+
+uint32_t pipeline_stats_worst(PipelineStatsTable* table, PipelineStatsRecord* out, uint32_t max_count)
+{
+    uint32_t             count   = 0;
+    PipelineStatsRecord* records = snapshot(table, &count);
+
+    qsort(records, count, sizeof(PipelineStatsRecord), compare_slowest);
+
+    uint32_t n = MIN(count, max_count);
+    if(n)
+        memcpy(out, records, n * sizeof(PipelineStatsRecord));
+
+    free(records);
+    return n;
+}
+
+static const char* kind_name(uint32_t kind)
+{
+    return kind == PIPELINE_OBJECT_COMPUTE ? "compute" : "graphics";
+}
+
+static const char* stage_name(VkShaderStageFlagBits stage)
+{
+    switch(stage)
+    {
+        case VK_SHADER_STAGE_VERTEX_BIT:
+            return "vert";
+        case VK_SHADER_STAGE_FRAGMENT_BIT:
+            return "frag";
+        case VK_SHADER_STAGE_COMPUTE_BIT:
+            return "comp";
+        default:
+            return "other";
+    }
+}
+
+static double to_ms(uint64_t ns)
+{
+    return (double)ns / 1e6;
+}
+
+static FILE* open_output(const char* path)
+{
+    FILE* f = fopen(path, "w");
+    if(!f)
+        log_error("Failed to open '%s' (errno=%d)", path, errno);
+    return f;
+}
+
+static bool close_output(FILE* f, const char* path)
+{
+    bool ok = !ferror(f);
+    ok      = fclose(f) == 0 && ok;
+    if(!ok)
+        log_error("Failed to write '%s'", path);
+    return ok;
+}
+
+// CSV fields are quoted, embedded quotes doubled
+static void write_csv_string(FILE* f, const char* s)
+{
+    fputc('"', f);
+    for(; *s; s++)
+    {
+        if(*s == '"')
+            fputc('"', f);
+        fputc(*s, f);
+    }
+    fputc('"', f);
+}
+
+bool pipeline_stats_write_csv(PipelineStatsTable* table, const char* path)
+{
+    FILE* f = open_output(path);
+    if(!f)
+        return false;
+
+    uint32_t             count   = 0;
+    PipelineStatsRecord* records = snapshot(table, &count);
+
+    fprintf(f, "kind,name0,name1,hash0,hash1,create_ms,driver_ms,feedback_valid,cache_hit");
+    for(uint32_t s = 0; s < PIPELINE_STATS_MAX_STAGES; s++)
+        fprintf(f, ",stage%u,stage%u_ms,stage%u_cache_hit", s, s, s);
+    fputc('\n', f);
+
+    for(uint32_t i = 0; i < count; i++)
+    {
+        const PipelineStatsRecord* r = &records[i];
+
+        fprintf(f, "%s,", kind_name(r->kind));
+        write_csv_string(f, r->names[0]);
+        fputc(',', f);
+        write_csv_string(f, r->names[1]);
+        fprintf(f, ",%016" PRIx64 ",%016" PRIx64 ",%.3f,%.3f,%d,%d", r->shader_hashes[0], r->shader_hashes[1], to_ms(r->create_ns),
+                to_ms(r->driver_ns), r->feedback_valid, r->cache_hit);
+
+        for(uint32_t s = 0; s < PIPELINE_STATS_MAX_STAGES; s++)
+        {
+            if(s < r->stage_count)
+                fprintf(f, ",%s,%.3f,%d", stage_name(r->stages[s]), to_ms(r->stage_ns[s]), r->stage_cache_hit[s]);
+            else
+                fprintf(f, ",,,");
+        }
+        fputc('\n', f);
+    }
+
+    free(records);
+    return close_output(f, path);
+}
+
+static void write_json_string(FILE* f, const char* s)
+{
+    fputc('"', f);
+    for(; *s; s++)
+    {
+        unsigned char c = (unsigned char)*s;
+        if(c == '"' || c == '\\')
+            fprintf(f, "\\%c", c);
+        else if(c < 0x20)
+            fprintf(f, "\\u%04x", c);
+        else
+            fputc(c, f);
+    }
+    fputc('"', f);
+}
+
+bool pipeline_stats_write_json(PipelineStatsTable* table, const char* path)
+{
+    FILE* f = open_output(path);
+    if(!f)
+        return false;
+
+    PipelineStatsSummary summary;
+    pipeline_stats_summary(table, &summary);
+
+    uint32_t             count   = 0;
+    PipelineStatsRecord* records = snapshot(table, &count);
+
+    fprintf(f, "{\n  \"summary\": {\"count\": %u, \"feedback_count\": %u, \"cache_hits\": %u, \"hit_ratio\": %.4f, ", summary.count,
+            summary.feedback_count, summary.cache_hits, summary.hit_ratio);
+    fprintf(f, "\"total_create_ms\": %.3f, \"total_driver_ms\": %.3f, \"max_create_ms\": %.3f},\n", to_ms(summary.total_create_ns),
+            to_ms(summary.total_driver_ns), to_ms(summary.max_create_ns));
+    fprintf(f, "  \"pipelines\": [");
+
+    for(uint32_t i = 0; i < count; i++)
+    {
+        const PipelineStatsRecord* r = &records[i];
+
+        fprintf(f, "%s\n    {\"kind\": \"%s\", \"names\": [", i ? "," : "", kind_name(r->kind));
+        write_json_string(f, r->names[0]);
+        fprintf(f, ", ");
+        write_json_string(f, r->names[1]);
+        fprintf(f, "], \"hashes\": [\"%016" PRIx64 "\", \"%016" PRIx64 "\"], ", r->shader_hashes[0], r->shader_hashes[1]);
+        fprintf(f, "\"create_ms\": %.3f, \"driver_ms\": %.3f, \"feedback_valid\": %s, \"cache_hit\": %s, \"stages\": [",
+                to_ms(r->create_ns), to_ms(r->driver_ns), r->feedback_valid ? "true" : "false", r->cache_hit ? "true" : "false");
+
+        for(uint32_t s = 0; s < r->stage_count; s++)
+        {
+            fprintf(f, "%s{\"stage\": \"%s\", \"ms\": %.3f, \"cache_hit\": %s}", s ? ", " : "", stage_name(r->stages[s]),
+                    to_ms(r->stage_ns[s]), r->stage_cache_hit[s] ? "true" : "false");
+        }
+        fprintf(f, "]}");
+    }
+
+    fprintf(f, "%s]\n}\n", count ? "\n  " : "");
+
+    free(records);
+    return close_output(f, path);
+}
@@ -0,0 +1,94 @@
+#ifndef VK_PIPELINE_STATS_H_
+#define VK_PIPELINE_STATS_H_
+
+#include "vk_defaults.h"
+#include "vk_thread.h"
+
+/* ------------------ Pipeline creation statistics ------------------ */
+//
+// Every vkCreate*Pipelines call made by vk_pipelines.c chains
+// VkPipelineCreationFeedbackCreateInfo (core in 1.3). With a table
+// installed, each creation lands in it with host time, driver time,
+// per-stage times and whether the driver served it from the
+// VkPipelineCache. Hits in the pipeline object cache create nothing and
+// are not recorded.
+//
+//   PipelineStatsTable stats;
+//   pipeline_stats_init(&stats);
+//   pipeline_stats_install(&stats);
+//   ...startup...
+//   PipelineStatsRecord worst[10];
+//   uint32_t n = pipeline_stats_worst(&stats, worst, 10);
+//   pipeline_stats_write_csv(&stats, "pipelines.csv");  // or _json for tooling
+//   pipeline_stats_install(NULL);
+//   pipeline_stats_destroy(&stats);
+//
+// Drivers may leave the feedback invalid, such records count towards the
+// totals but not towards the hit ratio.
+
+#define PIPELINE_STATS_MAX_STAGES 2
+#define PIPELINE_STATS_NAME_MAX 96
+
+// filled in by the create functions, chain info into the create info
+typedef struct PipelineFeedback
+{
+    VkPipelineCreationFeedback           pipeline;
+    VkPipelineCreationFeedback           stages[PIPELINE_STATS_MAX_STAGES];
+    VkPipelineCreationFeedbackCreateInfo info;
+} PipelineFeedback;
+
+typedef struct PipelineStatsRecord
+{
+    uint32_t kind;  // PipelineObjectKind
+    char     names[PIPELINE_STATS_MAX_STAGES][PIPELINE_STATS_NAME_MAX];  // empty for raw SPIR-V
+    Hash64   shader_hashes[PIPELINE_STATS_MAX_STAGES];
+
+    uint64_t create_ns;  // host time around vkCreate*Pipelines
+    uint64_t driver_ns;  // driver reported duration, 0 without feedback
+    bool     feedback_valid;
+    bool     cache_hit;  // served from the VkPipelineCache
+
+    uint32_t              stage_count;
+    VkShaderStageFlagBits stages[PIPELINE_STATS_MAX_STAGES];
+    uint64_t              stage_ns[PIPELINE_STATS_MAX_STAGES];  // 0 where the driver reported nothing
+    bool                  stage_cache_hit[PIPELINE_STATS_MAX_STAGES];
+} PipelineStatsRecord;
+
+typedef struct PipelineStatsSummary
+{
+    uint32_t count;
+    uint32_t feedback_count;  // records with valid feedback
+    uint32_t cache_hits;
+    float    hit_ratio;  // cache_hits / feedback_count
+    uint64_t total_create_ns;
+    uint64_t total_driver_ns;
+    uint64_t max_create_ns;
+} PipelineStatsSummary;
+
+typedef struct PipelineStatsTable
+{
+    PipelineStatsRecord* records;  // stretchy buffer
+    Mutex                lock;     // guards records
+} PipelineStatsTable;
+
+void pipeline_feedback_init(PipelineFeedback* feedback, uint32_t stage_count);
+bool pipeline_feedback_cache_hit(const PipelineFeedback* feedback);
+
+void pipeline_stats_init(PipelineStatsTable* table);
+void pipeline_stats_destroy(PipelineStatsTable* table);
+
+// table receives every pipeline created from now on, NULL stops recording
+void                pipeline_stats_install(PipelineStatsTable* table);
+PipelineStatsTable* pipeline_stats_installed(void);
+
+// copies record; fills the driver side from feedback when it is not NULL
+void pipeline_stats_add(PipelineStatsTable* table, const PipelineStatsRecord* record, const PipelineFeedback* feedback);
+
+void pipeline_stats_summary(PipelineStatsTable* table, PipelineStatsSummary* out);
+// slowest creations first, returns how many were written to out
+uint32_t pipeline_stats_worst(PipelineStatsTable* table, PipelineStatsRecord* out, uint32_t max_count);
+
+bool pipeline_stats_write_csv(PipelineStatsTable* table, const char* path);
+bool pipeline_stats_write_json(PipelineStatsTable* table, const char* path);
+
+#endif // VK_PIPELINE_STATS_H_
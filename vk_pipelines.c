@@ -1,4 +1,8 @@
 #include "vk_pipelines.h"
+#include "vk_dynamic_state.h"
+#include "vk_pipeline_library.h"
+#include "vk_pipeline_manifest.h"
+#include "vk_pipeline_stats.h"
 
 #include <errno.h>
 #include <stdio.h>
@@ -8,7 +12,7 @@
 // Internal helpers
 // ============================================================================
 
-static bool read_file(const char* path, void** out_data, size_t* out_size)
+bool read_shader_file(const char* path, void** out_data, size_t* out_size)
 {
     *out_data = NULL;
     *out_size = 0;
@@ -66,63 +70,279 @@ static VkShaderModule create_shader_module(VkDevice device, const void* code, si
 }
 
 // ============================================================================
-// Graphics Pipeline
+// Pipeline Object Cache
 // ============================================================================
 
-VkPipeline create_graphics_pipeline(VkDevice                device,
-                                    VkPipelineCache         cache,
-                                    DescriptorLayoutCache*  desc_cache,
-                                    PipelineLayoutCache*    pipe_cache,
-                                    const char*             vert_path,
-                                    const char*             frag_path,
-                                    GraphicsPipelineConfig* cfg,
-                                    VkPipelineLayout*       out_layout)
+static Hash64 hash_pipeline_object_key(const PipelineObjectKey* k)
 {
-    // Load SPIR-V
-    void*  vert_code = NULL;
-    size_t vert_size = 0;
-    void*  frag_code = NULL;
-    size_t frag_size = 0;
+    Hash64 h = XXH64(&k->layout, sizeof(k->layout), 0);
+    h        = XXH64(k->shader_hashes, sizeof(k->shader_hashes), h);
+    return XXH64(&k->state, sizeof(k->state), h);
+}
+
+static bool pipeline_object_keys_equal(const PipelineObjectKey* a, const PipelineObjectKey* b)
+{
+    return a->hash == b->hash && a->layout == b->layout && memcmp(a->shader_hashes, b->shader_hashes, sizeof(a->shader_hashes)) == 0
+           && memcmp(&a->state, &b->state, sizeof(a->state)) == 0;
+}
+
+static bool pipeline_object_entry_matches(const void* value, const void* key)
+{
+    return pipeline_object_keys_equal(&((const PipelineObjectEntry*)value)->key, key);
+}
 
-    if(!read_file(vert_path, &vert_code, &vert_size))
+// fixed size copy of the static part of the config, color formats taken by value
+static PipelineStateKey graphics_state_key(const GraphicsPipelineConfig* cfg)
+{
+    assert(cfg->color_attachment_count <= PIPELINE_OBJECT_MAX_COLOR_FORMATS);
+
+    PipelineStateKey state;
+    memset(&state, 0, sizeof(state));
+
+    state.kind                   = PIPELINE_OBJECT_GRAPHICS;
+    state.flags                  = cfg->pipeline_flags;
+    state.cull_mode              = cfg->cull_mode;
+    state.front_face             = cfg->front_face;
+    state.polygon_mode           = cfg->polygon_mode;
+    state.topology               = cfg->topology;
+    state.depth_test_enable      = cfg->depth_test_enable;
+    state.depth_write_enable     = cfg->depth_write_enable;
+    state.color_attachment_count = cfg->color_attachment_count;
+    state.depth_format           = cfg->depth_format;
+    state.stencil_format         = cfg->stencil_format;
+
+    if(cfg->color_attachment_count)
+        memcpy(state.color_formats, cfg->color_formats, cfg->color_attachment_count * sizeof(VkFormat));
+
+    // dynamic fields are set on the command buffer and must not split the cache
+    uint32_t dyn        = cfg->dynamic_state & PIPELINE_DYNAMIC_ALL;
+    state.dynamic_state = dyn;
+    if(dyn & PIPELINE_DYNAMIC_CULL_MODE)
+        state.cull_mode = 0;
+    if(dyn & PIPELINE_DYNAMIC_FRONT_FACE)
+        state.front_face = 0;
+    if(dyn & PIPELINE_DYNAMIC_PRIMITIVE_TOPOLOGY)
+        state.topology = topology_class(cfg->topology);
+    if(dyn & PIPELINE_DYNAMIC_DEPTH_TEST)
+        state.depth_test_enable = 0;
+    if(dyn & PIPELINE_DYNAMIC_DEPTH_WRITE)
+        state.depth_write_enable = 0;
+    if(dyn & PIPELINE_DYNAMIC_POLYGON_MODE)
+        state.polygon_mode = 0;
+
+    return state;
+}
+
+static void make_pipeline_object_key(PipelineObjectKey*      key,
+                                     const PipelineStateKey* state,
+                                     VkPipelineLayout        layout,
+                                     Hash64                  hash0,
+                                     Hash64                  hash1)
+{
+    memset(key, 0, sizeof(*key));
+
+    key->shader_hashes[0] = hash0;
+    key->shader_hashes[1] = hash1;
+    key->layout           = layout;
+    key->state            = *state;
+    key->hash             = hash_pipeline_object_key(key);
+}
+
+static VkPipeline pipeline_object_find(PipelineObjectCache* cache, const PipelineObjectKey* key)
+{
+    PipelineObjectEntry* hit = hash_index_find(&cache->index, key->hash, pipeline_object_entry_matches, key);
+    if(!hit)
         return VK_NULL_HANDLE;
-    if(!read_file(frag_path, &frag_code, &frag_size))
+
+    ATOMIC_FETCH_ADD(&cache->stats.hits, 1);
+    return hit->pipeline;
+}
+
+// publishes a freshly created pipeline, or drops it if another thread got there first
+static VkPipeline pipeline_object_insert(VkDevice                 device,
+                                         PipelineObjectCache*     cache,
+                                         const PipelineObjectKey* key,
+                                         VkPipeline               pipeline,
+                                         uint64_t                 create_ns,
+                                         bool                     driver_hit)
+{
+    mutex_lock(&cache->lock);
+
+    cache->stats.misses++;
+    cache->stats.create_ns += create_ns;
+    cache->stats.max_create_ns = MAX(cache->stats.max_create_ns, create_ns);
+    cache->stats.driver_cache_hits += driver_hit;
+
+    PipelineObjectEntry* entry = hash_index_find(&cache->index, key->hash, pipeline_object_entry_matches, key);
+    if(entry)
     {
-        free(vert_code);
-        return VK_NULL_HANDLE;
+        vkDestroyPipeline(device, pipeline, NULL);
     }
+    else
+    {
+        entry           = malloc(sizeof(PipelineObjectEntry));
+        entry->key      = *key;
+        entry->pipeline = pipeline;
 
-    // Create shader modules
-    VkShaderModule vert_mod = create_shader_module(device, vert_code, vert_size);
-    VkShaderModule frag_mod = create_shader_module(device, frag_code, frag_size);
+        arrpush(cache->entries, entry);
+        hash_index_insert(&cache->index, key->hash, entry);
+    }
 
-    // Reflect and build pipeline layout
-    const void*      spirvs[2] = {vert_code, frag_code};
-    const size_t     sizes[2]  = {vert_size, frag_size};
-    VkPipelineLayout layout    = shader_reflect_build_pipeline_layout(device, desc_cache, pipe_cache, spirvs, sizes, 2);
-    if(out_layout)
-        *out_layout = layout;
+    mutex_unlock(&cache->lock);
+
+    return entry->pipeline;
+}
+
+void pipeline_object_cache_init(PipelineObjectCache* cache, ShaderModuleCache* modules)
+{
+    memset(cache, 0, sizeof(*cache));
+    cache->modules = modules;
+    hash_index_init(&cache->index, 0);
+    mutex_init(&cache->lock);
+}
+
+void pipeline_object_cache_destroy(VkDevice device, PipelineObjectCache* cache)
+{
+    for(int i = 0; i < arrlen(cache->entries); i++)
+    {
+        vkDestroyPipeline(device, cache->entries[i]->pipeline, NULL);
+        free(cache->entries[i]);
+    }
+
+    arrfree(cache->entries);
+    hash_index_destroy(&cache->index);
+    mutex_destroy(&cache->lock);
+}
+
+void pipeline_object_cache_get_stats(PipelineObjectCache* cache, PipelineObjectCacheStats* out)
+{
+    mutex_lock(&cache->lock);
+    out->misses            = cache->stats.misses;
+    out->create_ns         = cache->stats.create_ns;
+    out->max_create_ns     = cache->stats.max_create_ns;
+    out->driver_cache_hits = cache->stats.driver_cache_hits;
+    mutex_unlock(&cache->lock);
+
+    // bumped outside the lock by lookups
+    out->hits = ATOMIC_LOAD_RELAXED(&cache->stats.hits);
+}
 
-    // Shader stages
-    VkPipelineShaderStageCreateInfo stages[2] = {
+// Resolves spec into state: names through the stage reflections, sorted by
+// ID so equal permutations share a key, a later duplicate ID wins
+static void resolve_specialization(PipelineStateKey*              state,
+                                   const PipelineSpecialization*  spec,
+                                   const ShaderReflection* const* reflections,
+                                   uint32_t                       reflection_count)
+{
+    if(!spec)
+        return;
+
+    assert(spec->count <= PIPELINE_SPEC_MAX_CONSTANTS);
+
+    for(uint32_t i = 0; i < spec->count; i++)
+    {
+        const PipelineSpecConstant* c  = &spec->constants[i];
+        uint32_t                    id = c->constant_id;
+
+        if(c->name)
         {
-            .sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-            .stage  = VK_SHADER_STAGE_VERTEX_BIT,
-            .module = vert_mod,
-            .pName  = "main",
-        },
+            bool found = false;
+            for(uint32_t r = 0; r < reflection_count && !found; r++)
+                found = reflections[r] && shader_reflect_find_spec_constant(reflections[r], c->name, &id);
+
+            if(!found)
+            {
+                log_error("No specialization constant '%s' in the pipeline's shaders", c->name);
+                continue;
+            }
+        }
+
+        uint32_t pos = 0;
+        while(pos < state->spec_count && state->spec_ids[pos] < id)
+            pos++;
+
+        if(pos == state->spec_count || state->spec_ids[pos] != id)
         {
-            .sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-            .stage  = VK_SHADER_STAGE_FRAGMENT_BIT,
-            .module = frag_mod,
-            .pName  = "main",
-        },
+            uint32_t tail = state->spec_count - pos;
+            memmove(&state->spec_ids[pos + 1], &state->spec_ids[pos], tail * sizeof(uint32_t));
+            memmove(&state->spec_values[pos + 1], &state->spec_values[pos], tail * sizeof(uint32_t));
+            state->spec_ids[pos] = id;
+            state->spec_count++;
+        }
+
+        state->spec_values[pos] = c->value;
+    }
+}
+
+// one map for every stage, the data is the resolved values in state
+static VkSpecializationInfo specialization_info(const PipelineStateKey* state, VkSpecializationMapEntry* entries)
+{
+    for(uint32_t i = 0; i < state->spec_count; i++)
+    {
+        entries[i] = (VkSpecializationMapEntry){
+            .constantID = state->spec_ids[i],
+            .offset     = i * (uint32_t)sizeof(uint32_t),
+            .size       = sizeof(uint32_t),
+        };
+    }
+
+    return (VkSpecializationInfo){
+        .mapEntryCount = state->spec_count,
+        .pMapEntries   = entries,
+        .dataSize      = state->spec_count * sizeof(uint32_t),
+        .pData         = state->spec_values,
     };
+}
 
-    ShaderReflection vert_reflect;
-    shader_reflect_create(&vert_reflect, vert_code, vert_size);
+// Where a pipeline's shaders came from, so the manifest can load them again
+typedef struct PipelineOrigin
+{
+    PipelineManifestSource source;
+    const char*            names[2];  // vertex and fragment, or compute and NULL
+} PipelineOrigin;
+
+// origin is NULL for raw SPIR-V, which cannot be reloaded by name
+static void record_pipeline(PipelineObjectCache* cache, const PipelineObjectKey* key, const PipelineOrigin* origin)
+{
+    if(cache->manifest && origin)
+        pipeline_manifest_record(cache->manifest, &key->state, key->shader_hashes[0], key->shader_hashes[1], origin->source,
+                                 origin->names[0], origin->names[1]);
+}
 
-    cfg->vertex_attribute_count = shader_reflect_get_vertex_attributes(&vert_reflect, cfg->vertex_attributes, 16,
+// hands one creation to the installed stats table; feedback is NULL when none was chained
+static void report_creation(PipelineStatsTable*          table,
+                            PipelineObjectKind           kind,
+                            const PipelineOrigin*        origin,
+                            const Hash64*                hashes,
+                            const VkShaderStageFlagBits* stages,
+                            uint32_t                     stage_count,
+                            const PipelineFeedback*      feedback,
+                            uint64_t                     create_ns)
+{
+    PipelineStatsRecord record;
+    memset(&record, 0, sizeof(record));
+    record.kind        = kind;
+    record.create_ns   = create_ns;
+    record.stage_count = stage_count;
+
+    for(uint32_t i = 0; i < stage_count; i++)
+    {
+        record.shader_hashes[i] = hashes[i];
+        record.stages[i]        = stages[i];
+        if(origin && origin->names[i])
+            snprintf(record.names[i], PIPELINE_STATS_NAME_MAX, "%s", origin->names[i]);
+    }
+
+    pipeline_stats_add(table, &record, feedback);
+}
+
+// ============================================================================
+// Graphics Pipeline
+// ============================================================================
+
+void vertex_input_from_reflection(const ShaderReflection* vert_reflect, GraphicsPipelineConfig* cfg)
+{
+    cfg->vertex_attribute_count = shader_reflect_get_vertex_attributes(vert_reflect, cfg->vertex_attributes, 16,
                                                                        0  // binding index
     );
 
@@ -156,11 +376,121 @@ VkPipeline create_graphics_pipeline(VkDevice                device,
             stride = end;
     }
 
-
-    // Vertex input
     cfg->vertex_binding_count = 1;
     cfg->vertex_bindings[0] =
         (VkVertexInputBindingDescription){.binding = 0, .stride = stride, .inputRate = VK_VERTEX_INPUT_RATE_VERTEX};
+}
+
+void reflect_vertex_input(const void* vert_code, size_t vert_size, GraphicsPipelineConfig* cfg)
+{
+    ShaderReflection vert_reflect;
+    if(!shader_reflect_create(&vert_reflect, vert_code, vert_size))
+        return;
+
+    vertex_input_from_reflection(&vert_reflect, cfg);
+    shader_reflect_destroy(&vert_reflect);
+}
+
+// pipeline layout from reflections the caller already holds, NULL entries failed to reflect
+static VkPipelineLayout layout_from_reflections(VkDevice                       device,
+                                                DescriptorLayoutCache*         desc_cache,
+                                                PipelineLayoutCache*           pipe_cache,
+                                                const ShaderReflection* const* reflections,
+                                                uint32_t                       count)
+{
+    // merge wants a dense array
+    ShaderReflection dense[2];
+    uint32_t         valid_count = 0;
+
+    assert(count <= 2);
+    for(uint32_t i = 0; i < count; i++)
+    {
+        if(reflections[i])
+            dense[valid_count++] = *reflections[i];
+    }
+
+    if(valid_count == 0)
+    {
+        log_error("No valid shader reflections created");
+        return VK_NULL_HANDLE;
+    }
+
+    MergedReflection merged;
+    shader_reflect_merge(&merged, dense, valid_count);
+
+    return shader_reflect_create_pipeline_layout(device, desc_cache, pipe_cache, &merged);
+}
+
+// Module and reflection of one stage, from the module cache or made for this call only
+typedef struct StageShader
+{
+    const ShaderModuleEntry* entry;  // set when the code came from the module cache
+    VkShaderModule           module;
+    ShaderReflection         reflection;
+    bool                     reflected;
+    Hash64                   hash;
+} StageShader;
+
+static void stage_shader_acquire(VkDevice device, ShaderModuleCache* modules, StageShader* s, const void* code, size_t size, const Hash64* hash)
+{
+    memset(s, 0, sizeof(*s));
+
+    if(modules)
+    {
+        s->entry = shader_module_cache_get(modules, code, size, hash);
+        s->hash  = s->entry->hash;
+        return;
+    }
+
+    s->reflected = shader_reflect_create(&s->reflection, code, size);
+    s->hash      = hash ? *hash : 0;
+}
+
+static const ShaderReflection* stage_shader_reflection(const StageShader* s)
+{
+    if(s->entry)
+        return s->entry->reflected ? &s->entry->reflection : NULL;
+    return s->reflected ? &s->reflection : NULL;
+}
+
+// hash of the code, computed on first use when neither the caller nor the module cache had it
+static Hash64 stage_shader_hash(StageShader* s, const void* code, size_t size)
+{
+    if(!s->entry && !s->hash)
+        s->hash = hash64_bytes(code, size);
+    return s->hash;
+}
+
+static VkPipelineShaderStageCreateInfo stage_shader_info(VkDevice device, StageShader* s, VkShaderStageFlagBits stage, const void* code, size_t size)
+{
+    if(s->entry)
+        return shader_module_stage_info(s->entry, stage);
+
+    s->module = create_shader_module(device, code, size);
+    return (VkPipelineShaderStageCreateInfo){
+        .sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+        .stage  = stage,
+        .module = s->module,
+        .pName  = "main",
+    };
+}
+
+static void stage_shader_release(VkDevice device, StageShader* s)
+{
+    if(s->module != VK_NULL_HANDLE)
+        vkDestroyShaderModule(device, s->module, NULL);
+    if(s->reflected)
+        shader_reflect_destroy(&s->reflection);
+}
+
+static VkPipeline build_graphics_pipeline(VkDevice                               device,
+                                          VkPipelineCache                        cache,
+                                          const GraphicsPipelineConfig*          cfg,
+                                          VkPipelineLayout                       layout,
+                                          const VkPipelineShaderStageCreateInfo* stages,
+                                          PipelineFeedback*                      feedback)
+{
+    // Vertex input
     VkPipelineVertexInputStateCreateInfo vertex_input = {
         .sType                           = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
         .vertexBindingDescriptionCount   = cfg->vertex_binding_count,
@@ -222,16 +552,22 @@ VkPipeline create_graphics_pipeline(VkDevice                device,
     };
 
     // Dynamic state
-    VkDynamicState                   dyn_states[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
-    VkPipelineDynamicStateCreateInfo dynamic      = {
-             .sType             = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
-             .dynamicStateCount = 2,
-             .pDynamicStates    = dyn_states,
+    VkDynamicState dyn_states[2 + PIPELINE_DYNAMIC_STATE_MAX] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    uint32_t       dyn_count = 2 + pipeline_dynamic_state_list(cfg->dynamic_state, dyn_states + 2);
+
+    VkPipelineDynamicStateCreateInfo dynamic = {
+        .sType             = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+        .dynamicStateCount = dyn_count,
+        .pDynamicStates    = dyn_states,
     };
 
+    // Creation feedback, per pipeline and per stage
+    pipeline_feedback_init(feedback, 2);
+
     // Dynamic rendering
     VkPipelineRenderingCreateInfo rendering = {
         .sType                   = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO,
+        .pNext                   = &feedback->info,
         .colorAttachmentCount    = cfg->color_attachment_count,
         .pColorAttachmentFormats = cfg->color_formats,
         .depthAttachmentFormat   = cfg->depth_format,
@@ -242,6 +578,7 @@ VkPipeline create_graphics_pipeline(VkDevice                device,
     VkGraphicsPipelineCreateInfo ci = {
         .sType               = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
         .pNext               = &rendering,
+        .flags               = cfg->pipeline_flags,
         .stageCount          = 2,
         .pStages             = stages,
         .pVertexInputState   = &vertex_input,
@@ -258,14 +595,180 @@ VkPipeline create_graphics_pipeline(VkDevice                device,
     VkPipeline pipeline = VK_NULL_HANDLE;
     VK_CHECK(vkCreateGraphicsPipelines(device, cache, 1, &ci, NULL, &pipeline));
 
-    // Cleanup
-    vkDestroyShaderModule(device, vert_mod, NULL);
-    vkDestroyShaderModule(device, frag_mod, NULL);
+    return pipeline;
+}
+
+// hashes are the XXH64 of the code, computed here when NULL
+static VkPipeline graphics_pipeline_from_code(VkDevice                device,
+                                              VkPipelineCache         cache,
+                                              DescriptorLayoutCache*  desc_cache,
+                                              PipelineLayoutCache*    pipe_cache,
+                                              PipelineObjectCache*    obj_cache,
+                                              const void*             vert_code,
+                                              size_t                  vert_size,
+                                              const void*             frag_code,
+                                              size_t                  frag_size,
+                                              const Hash64*           hashes,
+                                              const PipelineOrigin*   origin,
+                                              GraphicsPipelineConfig* cfg,
+                                              VkPipelineLayout*       out_layout)
+{
+    ShaderModuleCache* modules = obj_cache ? obj_cache->modules : NULL;
+
+    // Reflect each stage once, for vertex input and the pipeline layout
+    StageShader vert;
+    StageShader frag;
+    stage_shader_acquire(device, modules, &vert, vert_code, vert_size, hashes ? &hashes[0] : NULL);
+    stage_shader_acquire(device, modules, &frag, frag_code, frag_size, hashes ? &hashes[1] : NULL);
+
+    const ShaderReflection* reflections[2] = {stage_shader_reflection(&vert), stage_shader_reflection(&frag)};
+    if(reflections[0])
+        vertex_input_from_reflection(reflections[0], cfg);
+
+    VkPipelineLayout layout = layout_from_reflections(device, desc_cache, pipe_cache, reflections, 2);
+    if(out_layout)
+        *out_layout = layout;
+
+    PipelineStateKey state = graphics_state_key(cfg);
+    resolve_specialization(&state, cfg->specialization, reflections, 2);
+
+    VkPipeline        pipeline = VK_NULL_HANDLE;
+    PipelineObjectKey key;
+    if(obj_cache)
+    {
+        make_pipeline_object_key(&key, &state, layout, stage_shader_hash(&vert, vert_code, vert_size),
+                                 stage_shader_hash(&frag, frag_code, frag_size));
+
+        pipeline = pipeline_object_find(obj_cache, &key);
+    }
+
+    if(pipeline == VK_NULL_HANDLE)
+    {
+        const VkShaderStageFlagBits stage_bits[2] = {VK_SHADER_STAGE_VERTEX_BIT, VK_SHADER_STAGE_FRAGMENT_BIT};
+
+        PipelineFeedback  feedback;
+        PipelineFeedback* chained = NULL;  // library links report no feedback
+        uint64_t          start   = time_now_ns();
+
+        if(cfg->libraries && state.spec_count == 0)
+        {
+            const Hash64 shader_hashes[2] = {stage_shader_hash(&vert, vert_code, vert_size), stage_shader_hash(&frag, frag_code, frag_size)};
+            pipeline = pipeline_library_link(cfg->libraries, vert_code, vert_size, frag_code, frag_size, shader_hashes, cfg, layout);
+        }
+        else
+        {
+            VkSpecializationMapEntry spec_entries[PIPELINE_SPEC_MAX_CONSTANTS];
+            VkSpecializationInfo     spec_info = specialization_info(&state, spec_entries);
+
+            VkPipelineShaderStageCreateInfo stages[2] = {
+                stage_shader_info(device, &vert, stage_bits[0], vert_code, vert_size),
+                stage_shader_info(device, &frag, stage_bits[1], frag_code, frag_size),
+            };
+            if(state.spec_count)
+                stages[0].pSpecializationInfo = stages[1].pSpecializationInfo = &spec_info;
+
+            pipeline = build_graphics_pipeline(device, cache, cfg, layout, stages, &feedback);
+            chained  = &feedback;
+        }
+
+        uint64_t elapsed = time_now_ns() - start;
+
+        PipelineStatsTable* stats_table = pipeline_stats_installed();
+        if(stats_table)
+        {
+            const Hash64 hashes[2] = {stage_shader_hash(&vert, vert_code, vert_size), stage_shader_hash(&frag, frag_code, frag_size)};
+            report_creation(stats_table, PIPELINE_OBJECT_GRAPHICS, origin, hashes, stage_bits, 2, chained, elapsed);
+        }
+
+        if(obj_cache)
+        {
+            pipeline = pipeline_object_insert(device, obj_cache, &key, pipeline, elapsed, chained && pipeline_feedback_cache_hit(chained));
+            record_pipeline(obj_cache, &key, origin);
+        }
+    }
+
+    stage_shader_release(device, &vert);
+    stage_shader_release(device, &frag);
+
+    return pipeline;
+}
+
+VkPipeline create_graphics_pipeline_from_spirv(VkDevice                device,
+                                               VkPipelineCache         cache,
+                                               DescriptorLayoutCache*  desc_cache,
+                                               PipelineLayoutCache*    pipe_cache,
+                                               PipelineObjectCache*    obj_cache,
+                                               const void*             vert_code,
+                                               size_t                  vert_size,
+                                               const void*             frag_code,
+                                               size_t                  frag_size,
+                                               GraphicsPipelineConfig* cfg,
+                                               VkPipelineLayout*       out_layout)
+{
+    return graphics_pipeline_from_code(device, cache, desc_cache, pipe_cache, obj_cache, vert_code, vert_size, frag_code,
+                                       frag_size, NULL, NULL, cfg, out_layout);
+}
+
+VkPipeline create_graphics_pipeline_from_archive(VkDevice                device,
+                                                 VkPipelineCache         cache,
+                                                 DescriptorLayoutCache*  desc_cache,
+                                                 PipelineLayoutCache*    pipe_cache,
+                                                 PipelineObjectCache*    obj_cache,
+                                                 const ShaderArchive*    archive,
+                                                 const char*             vert_name,
+                                                 const char*             frag_name,
+                                                 GraphicsPipelineConfig* cfg,
+                                                 VkPipelineLayout*       out_layout)
+{
+    const ShaderArchiveEntry* vert = shader_archive_find(archive, vert_name);
+    const ShaderArchiveEntry* frag = shader_archive_find(archive, frag_name);
+    if(!vert || !frag)
+    {
+        log_error("Shader archive has no '%s'", vert ? frag_name : vert_name);
+        return VK_NULL_HANDLE;
+    }
+
+    // SPIR-V straight out of the mapping, hashes precomputed by the packer
+    const Hash64         hashes[2] = {vert->code_hash, frag->code_hash};
+    const PipelineOrigin origin    = {PIPELINE_SOURCE_ARCHIVE, {vert_name, frag_name}};
+    return graphics_pipeline_from_code(device, cache, desc_cache, pipe_cache, obj_cache, shader_archive_code(archive, vert),
+                                       vert->size, shader_archive_code(archive, frag), frag->size, hashes, &origin, cfg, out_layout);
+}
+
+VkPipeline create_graphics_pipeline(VkDevice                device,
+                                    VkPipelineCache         cache,
+                                    DescriptorLayoutCache*  desc_cache,
+                                    PipelineLayoutCache*    pipe_cache,
+                                    PipelineObjectCache*    obj_cache,
+                                    const char*             vert_path,
+                                    const char*             frag_path,
+                                    GraphicsPipelineConfig* cfg,
+                                    VkPipelineLayout*       out_layout)
+{
+    // Load SPIR-V
+    void*  vert_code = NULL;
+    size_t vert_size = 0;
+    void*  frag_code = NULL;
+    size_t frag_size = 0;
+
+    if(!read_shader_file(vert_path, &vert_code, &vert_size))
+        return VK_NULL_HANDLE;
+    if(!read_shader_file(frag_path, &frag_code, &frag_size))
+    {
+        free(vert_code);
+        return VK_NULL_HANDLE;
+    }
+
+    const PipelineOrigin origin   = {PIPELINE_SOURCE_FILES, {vert_path, frag_path}};
+    VkPipeline           pipeline = graphics_pipeline_from_code(device, cache, desc_cache, pipe_cache, obj_cache, vert_code, vert_size,
+                                                                frag_code, frag_size, NULL, &origin, cfg, out_layout);
+
     free(vert_code);
     free(frag_code);
 
     return pipeline;
 }
+
 void vk_cmd_set_viewport_scissor(VkCommandBuffer cmd, VkExtent2D extent)
 {
     VkViewport vp = {
@@ -290,49 +793,334 @@ void vk_cmd_set_viewport_scissor(VkCommandBuffer cmd, VkExtent2D extent)
 // Compute Pipeline
 // ============================================================================
 
-VkPipeline create_compute_pipeline(VkDevice               device,
-                                   VkPipelineCache        cache,
-                                   DescriptorLayoutCache* desc_cache,
-                                   PipelineLayoutCache*   pipe_cache,
-                                   const char*            comp_path,
-                                   VkPipelineLayout*      out_layout)
+// One compute pipeline on its way through creation, shared by the single and batch paths
+typedef struct ComputeBuild
 {
-    // Load SPIR-V
-    void*  comp_code = NULL;
-    size_t comp_size = 0;
-    if(!read_file(comp_path, &comp_code, &comp_size))
-        return VK_NULL_HANDLE;
+    StageShader              comp;
+    const void*              code;
+    size_t                   size;
+    const PipelineOrigin*    origin;
+    VkPipelineLayout         layout;
+    uint32_t                 local_size[3];
+    PipelineObjectKey        key;  // only state is filled without an object cache
+    VkSpecializationMapEntry spec_entries[PIPELINE_SPEC_MAX_CONSTANTS];
+    VkSpecializationInfo     spec_info;
+    PipelineFeedback         feedback;
+} ComputeBuild;
 
-    // Create shader module
-    VkShaderModule comp_mod = create_shader_module(device, comp_code, comp_size);
+// reflected workgroup size, 1 for dimensions SPIRV-Reflect could not resolve (LocalSizeId)
+static void reflected_local_size(const ShaderReflection* reflection, uint32_t* out)
+{
+    const uint32_t size[3] = {
+        reflection ? reflection->local_size_x : 0,
+        reflection ? reflection->local_size_y : 0,
+        reflection ? reflection->local_size_z : 0,
+    };
+
+    for(uint32_t i = 0; i < 3; i++)
+        out[i] = size[i] == 0 || size[i] == UINT32_MAX ? 1 : size[i];
+}
+
+// module, reflection, layout and key; returns the cached pipeline on a hit.
+// hash is a pointer to the XXH64 of the code, computed here when NULL
+static VkPipeline compute_build_begin(ComputeBuild*                 b,
+                                      VkDevice                      device,
+                                      DescriptorLayoutCache*        desc_cache,
+                                      PipelineLayoutCache*          pipe_cache,
+                                      PipelineObjectCache*          obj_cache,
+                                      const void*                   code,
+                                      size_t                        size,
+                                      const Hash64*                 hash,
+                                      const PipelineSpecialization* specialization,
+                                      const PipelineOrigin*         origin)
+{
+    memset(b, 0, sizeof(*b));
+    b->code   = code;
+    b->size   = size;
+    b->origin = origin;
+
+    stage_shader_acquire(device, obj_cache ? obj_cache->modules : NULL, &b->comp, code, size, hash);
 
     // Reflect and build pipeline layout
-    const void*      spirvs[1] = {comp_code};
-    const size_t     sizes[1]  = {comp_size};
-    VkPipelineLayout layout    = shader_reflect_build_pipeline_layout(device, desc_cache, pipe_cache, spirvs, sizes, 1);
-    if(out_layout)
-        *out_layout = layout;
+    const ShaderReflection* reflection = stage_shader_reflection(&b->comp);
+    b->layout                          = layout_from_reflections(device, desc_cache, pipe_cache, &reflection, 1);
+    reflected_local_size(reflection, b->local_size);
 
-    // Create pipeline
-    VkPipelineShaderStageCreateInfo stage = {
-        .sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-        .stage  = VK_SHADER_STAGE_COMPUTE_BIT,
-        .module = comp_mod,
-        .pName  = "main",
-    };
+    PipelineStateKey state;
+    memset(&state, 0, sizeof(state));
+    state.kind = PIPELINE_OBJECT_COMPUTE;
+    resolve_specialization(&state, specialization, &reflection, 1);
+
+    if(!obj_cache)
+    {
+        b->key.state = state;
+        return VK_NULL_HANDLE;
+    }
+
+    make_pipeline_object_key(&b->key, &state, b->layout, stage_shader_hash(&b->comp, code, size), 0);
+    return pipeline_object_find(obj_cache, &b->key);
+}
+
+// create info for a miss, points into b
+static VkComputePipelineCreateInfo compute_build_create_info(VkDevice device, ComputeBuild* b)
+{
+    pipeline_feedback_init(&b->feedback, 1);
+    b->spec_info = specialization_info(&b->key.state, b->spec_entries);
 
     VkComputePipelineCreateInfo ci = {
         .sType  = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
-        .stage  = stage,
-        .layout = layout,
+        .pNext  = &b->feedback.info,
+        .stage  = stage_shader_info(device, &b->comp, VK_SHADER_STAGE_COMPUTE_BIT, b->code, b->size),
+        .layout = b->layout,
     };
+    if(b->key.state.spec_count)
+        ci.stage.pSpecializationInfo = &b->spec_info;
 
-    VkPipeline pipeline = VK_NULL_HANDLE;
-    VK_CHECK(vkCreateComputePipelines(device, cache, 1, &ci, NULL, &pipeline));
+    return ci;
+}
+
+// reports a freshly created pipeline and hands it to the cache, returns the one to use
+static VkPipeline compute_build_publish(VkDevice device, ComputeBuild* b, PipelineObjectCache* obj_cache, VkPipeline pipeline, uint64_t create_ns)
+{
+    PipelineStatsTable* stats_table = pipeline_stats_installed();
+    if(stats_table)
+    {
+        const Hash64                hash  = stage_shader_hash(&b->comp, b->code, b->size);
+        const VkShaderStageFlagBits stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        report_creation(stats_table, PIPELINE_OBJECT_COMPUTE, b->origin, &hash, &stage, 1, &b->feedback, create_ns);
+    }
+
+    if(obj_cache)
+    {
+        pipeline = pipeline_object_insert(device, obj_cache, &b->key, pipeline, create_ns, pipeline_feedback_cache_hit(&b->feedback));
+        record_pipeline(obj_cache, &b->key, b->origin);
+    }
+
+    return pipeline;
+}
+
+// hash is a pointer to the XXH64 of the code, computed here when NULL
+static VkPipeline compute_pipeline_from_code(VkDevice                      device,
+                                             VkPipelineCache               cache,
+                                             DescriptorLayoutCache*        desc_cache,
+                                             PipelineLayoutCache*          pipe_cache,
+                                             PipelineObjectCache*          obj_cache,
+                                             const void*                   comp_code,
+                                             size_t                        comp_size,
+                                             const Hash64*                 hash,
+                                             const PipelineSpecialization* specialization,
+                                             const PipelineOrigin*         origin,
+                                             VkPipelineLayout*             out_layout)
+{
+    ComputeBuild b;
+    VkPipeline   pipeline =
+        compute_build_begin(&b, device, desc_cache, pipe_cache, obj_cache, comp_code, comp_size, hash, specialization, origin);
+    if(out_layout)
+        *out_layout = b.layout;
+
+    if(pipeline == VK_NULL_HANDLE)
+    {
+        VkComputePipelineCreateInfo ci = compute_build_create_info(device, &b);
+
+        uint64_t start = time_now_ns();
+        VK_CHECK(vkCreateComputePipelines(device, cache, 1, &ci, NULL, &pipeline));
+        uint64_t elapsed = time_now_ns() - start;
+
+        pipeline = compute_build_publish(device, &b, obj_cache, pipeline, elapsed);
+    }
+
+    stage_shader_release(device, &b.comp);
+
+    return pipeline;
+}
+
+VkPipeline create_compute_pipeline_from_spirv(VkDevice                      device,
+                                              VkPipelineCache               cache,
+                                              DescriptorLayoutCache*        desc_cache,
+                                              PipelineLayoutCache*          pipe_cache,
+                                              PipelineObjectCache*          obj_cache,
+                                              const void*                   comp_code,
+                                              size_t                        comp_size,
+                                              const PipelineSpecialization* specialization,
+                                              VkPipelineLayout*             out_layout)
+{
+    return compute_pipeline_from_code(device, cache, desc_cache, pipe_cache, obj_cache, comp_code, comp_size, NULL, specialization,
+                                      NULL, out_layout);
+}
+
+VkPipeline create_compute_pipeline_from_archive(VkDevice                      device,
+                                                VkPipelineCache               cache,
+                                                DescriptorLayoutCache*        desc_cache,
+                                                PipelineLayoutCache*          pipe_cache,
+                                                PipelineObjectCache*          obj_cache,
+                                                const ShaderArchive*          archive,
+                                                const char*                   comp_name,
+                                                const PipelineSpecialization* specialization,
+                                                VkPipelineLayout*             out_layout)
+{
+    const ShaderArchiveEntry* comp = shader_archive_find(archive, comp_name);
+    if(!comp)
+    {
+        log_error("Shader archive has no '%s'", comp_name);
+        return VK_NULL_HANDLE;
+    }
+
+    const PipelineOrigin origin = {PIPELINE_SOURCE_ARCHIVE, {comp_name, NULL}};
+    return compute_pipeline_from_code(device, cache, desc_cache, pipe_cache, obj_cache, shader_archive_code(archive, comp),
+                                      comp->size, &comp->code_hash, specialization, &origin, out_layout);
+}
+
+VkPipeline create_compute_pipeline(VkDevice                      device,
+                                   VkPipelineCache               cache,
+                                   DescriptorLayoutCache*        desc_cache,
+                                   PipelineLayoutCache*          pipe_cache,
+                                   PipelineObjectCache*          obj_cache,
+                                   const char*                   comp_path,
+                                   const PipelineSpecialization* specialization,
+                                   VkPipelineLayout*             out_layout)
+{
+    // Load SPIR-V
+    void*  comp_code = NULL;
+    size_t comp_size = 0;
+    if(!read_shader_file(comp_path, &comp_code, &comp_size))
+        return VK_NULL_HANDLE;
+
+    const PipelineOrigin origin   = {PIPELINE_SOURCE_FILES, {comp_path, NULL}};
+    VkPipeline           pipeline = compute_pipeline_from_code(device, cache, desc_cache, pipe_cache, obj_cache, comp_code, comp_size,
+                                                               NULL, specialization, &origin, out_layout);
 
-    // Cleanup
-    vkDestroyShaderModule(device, comp_mod, NULL);
     free(comp_code);
 
     return pipeline;
 }
+
+uint32_t create_compute_pipelines(VkDevice                   device,
+                                  VkPipelineCache            cache,
+                                  DescriptorLayoutCache*     desc_cache,
+                                  PipelineLayoutCache*       pipe_cache,
+                                  PipelineObjectCache*       obj_cache,
+                                  const ComputePipelineDesc* descs,
+                                  uint32_t                   count,
+                                  ComputePipeline*           out)
+{
+    ComputeBuild*                builds  = malloc(MAX(count, 1u) * sizeof(ComputeBuild));
+    PipelineOrigin*              origins = malloc(MAX(count, 1u) * sizeof(PipelineOrigin));
+    void**                       loaded  = calloc(MAX(count, 1u), sizeof(void*));
+    bool*                        begun   = calloc(MAX(count, 1u), sizeof(bool));
+    uint32_t*                    same_as = malloc(MAX(count, 1u) * sizeof(uint32_t));  // earlier desc building the same pipeline
+    uint32_t*                    misses  = malloc(MAX(count, 1u) * sizeof(uint32_t));  // desc index of each create info
+    VkComputePipelineCreateInfo* infos   = malloc(MAX(count, 1u) * sizeof(VkComputePipelineCreateInfo));
+    uint32_t                     miss_count = 0;
+
+    for(uint32_t i = 0; i < count; i++)
+    {
+        const ComputePipelineDesc* d = &descs[i];
+
+        memset(&out[i], 0, sizeof(out[i]));
+        same_as[i] = UINT32_MAX;
+
+        const void*   code = d->code;
+        size_t        size = d->code_size;
+        const Hash64* hash = NULL;
+
+        if(d->comp_path && d->archive)
+        {
+            const ShaderArchiveEntry* entry = shader_archive_find(d->archive, d->comp_path);
+            if(!entry)
+            {
+                log_error("Shader archive has no '%s'", d->comp_path);
+                continue;
+            }
+
+            code       = shader_archive_code(d->archive, entry);
+            size       = entry->size;
+            hash       = &entry->code_hash;
+            origins[i] = (PipelineOrigin){PIPELINE_SOURCE_ARCHIVE, {d->comp_path, NULL}};
+        }
+        else if(d->comp_path)
+        {
+            if(!read_shader_file(d->comp_path, &loaded[i], &size))
+                continue;
+
+            code       = loaded[i];
+            origins[i] = (PipelineOrigin){PIPELINE_SOURCE_FILES, {d->comp_path, NULL}};
+        }
+        else if(!code || size == 0)
+        {
+            log_error("Compute pipeline desc %u has neither comp_path nor code", i);
+            continue;
+        }
+
+        ComputeBuild* b        = &builds[i];
+        VkPipeline    pipeline = compute_build_begin(b, device, desc_cache, pipe_cache, obj_cache, code, size, hash, d->specialization,
+                                                     d->comp_path ? &origins[i] : NULL);
+        begun[i]               = true;
+
+        out[i].pipeline = pipeline;
+        out[i].layout   = b->layout;
+        memcpy(out[i].local_size, b->local_size, sizeof(out[i].local_size));
+
+        if(pipeline != VK_NULL_HANDLE)
+            continue;
+
+        // the same permutation twice in one batch is created once when the cache would share it anyway
+        if(obj_cache)
+        {
+            for(uint32_t m = 0; m < miss_count && same_as[i] == UINT32_MAX; m++)
+            {
+                if(pipeline_object_keys_equal(&builds[misses[m]].key, &b->key))
+                    same_as[i] = misses[m];
+            }
+            if(same_as[i] != UINT32_MAX)
+                continue;
+        }
+
+        infos[miss_count]    = compute_build_create_info(device, b);
+        misses[miss_count++] = i;
+    }
+
+    if(miss_count)
+    {
+        VkPipeline* created = calloc(miss_count, sizeof(VkPipeline));
+
+        // one call, the driver may compile the pipelines in parallel
+        uint64_t start = time_now_ns();
+        VK_CHECK(vkCreateComputePipelines(device, cache, miss_count, infos, NULL, created));
+        uint64_t elapsed = time_now_ns() - start;
+
+        // host time is only known for the whole call, each pipeline is charged an equal share
+        for(uint32_t m = 0; m < miss_count; m++)
+        {
+            uint32_t i      = misses[m];
+            out[i].pipeline = compute_build_publish(device, &builds[i], obj_cache, created[m], elapsed / miss_count);
+        }
+
+        free(created);
+    }
+
+    uint32_t built = 0;
+    for(uint32_t i = 0; i < count; i++)
+    {
+        if(same_as[i] != UINT32_MAX)
+        {
+            ATOMIC_FETCH_ADD(&obj_cache->stats.hits, 1);
+            out[i].pipeline = out[same_as[i]].pipeline;
+        }
+
+        if(begun[i])
+            stage_shader_release(device, &builds[i].comp);
+        free(loaded[i]);
+
+        built += out[i].pipeline != VK_NULL_HANDLE;
+    }
+
+    free(infos);
+    free(misses);
+    free(same_as);
+    free(begun);
+    free(loaded);
+    free(origins);
+    free(builds);
+
+    return built;
+}
@@ -5,11 +5,68 @@
 #include "vk_pipeline_layout.h"
 #include "vk_descriptor.h"
 #include "vk_shader_reflect.h"
+#include "vk_shader_archive.h"
+#include "vk_shader_module.h"
 
 // ============================================================================
 // Graphics Pipeline Config - minimal, no shader module fields
 // ============================================================================
 
+// State a pipeline can leave dynamic, see vk_dynamic_state.h. Dynamic
+// fields are left out of the pipeline cache key, so toggling them reuses
+// one VkPipeline and is set on the command buffer instead.
+typedef enum PipelineDynamicStateBits
+{
+    PIPELINE_DYNAMIC_CULL_MODE          = 1u << 0,
+    PIPELINE_DYNAMIC_FRONT_FACE         = 1u << 1,
+    PIPELINE_DYNAMIC_PRIMITIVE_TOPOLOGY = 1u << 2,  // within the topology class of config.topology
+    PIPELINE_DYNAMIC_DEPTH_TEST         = 1u << 3,
+    PIPELINE_DYNAMIC_DEPTH_WRITE        = 1u << 4,
+    PIPELINE_DYNAMIC_POLYGON_MODE       = 1u << 5,  // VK_EXT_extended_dynamic_state3
+} PipelineDynamicStateBits;
+
+// extended dynamic state, core since Vulkan 1.3
+#define PIPELINE_DYNAMIC_CORE                                                                                          \
+    (PIPELINE_DYNAMIC_CULL_MODE | PIPELINE_DYNAMIC_FRONT_FACE | PIPELINE_DYNAMIC_PRIMITIVE_TOPOLOGY                    \
+     | PIPELINE_DYNAMIC_DEPTH_TEST | PIPELINE_DYNAMIC_DEPTH_WRITE)
+#define PIPELINE_DYNAMIC_ALL (PIPELINE_DYNAMIC_CORE | PIPELINE_DYNAMIC_POLYGON_MODE)
+
+// ============================================================================
+// Specialization constants
+// ============================================================================
+//
+// Constants are given by name or by constant_id. Names are resolved
+// through the reflection of each stage, and the resolved (ID, value)
+// pairs go into the pipeline cache key, so each permutation compiles once.
+// Every stage gets the same map, and IDs a stage does not declare are
+// ignored by Vulkan. Values are 32 bit: bool, int, uint or float bits.
+//
+//   PipelineSpecConstant consts[] = {{.name = "USE_SHADOWS", .value = 1}, {.name = "BLUR_RADIUS", .value = 4}};
+//   PipelineSpecialization spec   = {.constants = consts, .count = 2};
+//   cfg.specialization            = &spec;
+
+#define PIPELINE_SPEC_MAX_CONSTANTS 16
+
+typedef struct PipelineSpecConstant
+{
+    const char* name;         // NULL to use constant_id as is
+    uint32_t    constant_id;
+    uint32_t    value;
+} PipelineSpecConstant;
+
+typedef struct PipelineSpecialization
+{
+    const PipelineSpecConstant* constants;
+    uint32_t                    count;  // at most PIPELINE_SPEC_MAX_CONSTANTS
+} PipelineSpecialization;
+
+static inline uint32_t pipeline_spec_float(float f)
+{
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}
+
 typedef struct GraphicsPipelineConfig
 {
     // Vertex input (optional - can be NULL for vertex-pulling)
@@ -35,11 +92,113 @@ typedef struct GraphicsPipelineConfig
     VkFormat        depth_format;
     VkFormat        stencil_format;
 
+    // Extra create flags, e.g. bindless_get_pipeline_create_flags()
+    VkPipelineCreateFlags pipeline_flags;
+
+    // PipelineDynamicStateBits, mask with pipeline_dynamic_state_supported()
+    uint32_t dynamic_state;
+
+    // Optional: fast-link from cached pipeline library parts (vk_pipeline_library.h)
+    // Ignored for specialized pipelines, those are built whole
+    struct PipelineLibraryCache* libraries;
+
+    // Optional: specialization constants for both stages, only read during the create call
+    const PipelineSpecialization* specialization;
+
 } GraphicsPipelineConfig;
 
+// ============================================================================
+// Pipeline Object Cache
+// ============================================================================
+//
+// Returns an existing VkPipeline when the same SPIR-V is built again with
+// the same config and layout. The key is the xxh64 of each stage's SPIR-V,
+// the pipeline layout and a canonical copy of the config that holds the
+// color formats by value. Vertex input is derived from the vertex shader,
+// so the shader hash already covers it.
+//
+// Pipelines handed out by the cache belong to it, do not destroy them.
+// Lookups are lock-free. Creation runs outside the lock so different
+// pipelines can compile in parallel. If two threads race on the same key,
+// one result is kept and the other pipeline is destroyed.
+//
+// With a PipelineManifest attached (vk_pipeline_manifest.h) every pipeline
+// created from shader files or an archive is recorded there, so the next
+// run can rebuild it before the first frame.
+
+#define PIPELINE_OBJECT_MAX_COLOR_FORMATS 8
+
+typedef enum PipelineObjectKind
+{
+    PIPELINE_OBJECT_GRAPHICS,
+    PIPELINE_OBJECT_COMPUTE,
+} PipelineObjectKind;
+
+// every field is 32 bit so the struct has no padding to hash
+typedef struct PipelineStateKey
+{
+    uint32_t              kind;
+    VkPipelineCreateFlags flags;
+    VkCullModeFlags       cull_mode;
+    VkFrontFace           front_face;
+    VkPolygonMode         polygon_mode;
+    VkPrimitiveTopology   topology;
+    VkBool32              depth_test_enable;
+    VkBool32              depth_write_enable;
+    uint32_t              color_attachment_count;
+    VkFormat              color_formats[PIPELINE_OBJECT_MAX_COLOR_FORMATS];
+    VkFormat              depth_format;
+    VkFormat              stencil_format;
+    uint32_t              dynamic_state;  // fields covered by it are zero, topology keeps only its class
+    uint32_t              spec_count;     // resolved specialization constants, sorted by ID
+    uint32_t              spec_ids[PIPELINE_SPEC_MAX_CONSTANTS];
+    uint32_t              spec_values[PIPELINE_SPEC_MAX_CONSTANTS];
+} PipelineStateKey;
+
+typedef struct PipelineObjectKey
+{
+    Hash64           hash;
+    Hash64           shader_hashes[2];  // vertex and fragment, or compute and 0
+    VkPipelineLayout layout;
+    PipelineStateKey state;  // only kind and specialization for compute
+} PipelineObjectKey;
+
+typedef struct PipelineObjectEntry
+{
+    PipelineObjectKey key;
+    VkPipeline        pipeline;
+} PipelineObjectEntry;
+
+typedef struct PipelineObjectCacheStats
+{
+    uint64_t hits;
+    uint64_t misses;             // pipelines created through the cache
+    uint64_t create_ns;          // total time spent in vkCreate*Pipelines on misses
+    uint64_t max_create_ns;      // slowest single creation
+    uint64_t driver_cache_hits;  // misses the driver served from the VkPipelineCache
+} PipelineObjectCacheStats;
+
+typedef struct PipelineObjectCache
+{
+    PipelineObjectEntry**    entries;   // stretchy buffer of heap allocated entries
+    HashIndex                index;     // key hash -> entry
+    Mutex                    lock;      // guards entries, inserts into index and stats other than hits
+    PipelineObjectCacheStats stats;
+    ShaderModuleCache*       modules;   // optional, shares modules and reflection between pipelines
+    struct PipelineManifest* manifest;  // optional, records created pipelines, set after init
+} PipelineObjectCache;
+
+// modules may be NULL, every create call then builds and reflects its own modules
+void pipeline_object_cache_init(PipelineObjectCache* cache, ShaderModuleCache* modules);
+// destroys every pipeline the cache handed out
+void pipeline_object_cache_destroy(VkDevice device, PipelineObjectCache* cache);
+void pipeline_object_cache_get_stats(PipelineObjectCache* cache, PipelineObjectCacheStats* out);
+
 // ============================================================================
 // Pipeline Creation API - simple, file-path based
 // ============================================================================
+//
+// obj_cache may be NULL, the caller then owns the returned pipeline.
 
 // Creates a graphics pipeline from SPIR-V file paths.
 // Loads shaders, reflects descriptor/push-constant layout, creates pipeline.
@@ -48,23 +207,124 @@ VkPipeline create_graphics_pipeline(VkDevice                device,
                                     VkPipelineCache         cache,
                                     DescriptorLayoutCache*  desc_cache,
                                     PipelineLayoutCache*    pipe_cache,
+                                    PipelineObjectCache*    obj_cache,
                                     const char*             vert_shader_path,
                                     const char*             frag_shader_path,
                                     GraphicsPipelineConfig* config,
                                     VkPipelineLayout*       out_layout);
 
+// Same as create_graphics_pipeline with the SPIR-V already in memory.
+VkPipeline create_graphics_pipeline_from_spirv(VkDevice                device,
+                                               VkPipelineCache         cache,
+                                               DescriptorLayoutCache*  desc_cache,
+                                               PipelineLayoutCache*    pipe_cache,
+                                               PipelineObjectCache*    obj_cache,
+                                               const void*             vert_code,
+                                               size_t                  vert_size,
+                                               const void*             frag_code,
+                                               size_t                  frag_size,
+                                               GraphicsPipelineConfig* config,
+                                               VkPipelineLayout*       out_layout);
+
+// Same as create_graphics_pipeline with shaders looked up by name in an opened
+// archive. The SPIR-V is used in place and the cache key reuses the stored hashes.
+VkPipeline create_graphics_pipeline_from_archive(VkDevice                device,
+                                                 VkPipelineCache         cache,
+                                                 DescriptorLayoutCache*  desc_cache,
+                                                 PipelineLayoutCache*    pipe_cache,
+                                                 PipelineObjectCache*    obj_cache,
+                                                 const ShaderArchive*    archive,
+                                                 const char*             vert_name,
+                                                 const char*             frag_name,
+                                                 GraphicsPipelineConfig* config,
+                                                 VkPipelineLayout*       out_layout);
+
 
 void vk_cmd_set_viewport_scissor(VkCommandBuffer cmd, VkExtent2D extent);
 
 // Creates a compute pipeline from a SPIR-V file path.
 // Loads shader, reflects descriptor/push-constant layout, creates pipeline.
 // Returns pipeline handle; optionally outputs the created pipeline layout.
-VkPipeline create_compute_pipeline(VkDevice               device,
-                                   VkPipelineCache        cache,
-                                   DescriptorLayoutCache* desc_cache,
-                                   PipelineLayoutCache*   pipe_cache,
-                                   const char*            comp_shader_path,
-                                   VkPipelineLayout*      out_layout);
+// specialization may be NULL.
+VkPipeline create_compute_pipeline(VkDevice                      device,
+                                   VkPipelineCache               cache,
+                                   DescriptorLayoutCache*        desc_cache,
+                                   PipelineLayoutCache*          pipe_cache,
+                                   PipelineObjectCache*          obj_cache,
+                                   const char*                   comp_shader_path,
+                                   const PipelineSpecialization* specialization,
+                                   VkPipelineLayout*             out_layout);
+
+VkPipeline create_compute_pipeline_from_spirv(VkDevice                      device,
+                                              VkPipelineCache               cache,
+                                              DescriptorLayoutCache*        desc_cache,
+                                              PipelineLayoutCache*          pipe_cache,
+                                              PipelineObjectCache*          obj_cache,
+                                              const void*                   comp_code,
+                                              size_t                        comp_size,
+                                              const PipelineSpecialization* specialization,
+                                              VkPipelineLayout*             out_layout);
+
+VkPipeline create_compute_pipeline_from_archive(VkDevice                      device,
+                                                VkPipelineCache               cache,
+                                                DescriptorLayoutCache*        desc_cache,
+                                                PipelineLayoutCache*          pipe_cache,
+                                                PipelineObjectCache*          obj_cache,
+                                                const ShaderArchive*          archive,
+                                                const char*                   comp_name,
+                                                const PipelineSpecialization* specialization,
+                                                VkPipelineLayout*             out_layout);
+
+// ============================================================================
+// Batch compute creation
+// ============================================================================
+//
+// Creates many compute pipelines with a single vkCreateComputePipelines,
+// so the driver sees the whole set at once. Each desc names a SPIR-V file,
+// a name in an archive, or raw SPIR-V. Pipelines already in obj_cache are
+// not created again, and a permutation listed twice is created once.
+// Each result carries the workgroup size reflected from the shader, which
+// the dispatch helpers in vk_compute.h turn into group counts.
+//
+//   ComputePipelineDesc descs[] = {{.comp_path = "cull.comp.spv"}, {.comp_path = "scan.comp.spv", .specialization = &spec}};
+//   ComputePipeline     pipes[2];
+//   create_compute_pipelines(device, cache, &desc_cache, &pipe_cache, &obj_cache, descs, 2, pipes);
+
+typedef struct ComputePipelineDesc
+{
+    const char*                   comp_path;  // file, or a name in archive; NULL to use code
+    const ShaderArchive*          archive;    // optional
+    const void*                   code;       // raw SPIR-V, read when comp_path is NULL
+    size_t                        code_size;
+    const PipelineSpecialization* specialization;  // optional
+} ComputePipelineDesc;
+
+typedef struct ComputePipeline
+{
+    VkPipeline       pipeline;  // VK_NULL_HANDLE if the shader could not be loaded
+    VkPipelineLayout layout;
+    uint32_t         local_size[3];  // reflected; the shader's default when sized by local_size_*_id
+} ComputePipeline;
+
+// Ownership as for create_compute_pipeline. out must hold count entries;
+// returns how many pipelines are valid.
+uint32_t create_compute_pipelines(VkDevice                   device,
+                                  VkPipelineCache            cache,
+                                  DescriptorLayoutCache*     desc_cache,
+                                  PipelineLayoutCache*       pipe_cache,
+                                  PipelineObjectCache*       obj_cache,
+                                  const ComputePipelineDesc* descs,
+                                  uint32_t                   count,
+                                  ComputePipeline*           out);
+
+// malloc'd file contents, release with free()
+bool read_shader_file(const char* path, void** out_data, size_t* out_size);
+
+// fills cfg's vertex input from the vertex shader: attributes at binding 0, packed in reflection order
+void reflect_vertex_input(const void* vert_code, size_t vert_size, GraphicsPipelineConfig* cfg);
+
+// same, from a reflection of the vertex shader the caller already holds
+void vertex_input_from_reflection(const ShaderReflection* vert_reflect, GraphicsPipelineConfig* cfg);
 
 // ============================================================================
 // Default config helper
@@ -83,6 +343,10 @@ static inline GraphicsPipelineConfig graphics_pipeline_config_default(void)
         .color_formats          = NULL,
         .depth_format           = VK_FORMAT_UNDEFINED,
         .stencil_format         = VK_FORMAT_UNDEFINED,
+        .pipeline_flags         = 0,
+        .dynamic_state          = 0,
+        .libraries              = NULL,
+        .specialization         = NULL,
     };
 }
 
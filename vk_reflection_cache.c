@@ -0,0 +1,411 @@
+#include "vk_reflection_cache.h"
+
+// ============================================================================
+// Record encoding
+// ============================================================================
+//
+//   stage, local_size x/y/z, set_count, push_count, input_count, spec_count
+//   per set:   set_index, binding_count, binding_count x (binding, type, count)
+//   per push:  offset, size
+//   per input: location, format
+//   per spec:  constant_id, name_hash low, name_hash high
+
+typedef struct RecordReader
+{
+    const uint32_t* words;
+    uint32_t        count;
+    uint32_t        pos;
+    bool            ok;
+} RecordReader;
+
+static uint32_t read_word(RecordReader* r)
+{
+    if(r->pos >= r->count)
+    {
+        r->ok = false;
+        return 0;
+    }
+    return r->words[r->pos++];
+}
+
+// a count that must fit max, flags the record bad otherwise
+static uint32_t read_count(RecordReader* r, uint32_t max)
+{
+    uint32_t n = read_word(r);
+    if(n > max)
+        r->ok = false;
+    return r->ok ? n : 0;
+}
+
+static uint32_t* encode_record(const ShaderReflection* refl)
+{
+    uint32_t* w = NULL;
+
+    arrpush(w, (uint32_t)refl->stage);
+    arrpush(w, refl->local_size_x);
+    arrpush(w, refl->local_size_y);
+    arrpush(w, refl->local_size_z);
+    arrpush(w, refl->set_count);
+    arrpush(w, refl->push_constant_count);
+    arrpush(w, refl->vertex_input_count);
+    arrpush(w, refl->spec_constant_count);
+
+    for(uint32_t s = 0; s < refl->set_count; s++)
+    {
+        const ReflectedDescriptorSet* set = &refl->sets[s];
+        arrpush(w, set->set_index);
+        arrpush(w, set->binding_count);
+
+        for(uint32_t b = 0; b < set->binding_count; b++)
+        {
+            arrpush(w, set->bindings[b].binding);
+            arrpush(w, (uint32_t)set->bindings[b].descriptor_type);
+            arrpush(w, set->bindings[b].descriptor_count);
+        }
+    }
+
+    for(uint32_t p = 0; p < refl->push_constant_count; p++)
+    {
+        arrpush(w, refl->push_constants[p].offset);
+        arrpush(w, refl->push_constants[p].size);
+    }
+
+    for(uint32_t i = 0; i < refl->vertex_input_count; i++)
+    {
+        arrpush(w, refl->vertex_inputs[i].location);
+        arrpush(w, (uint32_t)refl->vertex_inputs[i].format);
+    }
+
+    for(uint32_t i = 0; i < refl->spec_constant_count; i++)
+    {
+        arrpush(w, refl->spec_constants[i].constant_id);
+        arrpush(w, (uint32_t)refl->spec_constants[i].name_hash);
+        arrpush(w, (uint32_t)(refl->spec_constants[i].name_hash >> 32));
+    }
+
+    return w;
+}
+
+static bool decode_record(ShaderReflection* refl, const uint32_t* words, uint32_t count)
+{
+    RecordReader r = {.words = words, .count = count, .ok = true};
+
+    memset(refl, 0, sizeof(*refl));
+    refl->stage               = (VkShaderStageFlagBits)read_word(&r);
+    refl->local_size_x        = read_word(&r);
+    refl->local_size_y        = read_word(&r);
+    refl->local_size_z        = read_word(&r);
+    refl->set_count           = read_count(&r, SHADER_REFLECT_MAX_SETS);
+    refl->push_constant_count = read_count(&r, SHADER_REFLECT_MAX_PUSH);
+    refl->vertex_input_count  = read_count(&r, SHADER_REFLECT_MAX_INPUTS);
+    refl->spec_constant_count = read_count(&r, SHADER_REFLECT_MAX_SPEC);
+
+    for(uint32_t s = 0; s < refl->set_count && r.ok; s++)
+    {
+        ReflectedDescriptorSet* set = &refl->sets[s];
+        set->set_index              = read_word(&r);
+        set->binding_count          = read_count(&r, SHADER_REFLECT_MAX_BINDINGS);
+
+        for(uint32_t b = 0; b < set->binding_count; b++)
+        {
+            ReflectedBinding* binding = &set->bindings[b];
+            binding->binding          = read_word(&r);
+            binding->descriptor_type  = (VkDescriptorType)read_word(&r);
+            binding->descriptor_count = read_word(&r);
+            binding->stage_flags      = refl->stage;
+        }
+    }
+
+    for(uint32_t p = 0; p < refl->push_constant_count; p++)
+    {
+        refl->push_constants[p].offset      = read_word(&r);
+        refl->push_constants[p].size        = read_word(&r);
+        refl->push_constants[p].stage_flags = refl->stage;
+    }
+
+    for(uint32_t i = 0; i < refl->vertex_input_count; i++)
+    {
+        refl->vertex_inputs[i].location = read_word(&r);
+        refl->vertex_inputs[i].format   = (VkFormat)read_word(&r);
+    }
+
+    for(uint32_t i = 0; i < refl->spec_constant_count; i++)
+    {
+        refl->spec_constants[i].constant_id = read_word(&r);
+
+        uint64_t lo                       = read_word(&r);
+        uint64_t hi                       = read_word(&r);
+        refl->spec_constants[i].name_hash = lo | (hi << 32);
+    }
+
+    return r.ok && r.pos == count;
+}
+
+// ============================================================================
+// File
+// ============================================================================
+
+static bool validate(const uint8_t* data, size_t size, const char* path)
+{
+    const ReflectionCacheHeader* header = (const ReflectionCacheHeader*)data;
+
+    if(size < sizeof(ReflectionCacheHeader) || header->magic != REFLECTION_CACHE_MAGIC)
+    {
+        log_error("'%s' is not a reflection cache, ignoring it", path);
+        return false;
+    }
+    if(header->version != REFLECTION_CACHE_VERSION)
+    {
+        log_info("'%s' is reflection cache version %u, expected %u, rebuilding", path, header->version, REFLECTION_CACHE_VERSION);
+        return false;
+    }
+    if(header->file_size != size
+       || header->record_count > (size - sizeof(ReflectionCacheHeader)) / sizeof(ReflectionCacheIndex))
+    {
+        log_error("'%s' is truncated, ignoring it", path);
+        return false;
+    }
+
+    const ReflectionCacheIndex* index = (const ReflectionCacheIndex*)(data + sizeof(ReflectionCacheHeader));
+    for(uint32_t i = 0; i < header->record_count; i++)
+    {
+        const ReflectionCacheIndex* e = &index[i];
+
+        bool in_bounds = e->offset % 4 == 0 && (uint64_t)e->offset + (uint64_t)e->word_count * 4 <= size;
+        bool sorted    = i == 0 || index[i - 1].hash <= e->hash;
+        if(!in_bounds || !sorted)
+        {
+            log_error("'%s' has a corrupt record %u, ignoring it", path, i);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool reflection_cache_open(ReflectionCache* cache, const char* path)
+{
+    memset(cache, 0, sizeof(*cache));
+    hash_index_init(&cache->added_index, 0);
+    mutex_init(&cache->lock);
+
+    if(!mapped_file_open(&cache->file, path, true))
+        return false;
+
+    if(!validate(cache->file.data, cache->file.size, path))
+    {
+        mapped_file_close(&cache->file);
+        return false;
+    }
+
+    cache->file_index = (const ReflectionCacheIndex*)(cache->file.data + sizeof(ReflectionCacheHeader));
+    cache->file_count = ((const ReflectionCacheHeader*)cache->file.data)->record_count;
+
+    log_info("Reflection cache '%s': %u shaders", path, cache->file_count);
+    return true;
+}
+
+void reflection_cache_close(ReflectionCache* cache)
+{
+    for(int i = 0; i < arrlen(cache->added); i++)
+    {
+        arrfree(cache->added[i]->words);
+        free(cache->added[i]);
+    }
+
+    arrfree(cache->added);
+    hash_index_destroy(&cache->added_index);
+    mutex_destroy(&cache->lock);
+    mapped_file_close(&cache->file);
+}
+
+static int compare_index(const void* a, const void* b)
+{
+    const ReflectionCacheIndex* x = a;
+    const ReflectionCacheIndex* y = b;
+
+    if(x->hash != y->hash)
+        return x->hash < y->hash ? -1 : 1;
+    if(x->code_size != y->code_size)
+        return x->code_size < y->code_size ? -1 : 1;
+    return x->offset < y->offset ? -1 : x->offset > y->offset;  // source slot, newer records sort last
+}
+
+bool reflection_cache_save(ReflectionCache* cache, const char* path)
+{
+    mutex_lock(&cache->lock);
+
+    uint32_t added_count = (uint32_t)arrlen(cache->added);
+    if(added_count == 0)
+    {
+        mutex_unlock(&cache->lock);
+        return true;
+    }
+
+    // old and new records share one sorted index; offset temporarily holds the source slot
+    uint32_t              count = cache->file_count + added_count;
+    ReflectionCacheIndex* index = malloc(count * sizeof(ReflectionCacheIndex));
+
+    for(uint32_t i = 0; i < cache->file_count; i++)
+    {
+        index[i]        = cache->file_index[i];
+        index[i].offset = i;
+    }
+    for(uint32_t i = 0; i < added_count; i++)
+    {
+        index[cache->file_count + i]        = cache->added[i]->index;
+        index[cache->file_count + i].offset = cache->file_count + i;
+    }
+
+    qsort(index, count, sizeof(ReflectionCacheIndex), compare_index);
+
+    // a record that failed to decode from disk was reflected again, keep only the newer copy
+    uint32_t unique = 0;
+    for(uint32_t i = 0; i < count; i++)
+    {
+        bool superseded = i + 1 < count && index[i + 1].hash == index[i].hash && index[i + 1].code_size == index[i].code_size;
+        if(!superseded)
+            index[unique++] = index[i];
+    }
+    count = unique;
+
+    // header | index | records, one part per record
+    const void** parts      = malloc((count + 2) * sizeof(void*));
+    size_t*      part_sizes = malloc((count + 2) * sizeof(size_t));
+    uint64_t     offset     = sizeof(ReflectionCacheHeader) + (uint64_t)count * sizeof(ReflectionCacheIndex);
+
+    for(uint32_t i = 0; i < count; i++)
+    {
+        uint32_t        slot  = index[i].offset;
+        const uint32_t* words = slot < cache->file_count
+                                    ? (const uint32_t*)(cache->file.data + cache->file_index[slot].offset)
+                                    : cache->added[slot - cache->file_count]->words;
+
+        parts[i + 2]      = words;
+        part_sizes[i + 2] = index[i].word_count * sizeof(uint32_t);
+        index[i].offset   = (uint32_t)offset;
+        offset += part_sizes[i + 2];
+    }
+
+    ReflectionCacheHeader header = {
+        .magic        = REFLECTION_CACHE_MAGIC,
+        .version      = REFLECTION_CACHE_VERSION,
+        .record_count = count,
+        .file_size    = offset,
+    };
+
+    parts[0]      = &header;
+    part_sizes[0] = sizeof(header);
+    parts[1]      = index;
+    part_sizes[1] = count * sizeof(ReflectionCacheIndex);
+
+    // the mapping stays valid after the rename replaced the file
+    bool ok = offset <= UINT32_MAX && write_file_atomic(path, parts, part_sizes, count + 2);
+
+    mutex_unlock(&cache->lock);
+
+    if(ok)
+        log_info("Reflection cache '%s': saved %u shaders (%u new)", path, count, added_count);
+
+    free(parts);
+    free(part_sizes);
+    free(index);
+    return ok;
+}
+
+// ============================================================================
+// Lookup
+// ============================================================================
+
+static bool record_matches(const void* value, const void* key)
+{
+    const ReflectionCacheIndex* a = &((const ReflectionCacheRecord*)value)->index;
+    const ReflectionCacheIndex* b = key;
+
+    return a->hash == b->hash && a->code_size == b->code_size;
+}
+
+static const ReflectionCacheIndex* find_in_file(const ReflectionCache* cache, Hash64 hash, uint64_t code_size)
+{
+    uint32_t lo = 0;
+    uint32_t hi = cache->file_count;
+    while(lo < hi)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if(cache->file_index[mid].hash < hash)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    for(uint32_t i = lo; i < cache->file_count && cache->file_index[i].hash == hash; i++)
+    {
+        if(cache->file_index[i].code_size == code_size)
+            return &cache->file_index[i];
+    }
+
+    return NULL;
+}
+
+bool shader_reflect_create_cached(ReflectionCache* cache, ShaderReflection* reflection, const void* code, size_t size, Hash64 hash)
+{
+    ReflectionCacheIndex key = {.hash = hash, .code_size = size};
+
+    // Warm path: decode without touching SPIRV-Reflect
+    const ReflectionCacheIndex* on_disk = find_in_file(cache, hash, size);
+    if(on_disk && decode_record(reflection, (const uint32_t*)(cache->file.data + on_disk->offset), on_disk->word_count))
+    {
+        ATOMIC_FETCH_ADD(&cache->stats.hits, 1);
+        return true;
+    }
+
+    const ReflectionCacheRecord* added = hash_index_find(&cache->added_index, hash, record_matches, &key);
+    if(added && decode_record(reflection, added->words, added->index.word_count))
+    {
+        ATOMIC_FETCH_ADD(&cache->stats.hits, 1);
+        return true;
+    }
+
+    // Cold path: reflect and remember the result for the next save
+    uint64_t start = time_now_ns();
+    if(!shader_reflect_create(reflection, code, size))
+        return false;
+    uint64_t elapsed = time_now_ns() - start;
+
+    ReflectionCacheRecord* record = malloc(sizeof(ReflectionCacheRecord));
+    record->words                 = encode_record(reflection);
+    record->index                 = key;
+    record->index.word_count      = (uint32_t)arrlen(record->words);
+
+    mutex_lock(&cache->lock);
+
+    cache->stats.misses++;
+    cache->stats.reflect_ns += elapsed;
+
+    bool exists = hash_index_find(&cache->added_index, hash, record_matches, &key) != NULL;
+    if(!exists)
+    {
+        arrpush(cache->added, record);
+        hash_index_insert(&cache->added_index, hash, record);
+    }
+
+    mutex_unlock(&cache->lock);
+
+    if(exists)
+    {
+        arrfree(record->words);
+        free(record);
+    }
+
+    return true;
+}
+
+void reflection_cache_get_stats(ReflectionCache* cache, ReflectionCacheStats* out)
+{
+    mutex_lock(&cache->lock);
+    out->misses     = cache->stats.misses;
+    out->reflect_ns = cache->stats.reflect_ns;
+    mutex_unlock(&cache->lock);
+
+    out->hits = ATOMIC_LOAD_RELAXED(&cache->stats.hits);
+}
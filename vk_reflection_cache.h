@@ -0,0 +1,92 @@
+#ifndef VK_REFLECTION_CACHE_H_
+#define VK_REFLECTION_CACHE_H_
+
+#include "vk_defaults.h"
+#include "vk_file.h"
+#include "vk_hashmap.h"
+#include "vk_shader_reflect.h"
+#include "vk_thread.h"
+
+/* ------------------ Persistent reflection cache ------------------ */
+//
+// Keeps what pipeline creation needs from SPIRV-Reflect on disk, keyed
+// by the XXH64 and size of each shader's SPIR-V. This covers stage,
+// local size, descriptor bindings, push constant ranges, vertex input
+// formats and specialization constant IDs. The file is mmapped once at
+// startup, so on a warm run no shader goes through SPIRV-Reflect at all.
+//
+//   ReflectionCache reflections;
+//   reflection_cache_open(&reflections, "reflection.cache");
+//   shader_module_cache_init(&modules, device, inline_code, &reflections);
+//   ...create pipelines...
+//   reflection_cache_save(&reflections, "reflection.cache");  // only writes if something new was reflected
+//   reflection_cache_close(&reflections);
+//
+// Reflections decoded from the cache carry no names and no SPIRV-Reflect
+// module. They are good for layouts, vertex input and specialization
+// (constants are matched by name hash), so debug tools that need names
+// should call shader_reflect_create directly. Bump REFLECTION_CACHE_VERSION
+// whenever shader_reflect_create changes what it extracts. A file with
+// another version is ignored and rewritten on save.
+
+#define REFLECTION_CACHE_MAGIC 0x43524B56u  // "VKRC"
+#define REFLECTION_CACHE_VERSION 2
+
+typedef struct ReflectionCacheHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t record_count;
+    uint32_t reserved;
+    uint64_t file_size;
+} ReflectionCacheHeader;
+
+// index entry, sorted by hash; records are streams of uint32_t words
+typedef struct ReflectionCacheIndex
+{
+    Hash64   hash;       // XXH64 of the SPIR-V
+    uint64_t code_size;  // SPIR-V size in bytes, guards against hash collisions
+    uint32_t offset;     // record offset from the start of the file
+    uint32_t word_count;
+} ReflectionCacheIndex;
+
+// a record reflected during this run, not yet on disk
+typedef struct ReflectionCacheRecord
+{
+    ReflectionCacheIndex index;  // offset unused
+    uint32_t*            words;
+} ReflectionCacheRecord;
+
+typedef struct ReflectionCacheStats
+{
+    uint64_t hits;        // served without SPIRV-Reflect
+    uint64_t misses;      // went through SPIRV-Reflect
+    uint64_t reflect_ns;  // time spent in SPIRV-Reflect on misses
+} ReflectionCacheStats;
+
+typedef struct ReflectionCache
+{
+    MappedFile                  file;  // warm records, read-only
+    const ReflectionCacheIndex* file_index;
+    uint32_t                    file_count;
+
+    ReflectionCacheRecord** added;        // stretchy buffer of heap allocated records
+    HashIndex               added_index;  // hash -> record
+
+    Mutex                lock;  // guards added, inserts into added_index and stats other than hits
+    ReflectionCacheStats stats;
+} ReflectionCache;
+
+// false if path is missing or unusable, the cache then starts out empty
+bool reflection_cache_open(ReflectionCache* cache, const char* path);
+void reflection_cache_close(ReflectionCache* cache);
+
+// writes the file back if this run reflected anything new
+bool reflection_cache_save(ReflectionCache* cache, const char* path);
+
+// shader_reflect_create through the cache; hash is hash64_bytes(code, size)
+bool shader_reflect_create_cached(ReflectionCache* cache, ShaderReflection* reflection, const void* code, size_t size, Hash64 hash);
+
+void reflection_cache_get_stats(ReflectionCache* cache, ReflectionCacheStats* out);
+
+#endif // VK_REFLECTION_CACHE_H_
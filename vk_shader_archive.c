@@ -0,0 +1,97 @@
+#include "vk_shader_archive.h"
+
+// every offset and size comes from disk, check them once here so lookups can trust them
+static bool validate(const uint8_t* data, size_t size, const char* path)
+{
+    const ShaderArchiveHeader* header = (const ShaderArchiveHeader*)data;
+
+    if(size < sizeof(ShaderArchiveHeader) || header->magic != SHADER_ARCHIVE_MAGIC)
+    {
+        log_error("'%s' is not a shader archive", path);
+        return false;
+    }
+    if(header->version != SHADER_ARCHIVE_VERSION)
+    {
+        log_error("'%s' is shader archive version %u, expected %u", path, header->version, SHADER_ARCHIVE_VERSION);
+        return false;
+    }
+    if(header->file_size != size
+       || header->entry_count > (size - sizeof(ShaderArchiveHeader)) / sizeof(ShaderArchiveEntry))
+    {
+        log_error("'%s' is truncated", path);
+        return false;
+    }
+
+    const ShaderArchiveEntry* entries = (const ShaderArchiveEntry*)(data + sizeof(ShaderArchiveHeader));
+    for(uint32_t i = 0; i < header->entry_count; i++)
+    {
+        const ShaderArchiveEntry* e = &entries[i];
+
+        bool blob_ok = e->offset % SHADER_ARCHIVE_ALIGN == 0 && e->size % 4 == 0 && e->size > 0
+                       && (uint64_t)e->offset + e->size <= size;
+        bool name_ok = (uint64_t)e->name_offset + e->name_length < size && data[e->name_offset + e->name_length] == '\0';
+        bool sorted  = i == 0 || entries[i - 1].name_hash <= e->name_hash;
+
+        if(!blob_ok || !name_ok || !sorted)
+        {
+            log_error("'%s' has a corrupt entry %u", path, i);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool shader_archive_open(ShaderArchive* archive, const char* path)
+{
+    memset(archive, 0, sizeof(*archive));
+
+    if(!mapped_file_open(&archive->file, path, false))
+        return false;
+
+    if(!validate(archive->file.data, archive->file.size, path))
+    {
+        mapped_file_close(&archive->file);
+        return false;
+    }
+
+    archive->entries     = (const ShaderArchiveEntry*)(archive->file.data + sizeof(ShaderArchiveHeader));
+    archive->entry_count = ((const ShaderArchiveHeader*)archive->file.data)->entry_count;
+
+    log_info("Shader archive '%s': %u shaders, %zu bytes", path, archive->entry_count, archive->file.size);
+    return true;
+}
+
+void shader_archive_close(ShaderArchive* archive)
+{
+    mapped_file_close(&archive->file);
+    memset(archive, 0, sizeof(*archive));
+}
+
+const ShaderArchiveEntry* shader_archive_find(const ShaderArchive* archive, const char* name)
+{
+    size_t length = strlen(name);
+    Hash64 hash   = hash64_bytes(name, length);
+
+    // lower bound of hash
+    uint32_t lo = 0;
+    uint32_t hi = archive->entry_count;
+    while(lo < hi)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if(archive->entries[mid].name_hash < hash)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    // names decide between colliding hashes
+    for(uint32_t i = lo; i < archive->entry_count && archive->entries[i].name_hash == hash; i++)
+    {
+        const ShaderArchiveEntry* e = &archive->entries[i];
+        if(e->name_length == length && memcmp(shader_archive_name(archive, e), name, length) == 0)
+            return e;
+    }
+
+    return NULL;
+}
@@ -0,0 +1,71 @@
+#ifndef VK_SHADER_ARCHIVE_H_
+#define VK_SHADER_ARCHIVE_H_
+
+#include "vk_defaults.h"
+#include "vk_file.h"
+
+/* ------------------ Packed shader archive ------------------ */
+//
+// All of compiledshaders/ in one file, packed by tools/shader_pack
+// (`make shaders`). The archive is mmapped once at startup, and pipeline
+// creation then takes SPIR-V pointers straight out of the mapping. There
+// is no fopen, malloc or fread per pipeline.
+//
+//   header | entries sorted by name hash | names | SPIR-V blobs
+//
+// Every blob starts on a SHADER_ARCHIVE_ALIGN boundary, so it can go
+// directly into VkShaderModuleCreateInfo::pCode. Each entry carries the
+// XXH64 of its code (hash64_bytes), which the pipeline caches reuse as
+// the shader hash instead of hashing the blob again. Shaders are looked
+// up by file name, e.g. "tri.vert.spv".
+//
+// Integers are stored in the byte order of the packing machine.
+
+#define SHADER_ARCHIVE_MAGIC 0x41534B56u  // "VKSA"
+#define SHADER_ARCHIVE_VERSION 1
+#define SHADER_ARCHIVE_ALIGN 8
+
+typedef struct ShaderArchiveHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entry_count;
+    uint32_t reserved;
+    uint64_t file_size;
+} ShaderArchiveHeader;
+
+typedef struct ShaderArchiveEntry
+{
+    Hash64   name_hash;    // XXH64 of the name, the sort key
+    Hash64   code_hash;    // XXH64 of the SPIR-V
+    uint32_t offset;       // blob offset from the start of the file
+    uint32_t size;         // blob size in bytes, a multiple of 4
+    uint32_t name_offset;  // nul terminated name, offset from the start of the file
+    uint32_t name_length;  // without the terminator
+} ShaderArchiveEntry;
+
+typedef struct ShaderArchive
+{
+    MappedFile                file;
+    const ShaderArchiveEntry* entries;
+    uint32_t                  entry_count;
+} ShaderArchive;
+
+// maps and validates path, false if it is missing or malformed
+bool shader_archive_open(ShaderArchive* archive, const char* path);
+void shader_archive_close(ShaderArchive* archive);
+
+// binary search on the name hash, NULL if name is not in the archive
+const ShaderArchiveEntry* shader_archive_find(const ShaderArchive* archive, const char* name);
+
+static inline const void* shader_archive_code(const ShaderArchive* archive, const ShaderArchiveEntry* entry)
+{
+    return archive->file.data + entry->offset;
+}
+
+static inline const char* shader_archive_name(const ShaderArchive* archive, const ShaderArchiveEntry* entry)
+{
+    return (const char*)archive->file.data + entry->name_offset;
+}
+
+#endif // VK_SHADER_ARCHIVE_H_
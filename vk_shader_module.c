@@ -0,0 +1,145 @@
+#include "vk_shader_module.h"
+
+typedef struct ShaderModuleKey
+{
+    Hash64      hash;
+    size_t      size;
+    const void* code;
+} ShaderModuleKey;
+
+static bool module_entry_matches(const void* value, const void* key)
+{
+    const ShaderModuleEntry* a = value;
+    const ShaderModuleKey*   b = key;
+
+    // a 64 bit hash collision would hand out the wrong module, so confirm the bytes
+    return a->hash == b->hash && a->size == b->size && memcmp(a->code, b->code, b->size) == 0;
+}
+
+static void destroy_entry(VkDevice device, ShaderModuleEntry* entry)
+{
+    if(entry->module != VK_NULL_HANDLE)
+        vkDestroyShaderModule(device, entry->module, NULL);
+    if(entry->reflected)
+        shader_reflect_destroy(&entry->reflection);
+
+    free(entry->code);
+    free(entry);
+}
+
+bool shader_module_inline_supported(VkPhysicalDevice physical_device)
+{
+    VkPhysicalDeviceMaintenance5FeaturesKHR maintenance5_features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MAINTENANCE_5_FEATURES_KHR,
+    };
+
+    VkPhysicalDeviceFeatures2 features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+        .pNext = &maintenance5_features,
+    };
+
+    vkGetPhysicalDeviceFeatures2(physical_device, &features);
+
+    return maintenance5_features.maintenance5;
+}
+
+void shader_module_cache_init(ShaderModuleCache* cache, VkDevice device, bool inline_code, ReflectionCache* reflections)
+{
+    memset(cache, 0, sizeof(*cache));
+    cache->device      = device;
+    cache->inline_code = inline_code;
+    cache->reflections = reflections;
+    hash_index_init(&cache->index, 0);
+    mutex_init(&cache->lock);
+}
+
+void shader_module_cache_destroy(ShaderModuleCache* cache)
+{
+    for(int i = 0; i < arrlen(cache->entries); i++)
+        destroy_entry(cache->device, cache->entries[i]);
+
+    arrfree(cache->entries);
+    hash_index_destroy(&cache->index);
+    mutex_destroy(&cache->lock);
+}
+
+const ShaderModuleEntry* shader_module_cache_get(ShaderModuleCache* cache, const void* code, size_t size, const Hash64* hash)
+{
+    ShaderModuleKey key = {
+        .hash = hash ? *hash : hash64_bytes(code, size),
+        .size = size,
+        .code = code,
+    };
+
+    ShaderModuleEntry* hit = hash_index_find(&cache->index, key.hash, module_entry_matches, &key);
+    if(hit)
+    {
+        ATOMIC_FETCH_ADD(&cache->stats.hits, 1);
+        return hit;
+    }
+
+    // Miss: module and reflection are built outside the lock
+    ShaderModuleEntry* entry = calloc(1, sizeof(ShaderModuleEntry));
+    entry->hash              = key.hash;
+    entry->size              = size;
+    entry->reflected         = cache->reflections
+                                   ? shader_reflect_create_cached(cache->reflections, &entry->reflection, code, size, key.hash)
+                                   : shader_reflect_create(&entry->reflection, code, size);
+
+    // the caller's buffer may be gone by the next lookup
+    entry->code = malloc(size);
+    memcpy(entry->code, code, size);
+
+    entry->create_info = (VkShaderModuleCreateInfo){
+        .sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+        .codeSize = size,
+        .pCode    = entry->code,
+    };
+
+    if(!cache->inline_code)
+        VK_CHECK(vkCreateShaderModule(cache->device, &entry->create_info, NULL, &entry->module));
+
+    mutex_lock(&cache->lock);
+
+    ShaderModuleEntry* existing = hash_index_find(&cache->index, key.hash, module_entry_matches, &key);
+    if(!existing)
+    {
+        cache->stats.misses++;
+        cache->stats.bytes += size;
+
+        arrpush(cache->entries, entry);
+        hash_index_insert(&cache->index, key.hash, entry);
+    }
+
+    mutex_unlock(&cache->lock);
+
+    if(existing)
+    {
+        destroy_entry(cache->device, entry);
+        ATOMIC_FETCH_ADD(&cache->stats.hits, 1);
+        return existing;
+    }
+
+    return entry;
+}
+
+VkPipelineShaderStageCreateInfo shader_module_stage_info(const ShaderModuleEntry* entry, VkShaderStageFlagBits stage)
+{
+    return (VkPipelineShaderStageCreateInfo){
+        .sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+        .pNext  = entry->module == VK_NULL_HANDLE ? &entry->create_info : NULL,
+        .stage  = stage,
+        .module = entry->module,
+        .pName  = "main",
+    };
+}
+
+void shader_module_cache_get_stats(ShaderModuleCache* cache, ShaderModuleCacheStats* out)
+{
+    mutex_lock(&cache->lock);
+    out->misses = cache->stats.misses;
+    out->bytes  = cache->stats.bytes;
+    mutex_unlock(&cache->lock);
+
+    out->hits = ATOMIC_LOAD_RELAXED(&cache->stats.hits);
+}
@@ -0,0 +1,75 @@
+#ifndef VK_SHADER_MODULE_H_
+#define VK_SHADER_MODULE_H_
+
+#include "vk_defaults.h"
+#include "vk_hashmap.h"
+#include "vk_reflection_cache.h"
+#include "vk_shader_reflect.h"
+#include "vk_thread.h"
+
+/* ------------------ Shader module cache ------------------ */
+//
+// Pipelines sharing shaders share one VkShaderModule and one reflection.
+// Entries are keyed by the XXH64 of the SPIR-V (hash64_bytes, or the hash
+// stored in a shader archive), so every create path that sees the same
+// code lands on the same entry. Each entry keeps a copy of its SPIR-V and
+// a hit compares the bytes, so a hash collision is a miss rather than the
+// wrong module. Lookups are lock-free. A miss creates the module and
+// reflects outside the lock, and the losing thread drops its copy if two
+// threads race.
+//
+// With inline_code set (VK_KHR_maintenance5, see shader_module_inline_supported)
+// no modules are created at all, and shader_module_stage_info chains the
+// entry's VkShaderModuleCreateInfo into the stage instead.
+//
+//   ShaderModuleCache modules;
+//   shader_module_cache_init(&modules, device, shader_module_inline_supported(physical_device), &reflections);
+//   pipeline_object_cache_init(&obj_cache, &modules);  // create_*_pipeline now go through it
+//
+// Entries live until shader_module_cache_destroy. With a ReflectionCache
+// (may be NULL) misses reflect through it, see vk_reflection_cache.h.
+
+typedef struct ShaderModuleEntry
+{
+    Hash64                   hash;  // XXH64 of the SPIR-V
+    size_t                   size;
+    VkShaderModule           module;       // VK_NULL_HANDLE with inline_code
+    uint32_t*                code;         // owned copy, compared on hits
+    VkShaderModuleCreateInfo create_info;  // chained into the stage with inline_code
+    bool                     reflected;    // false if reflection failed
+    ShaderReflection         reflection;
+} ShaderModuleEntry;
+
+typedef struct ShaderModuleCacheStats
+{
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t bytes;  // SPIR-V behind all entries
+} ShaderModuleCacheStats;
+
+typedef struct ShaderModuleCache
+{
+    VkDevice               device;
+    bool                   inline_code;
+    ReflectionCache*       reflections;  // optional persistent reflection
+    ShaderModuleEntry**    entries;  // stretchy buffer of heap allocated entries
+    HashIndex              index;    // code hash -> entry
+    Mutex                  lock;     // guards entries, inserts into index and stats other than hits
+    ShaderModuleCacheStats stats;
+} ShaderModuleCache;
+
+// maintenance5 lets pipelines take SPIR-V without a VkShaderModule
+bool shader_module_inline_supported(VkPhysicalDevice physical_device);
+
+void shader_module_cache_init(ShaderModuleCache* cache, VkDevice device, bool inline_code, ReflectionCache* reflections);
+void shader_module_cache_destroy(ShaderModuleCache* cache);
+
+// entry for code, created on a miss; hash may be NULL to hash code here
+const ShaderModuleEntry* shader_module_cache_get(ShaderModuleCache* cache, const void* code, size_t size, const Hash64* hash);
+
+// stage info for entry, valid while the cache is
+VkPipelineShaderStageCreateInfo shader_module_stage_info(const ShaderModuleEntry* entry, VkShaderStageFlagBits stage);
+
+void shader_module_cache_get_stats(ShaderModuleCache* cache, ShaderModuleCacheStats* out);
+
+#endif // VK_SHADER_MODULE_H_
@@ -0,0 +1,297 @@
+#include "vk_shader_object.h"
+
+// set layouts and push ranges every stage of one program is created with
+typedef struct ShaderObjectInterface
+{
+    VkDescriptorSetLayout set_layouts[SHADER_REFLECT_MAX_SETS];
+    uint32_t              set_layout_count;
+    MergedReflection      merged;
+} ShaderObjectInterface;
+
+static bool reflect_interface(VkDevice                device,
+                              DescriptorLayoutCache*  desc_cache,
+                              PipelineLayoutCache*    pipe_cache,
+                              ReflectionCache*        reflection_cache,
+                              const void* const*      codes,
+                              const size_t*           sizes,
+                              uint32_t                count,
+                              ShaderObjectInterface*  iface,
+                              VkPipelineLayout*       out_layout,
+                              GraphicsPipelineConfig* cfg)
+{
+    ShaderReflection reflections[2];
+    for(uint32_t i = 0; i < count; i++)
+    {
+        bool ok = reflection_cache ? shader_reflect_create_cached(reflection_cache, &reflections[i], codes[i], sizes[i],
+                                                                  hash64_bytes(codes[i], sizes[i]))
+                                   : shader_reflect_create(&reflections[i], codes[i], sizes[i]);
+        if(!ok)
+        {
+            for(uint32_t j = 0; j < i; j++)
+                shader_reflect_destroy(&reflections[j]);
+            return false;
+        }
+    }
+
+    shader_reflect_merge(&iface->merged, reflections, count);
+    shader_reflect_create_set_layouts(device, desc_cache, &iface->merged, iface->set_layouts, &iface->set_layout_count);
+
+    *out_layout = pipeline_layout_cache_get(device, pipe_cache, iface->set_layouts, iface->set_layout_count,
+                                            iface->merged.push_constants, iface->merged.push_constant_count);
+
+    // vertex input from the vertex reflection we already hold, cfg is NULL for compute
+    if(cfg)
+        vertex_input_from_reflection(&reflections[0], cfg);
+
+    for(uint32_t i = 0; i < count; i++)
+        shader_reflect_destroy(&reflections[i]);
+
+    return true;
+}
+
+static VkShaderCreateInfoEXT shader_info(const ShaderObjectInterface* iface,
+                                         VkShaderStageFlagBits        stage,
+                                         VkShaderStageFlags           next_stage,
+                                         VkShaderCreateFlagsEXT       flags,
+                                         const void*                  code,
+                                         size_t                       size)
+{
+    return (VkShaderCreateInfoEXT){
+        .sType                  = VK_STRUCTURE_TYPE_SHADER_CREATE_INFO_EXT,
+        .flags                  = flags,
+        .stage                  = stage,
+        .nextStage              = next_stage,
+        .codeType               = VK_SHADER_CODE_TYPE_SPIRV_EXT,
+        .codeSize               = size,
+        .pCode                  = code,
+        .pName                  = "main",
+        .setLayoutCount         = iface->set_layout_count,
+        .pSetLayouts            = iface->set_layouts,
+        .pushConstantRangeCount = iface->merged.push_constant_count,
+        .pPushConstantRanges    = iface->merged.push_constants,
+    };
+}
+
+bool shader_object_supported(VkPhysicalDevice physical_device)
+{
+    VkPhysicalDeviceShaderObjectFeaturesEXT shader_object_features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_OBJECT_FEATURES_EXT,
+    };
+
+    VkPhysicalDeviceFeatures2 features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+        .pNext = &shader_object_features,
+    };
+
+    vkGetPhysicalDeviceFeatures2(physical_device, &features);
+
+    return shader_object_features.shaderObject;
+}
+
+bool shader_object_create_graphics(VkDevice                device,
+                                   DescriptorLayoutCache*  desc_cache,
+                                   PipelineLayoutCache*    pipe_cache,
+                                   ReflectionCache*        reflections,
+                                   const char*             vert_path,
+                                   const char*             frag_path,
+                                   GraphicsPipelineConfig* cfg,
+                                   ShaderObjectProgram*    out)
+{
+    memset(out, 0, sizeof(*out));
+
+    void*  vert_code = NULL;
+    size_t vert_size = 0;
+    void*  frag_code = NULL;
+    size_t frag_size = 0;
+
+    if(!read_shader_file(vert_path, &vert_code, &vert_size))
+        return false;
+    if(!read_shader_file(frag_path, &frag_code, &frag_size))
+    {
+        free(vert_code);
+        return false;
+    }
+
+    const void*           codes[2] = {vert_code, frag_code};
+    const size_t          sizes[2] = {vert_size, frag_size};
+    ShaderObjectInterface iface;
+
+    bool ok = reflect_interface(device, desc_cache, pipe_cache, reflections, codes, sizes, 2, &iface, &out->layout, cfg);
+    if(ok)
+    {
+        VkShaderCreateInfoEXT infos[2] = {
+            shader_info(&iface, VK_SHADER_STAGE_VERTEX_BIT, VK_SHADER_STAGE_FRAGMENT_BIT, VK_SHADER_CREATE_LINK_STAGE_BIT_EXT, vert_code, vert_size),
+            shader_info(&iface, VK_SHADER_STAGE_FRAGMENT_BIT, 0, VK_SHADER_CREATE_LINK_STAGE_BIT_EXT, frag_code, frag_size),
+        };
+
+        VK_CHECK(vkCreateShadersEXT(device, 2, infos, NULL, out->shaders));
+
+        out->stage_count = 2;
+        out->stages[0]   = VK_SHADER_STAGE_VERTEX_BIT;
+        out->stages[1]   = VK_SHADER_STAGE_FRAGMENT_BIT;
+    }
+    else
+    {
+        log_error("shader object: reflection failed for '%s' / '%s'", vert_path, frag_path);
+    }
+
+    free(vert_code);
+    free(frag_code);
+    return ok;
+}
+
+bool shader_object_create_compute(VkDevice               device,
+                                  DescriptorLayoutCache* desc_cache,
+                                  PipelineLayoutCache*   pipe_cache,
+                                  ReflectionCache*       reflections,
+                                  const char*            comp_path,
+                                  ShaderObjectProgram*   out)
+{
+    memset(out, 0, sizeof(*out));
+
+    void*  comp_code = NULL;
+    size_t comp_size = 0;
+    if(!read_shader_file(comp_path, &comp_code, &comp_size))
+        return false;
+
+    const void*           codes[1] = {comp_code};
+    const size_t          sizes[1] = {comp_size};
+    ShaderObjectInterface iface;
+
+    bool ok = reflect_interface(device, desc_cache, pipe_cache, reflections, codes, sizes, 1, &iface, &out->layout, NULL);
+    if(ok)
+    {
+        VkShaderCreateInfoEXT info = shader_info(&iface, VK_SHADER_STAGE_COMPUTE_BIT, 0, 0, comp_code, comp_size);
+        VK_CHECK(vkCreateShadersEXT(device, 1, &info, NULL, out->shaders));
+
+        out->stage_count = 1;
+        out->stages[0]   = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    else
+    {
+        log_error("shader object: reflection failed for '%s'", comp_path);
+    }
+
+    free(comp_code);
+    return ok;
+}
+
+void shader_object_destroy(VkDevice device, ShaderObjectProgram* prog)
+{
+    for(uint32_t i = 0; i < prog->stage_count; i++)
+        vkDestroyShaderEXT(device, prog->shaders[i], NULL);
+
+    memset(prog, 0, sizeof(*prog));
+}
+
+void shader_object_cmd_bind(VkCommandBuffer cmd, const ShaderObjectProgram* prog)
+{
+    vkCmdBindShadersEXT(cmd, prog->stage_count, prog->stages, prog->shaders);
+
+    if(prog->stages[0] == VK_SHADER_STAGE_COMPUTE_BIT)
+        return;
+
+    // stages this program does not use must not keep whatever was bound before
+    VkShaderStageFlagBits null_stages[3];
+    VkShaderEXT           null_shaders[3] = {VK_NULL_HANDLE, VK_NULL_HANDLE, VK_NULL_HANDLE};
+    uint32_t              null_count      = 0;
+
+    if(SHADER_OBJECT_NULL_STAGES & VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT)
+        null_stages[null_count++] = VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+    if(SHADER_OBJECT_NULL_STAGES & VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT)
+        null_stages[null_count++] = VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+    if(SHADER_OBJECT_NULL_STAGES & VK_SHADER_STAGE_GEOMETRY_BIT)
+        null_stages[null_count++] = VK_SHADER_STAGE_GEOMETRY_BIT;
+
+    if(null_count)
+        vkCmdBindShadersEXT(cmd, null_count, null_stages, null_shaders);
+}
+
+void shader_object_cmd_set_state(VkCommandBuffer cmd, const GraphicsPipelineConfig* cfg, VkExtent2D extent)
+{
+    // Viewport and scissor
+    VkViewport viewport = {
+        .width    = (float)extent.width,
+        .height   = (float)extent.height,
+        .minDepth = 0.0f,
+        .maxDepth = 1.0f,
+    };
+    VkRect2D scissor = {.extent = extent};
+
+    vkCmdSetViewportWithCount(cmd, 1, &viewport);
+    vkCmdSetScissorWithCount(cmd, 1, &scissor);
+
+    // Vertex input and input assembly
+    VkVertexInputBindingDescription2EXT   bindings[ARRAY_COUNT(cfg->vertex_bindings)];
+    VkVertexInputAttributeDescription2EXT attributes[ARRAY_COUNT(cfg->vertex_attributes)];
+    assert(cfg->vertex_binding_count <= ARRAY_COUNT(bindings));
+    assert(cfg->vertex_attribute_count <= ARRAY_COUNT(attributes));
+
+    for(uint32_t i = 0; i < cfg->vertex_binding_count; i++)
+    {
+        bindings[i] = (VkVertexInputBindingDescription2EXT){
+            .sType     = VK_STRUCTURE_TYPE_VERTEX_INPUT_BINDING_DESCRIPTION_2_EXT,
+            .binding   = cfg->vertex_bindings[i].binding,
+            .stride    = cfg->vertex_bindings[i].stride,
+            .inputRate = cfg->vertex_bindings[i].inputRate,
+            .divisor   = 1,
+        };
+    }
+
+    for(uint32_t i = 0; i < cfg->vertex_attribute_count; i++)
+    {
+        attributes[i] = (VkVertexInputAttributeDescription2EXT){
+            .sType    = VK_STRUCTURE_TYPE_VERTEX_INPUT_ATTRIBUTE_DESCRIPTION_2_EXT,
+            .location = cfg->vertex_attributes[i].location,
+            .binding  = cfg->vertex_attributes[i].binding,
+            .format   = cfg->vertex_attributes[i].format,
+            .offset   = cfg->vertex_attributes[i].offset,
+        };
+    }
+
+    vkCmdSetVertexInputEXT(cmd, cfg->vertex_binding_count, bindings, cfg->vertex_attribute_count, attributes);
+    vkCmdSetPrimitiveTopology(cmd, cfg->topology);
+    vkCmdSetPrimitiveRestartEnable(cmd, VK_FALSE);
+
+    // Rasterization
+    vkCmdSetRasterizerDiscardEnable(cmd, VK_FALSE);
+    vkCmdSetDepthClampEnableEXT(cmd, VK_FALSE);  // required whenever depthClamp is enabled on the device
+    vkCmdSetPolygonModeEXT(cmd, cfg->polygon_mode);
+    vkCmdSetCullMode(cmd, cfg->cull_mode);
+    vkCmdSetFrontFace(cmd, cfg->front_face);
+    vkCmdSetDepthBiasEnable(cmd, VK_FALSE);
+    vkCmdSetLineWidth(cmd, 1.0f);
+
+    // Multisample
+    VkSampleMask sample_mask = ~0u;
+    vkCmdSetRasterizationSamplesEXT(cmd, VK_SAMPLE_COUNT_1_BIT);
+    vkCmdSetSampleMaskEXT(cmd, VK_SAMPLE_COUNT_1_BIT, &sample_mask);
+    vkCmdSetAlphaToCoverageEnableEXT(cmd, VK_FALSE);
+    vkCmdSetAlphaToOneEnableEXT(cmd, VK_FALSE);  // required whenever alphaToOne is enabled on the device
+
+    // Depth/stencil
+    vkCmdSetDepthTestEnable(cmd, cfg->depth_test_enable);
+    vkCmdSetDepthWriteEnable(cmd, cfg->depth_write_enable);
+    vkCmdSetDepthCompareOp(cmd, VK_COMPARE_OP_LESS);
+    vkCmdSetDepthBoundsTestEnable(cmd, VK_FALSE);
+    vkCmdSetStencilTestEnable(cmd, VK_FALSE);
+
+    // Color blend, same as the pipeline path: blending off, all channels written
+    vkCmdSetLogicOpEnableEXT(cmd, VK_FALSE);  // required whenever logicOp is enabled on the device
+
+    if(cfg->color_attachment_count)
+    {
+        assert(cfg->color_attachment_count <= PIPELINE_OBJECT_MAX_COLOR_FORMATS);
+
+        VkBool32              blend_enable[PIPELINE_OBJECT_MAX_COLOR_FORMATS];
+        VkColorComponentFlags write_mask[PIPELINE_OBJECT_MAX_COLOR_FORMATS];
+        for(uint32_t i = 0; i < cfg->color_attachment_count; i++)
+        {
+            blend_enable[i] = VK_FALSE;
+            write_mask[i]   = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+        }
+
+        vkCmdSetColorBlendEnableEXT(cmd, 0, cfg->color_attachment_count, blend_enable);
+        vkCmdSetColorWriteMaskEXT(cmd, 0, cfg->color_attachment_count, write_mask);
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef VK_SHADER_OBJECT_H_
+#define VK_SHADER_OBJECT_H_
+
+#include "vk_defaults.h"
+#include "vk_pipelines.h"
+
+/* ------------------ VK_EXT_shader_object path ------------------ */
+//
+// Pipeline-free alternative to create_graphics_pipeline for tools and
+// debug views that churn through shader/state combinations. The same
+// SPIR-V files and reflection produce linked VkShaderEXT objects, and
+// every piece of fixed-function state is recorded as dynamic state from
+// a GraphicsPipelineConfig at draw time. Nothing is compiled per state
+// combination.
+//
+//   ShaderObjectProgram prog;
+//   shader_object_create_graphics(device, &desc_cache, &pipe_cache, &reflections, "a.vert.spv", "a.frag.spv", &cfg, &prog);
+//   ...
+//   shader_object_cmd_bind(cmd, &prog);
+//   shader_object_cmd_set_state(cmd, &cfg, extent);
+//   vkCmdDraw(...);
+//
+// Requires VK_EXT_shader_object with the shaderObject feature enabled.
+// Tessellation and geometry stages are bound to VK_NULL_HANDLE. That
+// assumes tessellationShader and geometryShader are enabled, which is
+// true on every desktop driver. Clear SHADER_OBJECT_NULL_STAGES if they
+// are not.
+
+#ifndef SHADER_OBJECT_NULL_STAGES
+#define SHADER_OBJECT_NULL_STAGES                                                                                      \
+    (VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT | VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT | VK_SHADER_STAGE_GEOMETRY_BIT)
+#endif
+
+typedef struct ShaderObjectProgram
+{
+    uint32_t              stage_count;
+    VkShaderStageFlagBits stages[2];
+    VkShaderEXT           shaders[2];
+    VkPipelineLayout      layout;  // owned by the pipeline layout cache, for descriptor binding and push constants
+} ShaderObjectProgram;
+
+bool shader_object_supported(VkPhysicalDevice physical_device);
+
+// vertex and fragment shaders created linked; cfg gets the reflected vertex input.
+// reflections may be NULL, see vk_reflection_cache.h
+bool shader_object_create_graphics(VkDevice                device,
+                                   DescriptorLayoutCache*  desc_cache,
+                                   PipelineLayoutCache*    pipe_cache,
+                                   ReflectionCache*        reflections,
+                                   const char*             vert_path,
+                                   const char*             frag_path,
+                                   GraphicsPipelineConfig* cfg,
+                                   ShaderObjectProgram*    out);
+
+bool shader_object_create_compute(VkDevice               device,
+                                  DescriptorLayoutCache* desc_cache,
+                                  PipelineLayoutCache*   pipe_cache,
+                                  ReflectionCache*       reflections,
+                                  const char*            comp_path,
+                                  ShaderObjectProgram*   out);
+
+void shader_object_destroy(VkDevice device, ShaderObjectProgram* prog);
+
+void shader_object_cmd_bind(VkCommandBuffer cmd, const ShaderObjectProgram* prog);
+
+// records every dynamic state shader objects need from cfg, viewport and scissor cover extent
+void shader_object_cmd_set_state(VkCommandBuffer cmd, const GraphicsPipelineConfig* cfg, VkExtent2D extent);
+
+#endif // VK_SHADER_OBJECT_H_
@@ -1,4 +1,5 @@
 #include "vk_shader_reflect.h"
+#include "vk_reflection_cache.h"
 
 // Convert SpvReflectDescriptorType to VkDescriptorType
 static VkDescriptorType spv_to_vk_descriptor_type(SpvReflectDescriptorType spv_type)
@@ -80,6 +81,44 @@ bool shader_reflect_create(ShaderReflection* reflection,
         }
     }
 
+    // Specialization constants, matched by name when pipelines specialize them
+    uint32_t spec_count = 0;
+    result = spvReflectEnumerateSpecializationConstants(&reflection->module, &spec_count, NULL);
+    if(result == SPV_REFLECT_RESULT_SUCCESS && spec_count > 0)
+    {
+        // SPIRV-Reflect wants room for all of them, the count mismatch fails otherwise
+        SpvReflectSpecializationConstant** specs = malloc(spec_count * sizeof(*specs));
+
+        result = spvReflectEnumerateSpecializationConstants(&reflection->module, &spec_count, specs);
+        if(result != SPV_REFLECT_RESULT_SUCCESS)
+        {
+            log_error("Failed to get specialization constants: %d", result);
+        }
+        else
+        {
+            if(spec_count > SHADER_REFLECT_MAX_SPEC)
+            {
+                log_error("Shader has %u specialization constants, only the first %u can be specialized by name", spec_count,
+                          SHADER_REFLECT_MAX_SPEC);
+                spec_count = SHADER_REFLECT_MAX_SPEC;
+            }
+
+            reflection->spec_constant_count = spec_count;
+
+            for(uint32_t i = 0; i < spec_count; i++)
+            {
+                const char*            name = specs[i]->name ? specs[i]->name : "";
+                ReflectedSpecConstant* spec = &reflection->spec_constants[i];
+
+                spec->constant_id = specs[i]->constant_id;
+                spec->name_hash   = hash64_bytes(name, strlen(name));
+                spec->name        = specs[i]->name;
+            }
+        }
+
+        free(specs);
+    }
+
     // Enumerate descriptor sets
     uint32_t set_count = 0;
     result = spvReflectEnumerateDescriptorSets(&reflection->module, &set_count, NULL);
@@ -385,19 +424,23 @@ VkPipelineLayout shader_reflect_create_pipeline_layout(VkDevice                d
 }
 
 
-VkPipelineLayout shader_reflect_build_pipeline_layout(VkDevice               device,
-                                                      DescriptorLayoutCache* desc_cache,
-                                                      PipelineLayoutCache*   pipe_cache,
-                                                      const void* const*     spirv_codes,
-                                                      const size_t*          spirv_sizes,
-                                                      uint32_t               shader_count)
+VkPipelineLayout shader_reflect_build_pipeline_layout(VkDevice                device,
+                                                      DescriptorLayoutCache*  desc_cache,
+                                                      PipelineLayoutCache*    pipe_cache,
+                                                      struct ReflectionCache* reflection_cache,
+                                                      const void* const*      spirv_codes,
+                                                      const size_t*           spirv_sizes,
+                                                      uint32_t                shader_count)
 {
     ShaderReflection reflections[8];
     uint32_t         valid_count = 0;
 
     for(uint32_t i = 0; i < shader_count && i < 8; i++)
     {
-        if(shader_reflect_create(&reflections[valid_count], spirv_codes[i], spirv_sizes[i]))
+        bool ok = reflection_cache ? shader_reflect_create_cached(reflection_cache, &reflections[valid_count], spirv_codes[i],
+                                                                  spirv_sizes[i], hash64_bytes(spirv_codes[i], spirv_sizes[i]))
+                                   : shader_reflect_create(&reflections[valid_count], spirv_codes[i], spirv_sizes[i]);
+        if(ok)
         {
             valid_count++;
         }
@@ -485,6 +528,26 @@ uint32_t shader_reflect_get_vertex_attributes(const ShaderReflection*
 }
 
 
+bool shader_reflect_find_spec_constant(const ShaderReflection* reflection,
+                                       const char*             name,
+                                       uint32_t*               out_constant_id)
+{
+    // by hash, reflections from the persistent cache carry no names
+    Hash64 name_hash = hash64_bytes(name, strlen(name));
+
+    for(uint32_t i = 0; i < reflection->spec_constant_count; i++)
+    {
+        if(reflection->spec_constants[i].name_hash == name_hash)
+        {
+            *out_constant_id = reflection->spec_constants[i].constant_id;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
 void shader_reflect_print(const ShaderReflection* reflection)
 {
     log_info("=== Shader Reflection ===");
@@ -542,5 +605,17 @@ void shader_reflect_print(const ShaderReflection* reflection)
         }
     }
 
+    if(reflection->spec_constant_count > 0)
+    {
+        log_info("Specialization Constants: %u", reflection->spec_constant_count);
+        for(uint32_t i = 0; i < reflection->spec_constant_count; i++)
+        {
+            const ReflectedSpecConstant* spec = &reflection->spec_constants[i];
+            log_info("  Constant %u: name=%s",
+                     spec->constant_id,
+                     spec->name ? spec->name : "(null)");
+        }
+    }
+
     log_info("=========================");
 }
@@ -12,6 +12,7 @@
 #define SHADER_REFLECT_MAX_BINDINGS  32
 #define SHADER_REFLECT_MAX_PUSH      4
 #define SHADER_REFLECT_MAX_INPUTS    16
+#define SHADER_REFLECT_MAX_SPEC      16
 
 // -------- Reflected shader data --------
 
@@ -47,6 +48,13 @@ typedef struct ReflectedVertexInput
     const char* name;
 } ReflectedVertexInput;
 
+typedef struct ReflectedSpecConstant
+{
+    uint32_t    constant_id;
+    Hash64      name_hash;  // hash64_bytes of the name, kept when the name is not
+    const char* name;
+} ReflectedSpecConstant;
+
 typedef struct ShaderReflection
 {
     SpvReflectShaderModule  module;
@@ -61,6 +69,9 @@ typedef struct ShaderReflection
     uint32_t                vertex_input_count;
     ReflectedVertexInput    vertex_inputs[SHADER_REFLECT_MAX_INPUTS];
 
+    uint32_t                spec_constant_count;
+    ReflectedSpecConstant   spec_constants[SHADER_REFLECT_MAX_SPEC];
+
     // Entry point info
     const char*             entry_point;
 
@@ -119,13 +130,16 @@ VkPipelineLayout shader_reflect_create_pipeline_layout(VkDevice                d
                                                        PipelineLayoutCache*    pipe_cache,
                                                        const MergedReflection* merged);
 
-// Convenience: create pipeline layout directly from shader SPIRVs
-VkPipelineLayout shader_reflect_build_pipeline_layout(VkDevice               device,
-                                                      DescriptorLayoutCache* desc_cache,
-                                                      PipelineLayoutCache*   pipe_cache,
-                                                      const void* const*     spirv_codes,
-                                                      const size_t*          spirv_sizes,
-                                                      uint32_t               shader_count);
+// Convenience: create pipeline layout directly from shader SPIRVs,
+// reflecting through reflections when it is not NULL (see vk_reflection_cache.h)
+struct ReflectionCache;
+VkPipelineLayout shader_reflect_build_pipeline_layout(VkDevice                device,
+                                                      DescriptorLayoutCache*  desc_cache,
+                                                      PipelineLayoutCache*    pipe_cache,
+                                                      struct ReflectionCache* reflections,
+                                                      const void* const*      spirv_codes,
+                                                      const size_t*           spirv_sizes,
+                                                      uint32_t                shader_count);
 
 // Get vertex input attribute descriptions from reflection
 uint32_t shader_reflect_get_vertex_attributes(const ShaderReflection*             reflection,
@@ -133,6 +147,11 @@ uint32_t shader_reflect_get_vertex_attributes(const ShaderReflection*
                                                uint32_t                           max_attrs,
                                                uint32_t                           binding);
 
+// Constant ID of the specialization constant called name, false if the shader has none
+bool shader_reflect_find_spec_constant(const ShaderReflection* reflection,
+                                       const char*             name,
+                                       uint32_t*               out_constant_id);
+
 // Print reflection info for debugging
 void shader_reflect_print(const ShaderReflection* reflection);
 
@@ -6,10 +6,12 @@ void query_device_features(VkPhysicalDevice gpu, VkFeatureChain* out)
     memset(out, 0, sizeof(*out));
 
     out->core.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    out->v11.sType  = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES;
     out->v12.sType  = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
     out->v13.sType  = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
 
-    out->core.pNext = &out->v12;
+    out->core.pNext = &out->v11;
+    out->v11.pNext  = &out->v12;
     out->v12.pNext  = &out->v13;
 
     vkGetPhysicalDeviceFeatures2(gpu, &out->core);
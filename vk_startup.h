@@ -8,6 +8,7 @@
 typedef struct VkFeatureChain
 {
     VkPhysicalDeviceFeatures2        core;
+    VkPhysicalDeviceVulkan11Features v11;
     VkPhysicalDeviceVulkan12Features v12;
     VkPhysicalDeviceVulkan13Features v13;
 } VkFeatureChain;
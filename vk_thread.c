@@ -0,0 +1,92 @@
+// clock_gettime and pthread_condattr_setclock are POSIX, hidden under strict -std=c99
+#define _POSIX_C_SOURCE 200112L
+
+#include "vk_thread.h"
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+
+void mutex_init(Mutex* m)
+{
+    pthread_mutex_init(&m->handle, NULL);
+}
+
+void mutex_destroy(Mutex* m)
+{
+    pthread_mutex_destroy(&m->handle);
+}
+
+void mutex_lock(Mutex* m)
+{
+    pthread_mutex_lock(&m->handle);
+}
+
+void mutex_unlock(Mutex* m)
+{
+    pthread_mutex_unlock(&m->handle);
+}
+
+void condvar_init(CondVar* c)
+{
+    // timed waits count on the monotonic clock, like time_now_ns
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&c->handle, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+void condvar_destroy(CondVar* c)
+{
+    pthread_cond_destroy(&c->handle);
+}
+
+void condvar_wait(CondVar* c, Mutex* m)
+{
+    pthread_cond_wait(&c->handle, &m->handle);
+}
+
+bool condvar_wait_timeout(CondVar* c, Mutex* m, uint64_t timeout_ns)
+{
+    uint64_t deadline = time_now_ns() + timeout_ns;
+
+    struct timespec ts = {
+        .tv_sec  = (time_t)(deadline / 1000000000ull),
+        .tv_nsec = (long)(deadline % 1000000000ull),
+    };
+
+    return pthread_cond_timedwait(&c->handle, &m->handle, &ts) != ETIMEDOUT;
+}
+
+void condvar_signal(CondVar* c)
+{
+    pthread_cond_signal(&c->handle);
+}
+
+void condvar_broadcast(CondVar* c)
+{
+    pthread_cond_broadcast(&c->handle);
+}
+
+bool thread_create(Thread* t, ThreadFn fn, void* arg)
+{
+    return pthread_create(&t->handle, NULL, fn, arg) == 0;
+}
+
+void thread_join(Thread* t)
+{
+    pthread_join(t->handle, NULL);
+}
+
+uint32_t thread_cpu_count(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (uint32_t)n : 1;
+}
+
+uint64_t time_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
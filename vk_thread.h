@@ -0,0 +1,64 @@
+#ifndef VK_THREAD_H_
+#define VK_THREAD_H_
+
+#include "vk_defaults.h"
+#include <pthread.h>
+
+/* ------------------ Atomics ------------------ */
+// thin wrappers over the gcc/clang builtins, c99 has no <stdatomic.h>
+
+#define ATOMIC_LOAD_RELAXED(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+#define ATOMIC_LOAD_ACQUIRE(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define ATOMIC_STORE_RELAXED(p, v) __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#define ATOMIC_STORE_RELEASE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define ATOMIC_FETCH_ADD(p, v) __atomic_fetch_add((p), (v), __ATOMIC_RELAXED)
+
+/* ------------------ Mutex ------------------ */
+
+typedef struct Mutex
+{
+    pthread_mutex_t handle;
+} Mutex;
+
+void mutex_init(Mutex* m);
+void mutex_destroy(Mutex* m);
+void mutex_lock(Mutex* m);
+void mutex_unlock(Mutex* m);
+
+/* ------------------ Condition variable ------------------ */
+
+typedef struct CondVar
+{
+    pthread_cond_t handle;
+} CondVar;
+
+void condvar_init(CondVar* c);
+void condvar_destroy(CondVar* c);
+// m must be locked, spurious wakeups happen so wait in a loop
+void condvar_wait(CondVar* c, Mutex* m);
+// like condvar_wait but gives up after timeout_ns, false on timeout
+bool condvar_wait_timeout(CondVar* c, Mutex* m, uint64_t timeout_ns);
+void condvar_signal(CondVar* c);
+void condvar_broadcast(CondVar* c);
+
+/* ------------------ Threads ------------------ */
+
+typedef struct Thread
+{
+    pthread_t handle;
+} Thread;
+
+typedef void* (*ThreadFn)(void* arg);
+
+bool thread_create(Thread* t, ThreadFn fn, void* arg);
+void thread_join(Thread* t);
+
+// online logical cores, at least 1
+uint32_t thread_cpu_count(void);
+
+/* ------------------ Time ------------------ */
+
+// monotonic clock, for timing work on the CPU
+uint64_t time_now_ns(void);
+
+#endif // VK_THREAD_H_